@@ -0,0 +1,49 @@
+#version 330 core
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : enable
+layout (bindless_sampler) uniform sampler2DArray textures;
+#else
+uniform sampler2DArray textures;
+#endif
+
+out vec4 color;
+
+in vec4 vertexColor;
+in vec2 TexCoord;
+flat in vec2 Layers;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+// per draw data, a range of the ring buffered UBO at UniformBindingDraw
+layout (std140) uniform DrawData
+{
+    mat4 model;
+    vec4 ourColor;
+    vec2 layers;
+    float alphaCutoff;
+};
+
+void main()
+{
+#if defined(TEXTURED) && defined(SDF)
+    // distance field in the first layer's red channel, 0.5 is the edge
+    float distance = texture(textures, vec3(TexCoord, Layers.x)).r;
+    float width = fwidth(distance);
+    color = vec4(ourColor.rgb, ourColor.a * smoothstep(0.5 - width, 0.5 + width, distance));
+#elif defined(TEXTURED)
+    color = mix(texture(textures, vec3(TexCoord, Layers.x)), texture(textures, vec3(TexCoord, Layers.y)), 0.2);
+#else
+    color = ourColor;
+#endif
+    color *= vertexColor;
+#ifdef ALPHA_TEST
+    if (color.a < alphaCutoff)
+        discard;
+#endif
+}
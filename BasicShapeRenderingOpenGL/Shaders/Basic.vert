@@ -0,0 +1,46 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+#ifdef INSTANCED
+layout (location = 2) in vec2 aLayers;     // per instance texture array layers
+#endif
+#ifdef VERTEX_COLOR
+layout (location = 3) in vec4 aColor;
+#endif
+
+out vec4 vertexColor;
+out vec2 TexCoord;
+flat out vec2 Layers;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+// per draw data, a range of the ring buffered UBO at UniformBindingDraw
+layout (std140) uniform DrawData
+{
+    mat4 model;
+    vec4 ourColor;
+    vec2 layers;
+    float alphaCutoff;
+};
+
+void main()
+{
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+    TexCoord = vec2(aTexCoord.x, aTexCoord.y);
+#ifdef INSTANCED
+    Layers = aLayers;
+#else
+    Layers = layers;
+#endif
+#ifdef VERTEX_COLOR
+    vertexColor = aColor;
+#else
+    vertexColor = vec4(1.0);
+#endif
+}
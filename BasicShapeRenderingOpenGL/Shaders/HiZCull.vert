@@ -0,0 +1,94 @@
+#version 330 core
+// one point per shape, the instance attributes of Shape.vert plus the same 32 bytes as raw words;
+// HiZCull.geom passes the words of the visible shapes on to transform feedback
+layout (location = 0) in vec3 aCenter;
+layout (location = 1) in vec2 aHalfSize;
+layout (location = 2) in vec2 aParams;
+layout (location = 3) in uvec2 aRotationType;
+layout (location = 4) in uvec4 aWords0;
+layout (location = 5) in uvec4 aWords1;
+
+flat out uvec4 Words0;
+flat out uvec4 Words1;
+flat out int Visible;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+uniform sampler2D hiZ;      // farthest depth per texel, level 0 is half the depth buffer
+uniform int depthWidth;     // the depth buffer the pyramid was built from
+uniform int depthHeight;
+uniform int hiZLevels;      // 0 before the first build, only the frustum is tested then
+uniform bool reversedZ;     // nearer is larger, and depth is clip space z / w without the 0.5 scale and bias
+
+const uint SHAPE_LINE = 3u;
+const uint SHAPE_RING = 4u;
+
+void main()
+{
+    Words0 = aWords0;
+    Words1 = aWords1;
+    Visible = 1;
+
+    // the shape's outline on its plane, as Shape.vert extends the quad but without the pixel margin
+    float angle = float(aRotationType.x) * (6.28318530718 / 65536.0);
+    vec2 axisX = vec2(cos(angle), sin(angle));
+    vec2 axisY = vec2(-axisX.y, axisX.x);
+    vec2 extent = aHalfSize;
+    if (aRotationType.y == SHAPE_LINE)
+        extent.x += aHalfSize.y;
+    else if (aRotationType.y == SHAPE_RING)
+        extent += 0.5 * aParams.x;
+    extent += 0.5 * aParams.y;
+
+    // screen rectangle and nearest depth of the four corners
+    vec2 rectMin = vec2(1e30);
+    vec2 rectMax = vec2(-1e30);
+    float nearest = reversedZ ? 0.0 : 1.0;
+    for (int i = 0; i < 4; i++)
+    {
+        vec2 corner = vec2(i & 1, i >> 1) * 2.0 - 1.0;
+        vec4 clip = viewProjection * vec4(aCenter + vec3(axisX * (corner.x * extent.x) + axisY * (corner.y * extent.y), 0.0), 1.0);
+        // reaches behind the camera, the rectangle would be meaningless
+        if (clip.w <= 1e-5)
+            return;
+        vec3 ndc = clip.xyz / clip.w;
+        rectMin = min(rectMin, ndc.xy);
+        rectMax = max(rectMax, ndc.xy);
+        float depth = reversedZ ? ndc.z : ndc.z * 0.5 + 0.5;
+        nearest = reversedZ ? max(nearest, depth) : min(nearest, depth);
+    }
+
+    // outside the frustum
+    if (any(lessThan(rectMax, vec2(-1.0))) || any(greaterThan(rectMin, vec2(1.0))) || (!reversedZ && nearest > 1.0))
+    {
+        Visible = 0;
+        return;
+    }
+    if (hiZLevels == 0)
+        return;
+    ivec2 depthSize = ivec2(depthWidth, depthHeight);
+
+    // two pixels of margin for the antialiased edge, then the level where the rectangle spans at most 2x2 texels
+    vec2 pixelMin = clamp((rectMin * 0.5 + 0.5) * vec2(depthSize) - 2.0, vec2(0.0), vec2(depthSize - 1));
+    vec2 pixelMax = clamp((rectMax * 0.5 + 0.5) * vec2(depthSize) + 2.0, vec2(0.0), vec2(depthSize - 1));
+    float texels = max(pixelMax.x - pixelMin.x, pixelMax.y - pixelMin.y) * 0.5;
+    int level = min(texels > 1.0 ? int(ceil(log2(texels))) : 0, hiZLevels - 1);
+
+    // pixels past the last texel of a level belong to it, the reduction folded them in
+    ivec2 levelSize = max(textureSize(hiZ, level), ivec2(1));
+    ivec2 texelMin = min(ivec2(pixelMin) >> (level + 1), levelSize - 1);
+    ivec2 texelMax = min(ivec2(pixelMax) >> (level + 1), levelSize - 1);
+    float a = texelFetch(hiZ, texelMin, level).r;
+    float b = texelFetch(hiZ, ivec2(texelMax.x, texelMin.y), level).r;
+    float c = texelFetch(hiZ, ivec2(texelMin.x, texelMax.y), level).r;
+    float d = texelFetch(hiZ, texelMax, level).r;
+    float farthest = reversedZ ? min(min(a, b), min(c, d)) : max(max(a, b), max(c, d));
+    if (reversedZ ? nearest < farthest : nearest > farthest)
+        Visible = 0;
+}
@@ -0,0 +1,37 @@
+#version 330 core
+// a level of the Hi-Z pyramid: every texel keeps the farthest depth of the 2x2 texels under it in
+// the level above, or of the depth buffer for level 0; a source with an odd size folds its last row
+// and column into the texels next to them, so the whole source stays covered
+out float depth;
+
+uniform sampler2D source;   // its base level is the one read, lod 0 below
+uniform bool reversedZ;     // farther is smaller
+
+ivec2 sourceSize;
+
+float Farthest(float a, float b)
+{
+    return reversedZ ? min(a, b) : max(a, b);
+}
+
+float Fetch(ivec2 texel)
+{
+    return texelFetch(source, min(texel, sourceSize - 1), 0).r;
+}
+
+void main()
+{
+    sourceSize = textureSize(source, 0);
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    float farthest = Farthest(Farthest(Fetch(texel), Fetch(texel + ivec2(1, 0))), Farthest(Fetch(texel + ivec2(0, 1)), Fetch(texel + ivec2(1, 1))));
+
+    bool extraColumn = (sourceSize.x & 1) != 0 && texel.x == sourceSize.x - 3;
+    bool extraRow = (sourceSize.y & 1) != 0 && texel.y == sourceSize.y - 3;
+    if (extraColumn)
+        farthest = Farthest(farthest, Farthest(Fetch(texel + ivec2(2, 0)), Fetch(texel + ivec2(2, 1))));
+    if (extraRow)
+        farthest = Farthest(farthest, Farthest(Fetch(texel + ivec2(0, 2)), Fetch(texel + ivec2(1, 2))));
+    if (extraColumn && extraRow)
+        farthest = Farthest(farthest, Fetch(texel + ivec2(2, 2)));
+    depth = farthest;
+}
@@ -0,0 +1,5 @@
+#version 330 core
+// only the depth test counts, color and depth writes are masked off while the boxes draw
+void main()
+{
+}
@@ -0,0 +1,22 @@
+#version 330 core
+// a box from its two corners alone, no vertex buffer: a 14 vertex triangle strip over all six faces
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+// the corner of every strip vertex, x in bit 0, y in bit 1, z in bit 2
+const int corners[14] = int[14](0, 1, 2, 3, 7, 1, 5, 0, 4, 2, 6, 7, 4, 5);
+
+void main()
+{
+    int corner = corners[gl_VertexID];
+    vec3 select = vec3(corner & 1, (corner >> 1) & 1, (corner >> 2) & 1);
+    gl_Position = viewProjection * vec4(mix(boxMin, boxMax, select), 1.0);
+}
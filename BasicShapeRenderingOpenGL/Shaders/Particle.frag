@@ -0,0 +1,16 @@
+#version 330 core
+out vec4 color;
+
+in vec2 Corner;
+flat in vec4 Color;
+
+void main()
+{
+    // round sprite, the edge antialiased over a pixel
+    float distance = length(Corner);
+    float coverage = clamp((1.0 - distance) / max(fwidth(distance), 1e-4), 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+    // premultiplied, added to what's there
+    color = vec4(Color.rgb * Color.a, Color.a) * coverage;
+}
@@ -0,0 +1,37 @@
+#version 330 core
+// one instance per particle straight from the simulation buffer, the quad corners come from gl_VertexID
+layout (location = 0) in vec4 aPositionAge;
+layout (location = 1) in vec4 aVelocityLifetime;
+
+out vec2 Corner;
+flat out vec4 Color;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+uniform float spriteSize;   // pixels at a distance of 1
+uniform vec4 startColor;    // linear
+uniform vec4 endColor;
+
+void main()
+{
+    float life = aPositionAge.w / aVelocityLifetime.w;
+    // not born yet or dead: a point outside the clip volume, nothing is rasterized
+    if (aPositionAge.w < 0.0 || life >= 1.0)
+    {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    Color = mix(startColor, endColor, life);
+    vec4 clip = viewProjection * vec4(aPositionAge.xyz, 1.0);
+    // spriteSize / w pixels, at least one; the clip space offset is that times w
+    float size = max(spriteSize * (1.0 - 0.5 * life), clip.w);
+    gl_Position = clip + vec4(Corner * size * 2.0 / viewportSize, 0.0, 0.0);
+}
@@ -0,0 +1,67 @@
+#version 330 core
+// one point per particle, the outputs are captured by transform feedback into the other buffer
+layout (location = 0) in vec4 aPositionAge;        // age < 0 is not born yet
+layout (location = 1) in vec4 aVelocityLifetime;
+
+out vec4 PositionAge;
+out vec4 VelocityLifetime;
+
+uniform float deltaTime;
+uniform int seed;               // the update step, every respawn gets new randomness
+uniform vec3 emitterPosition;
+uniform vec3 emitterDirection;  // normalized
+uniform float cosSpread;        // cosine of the emission cone's half angle
+uniform vec4 speedLifetime;     // min speed, max speed, min lifetime, max lifetime
+uniform vec3 gravity;
+uniform float dragFactor;       // velocity kept over this step
+
+// PCG hash, the same as Hash in ParticleSystem.cpp
+uint Hash(uint x)
+{
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float Random(inout uint state)
+{
+    state = Hash(state);
+    return float(state >> 8) * (1.0 / 16777216.0);
+}
+
+// a new life at the emitter, age is how far into it the particle already is
+void Spawn(float age)
+{
+    uint state = uint(gl_VertexID) ^ Hash(uint(seed));
+    float lifetime = mix(speedLifetime.z, speedLifetime.w, Random(state));
+    float cosTheta = mix(1.0, cosSpread, Random(state));
+    float sinTheta = sqrt(max(0.0, 1.0 - cosTheta * cosTheta));
+    float phi = 6.2831853 * Random(state);
+    float speed = mix(speedLifetime.x, speedLifetime.y, Random(state));
+
+    vec3 tangent = normalize(cross(abs(emitterDirection.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), emitterDirection));
+    vec3 bitangent = cross(emitterDirection, tangent);
+    vec3 velocity = (tangent * (sinTheta * cos(phi)) + bitangent * (sinTheta * sin(phi)) + emitterDirection * cosTheta) * speed;
+
+    PositionAge = vec4(emitterPosition, age);
+    VelocityLifetime = vec4(velocity, lifetime);
+}
+
+void main()
+{
+    float age = aPositionAge.w + deltaTime;
+    PositionAge = vec4(aPositionAge.xyz, age);
+    VelocityLifetime = aVelocityLifetime;
+    if (age < 0.0)
+        return;
+
+    if (aPositionAge.w < 0.0 || age >= aVelocityLifetime.w)
+    {
+        // born this step, or died and starts over with what's left of the step
+        Spawn(aPositionAge.w < 0.0 ? age : age - aVelocityLifetime.w);
+        return;
+    }
+    vec3 velocity = (aVelocityLifetime.xyz + gravity * deltaTime) * dragFactor;
+    PositionAge.xyz += velocity * deltaTime;
+    VelocityLifetime.xyz = velocity;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 color;
+
+noperspective in vec2 SegmentPos;
+flat in float SegmentLength;
+flat in float HalfWidth;
+flat in vec2 Caps;
+flat in vec4 Color;
+
+void main()
+{
+    // distance in pixels to the center line, or to the end point past a round cap
+    float distance = abs(SegmentPos.y);
+    if (Caps.x > 0.5 && SegmentPos.x < 0.0)
+        distance = length(SegmentPos);
+    else if (Caps.y > 0.5 && SegmentPos.x > SegmentLength)
+        distance = length(vec2(SegmentPos.x - SegmentLength, SegmentPos.y));
+
+    float coverage = clamp(HalfWidth + 0.5 - distance, 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+    // premultiplied
+    color = vec4(Color.rgb * Color.a, Color.a) * coverage;
+}
@@ -0,0 +1,105 @@
+#version 330 core
+// one instance per segment: the attributes are consecutive points of the same buffer
+layout (location = 0) in vec3 aPrevious;    // the start point again at the first segment
+layout (location = 1) in vec3 aStart;
+layout (location = 2) in vec3 aEnd;
+layout (location = 3) in vec3 aNext;        // the end point again at the last segment
+layout (location = 4) in float aWidth;      // pixels
+layout (location = 5) in vec4 aColor;       // sRGB encoded
+
+noperspective out vec2 SegmentPos;  // pixels along the segment from its start and across from its center line
+flat out float SegmentLength;
+flat out float HalfWidth;
+flat out vec2 Caps;                 // 1 where the start or end is rounded instead of joined
+flat out vec4 Color;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+// sharper turns than this cosine between the miter and the normal (about 120 degrees) get round caps,
+// the miter would otherwise reach more than twice the width past the point
+const float MITER_LIMIT = 0.5;
+
+vec3 SrgbToLinear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+vec2 ToPixels(vec4 clip)
+{
+    return clip.xy / clip.w * 0.5 * viewportSize;
+}
+
+// miter direction where the segment meets its neighbour, false for a cap
+bool Join(vec3 point, vec3 neighbour, vec2 pointPixels, vec2 direction, bool atEnd, out vec2 miter)
+{
+    miter = vec2(0.0);
+    vec4 clipNeighbour = viewProjection * vec4(neighbour, 1.0);
+    if (neighbour == point || clipNeighbour.w <= 0.0)
+        return false;
+    // the neighbouring segment, pointing the same way as this one
+    vec2 other = atEnd ? ToPixels(clipNeighbour) - pointPixels : pointPixels - ToPixels(clipNeighbour);
+    if (dot(other, other) < 1e-8)
+        return false;
+    vec2 tangent = normalize(other) + direction;
+    if (dot(tangent, tangent) < 1e-8)
+        return false;
+    tangent = normalize(tangent);
+    miter = vec2(-tangent.y, tangent.x);
+    return dot(miter, vec2(-direction.y, direction.x)) >= MITER_LIMIT;
+}
+
+void main()
+{
+    vec4 clipStart = viewProjection * vec4(aStart, 1.0);
+    vec4 clipEnd = viewProjection * vec4(aEnd, 1.0);
+    // segments reaching behind the camera are dropped rather than clipped
+    if (clipStart.w <= 0.0 || clipEnd.w <= 0.0)
+    {
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    vec2 start = ToPixels(clipStart);
+    vec2 end = ToPixels(clipEnd);
+    SegmentLength = length(end - start);
+    vec2 direction = SegmentLength > 1e-4 ? (end - start) / SegmentLength : vec2(1.0, 0.0);
+    vec2 normal = vec2(-direction.y, direction.x);
+
+    // lines thinner than a pixel are drawn a pixel wide and fade instead
+    HalfWidth = 0.5 * max(aWidth, 1.0);
+    Color = vec4(SrgbToLinear(aColor.rgb), aColor.a * min(aWidth, 1.0));
+    // a pixel past the edge for the antialiasing
+    float extent = HalfWidth + 1.0;
+
+    // both ends are worked out at every vertex, the flat outputs have to agree
+    vec2 startMiter, endMiter;
+    bool startJoined = Join(aStart, aPrevious, start, direction, false, startMiter);
+    bool endJoined = Join(aEnd, aNext, end, direction, true, endMiter);
+    Caps = vec2(startJoined ? 0.0 : 1.0, endJoined ? 0.0 : 1.0);
+
+    // strip order: start right, start left, end right, end left
+    bool atEnd = gl_VertexID >= 2;
+    float side = (gl_VertexID & 1) == 0 ? -1.0 : 1.0;
+    vec2 offset;
+    if (atEnd ? endJoined : startJoined)
+    {
+        vec2 miter = atEnd ? endMiter : startMiter;
+        // as long as it has to be for the edge to stay extent away from the center line
+        offset = miter * (side * extent / dot(miter, normal));
+    }
+    else
+    {
+        offset = normal * (side * extent) + direction * (atEnd ? extent : -extent);
+    }
+
+    vec2 position = (atEnd ? end : start) + offset;
+    SegmentPos = vec2(dot(position - start, direction), dot(position - start, normal));
+    vec4 clip = atEnd ? clipEnd : clipStart;
+    gl_Position = vec4(position / (0.5 * viewportSize) * clip.w, clip.z, clip.w);
+}
@@ -0,0 +1,70 @@
+#version 330 core
+#ifdef PICKING
+out uint id;
+#else
+out vec4 color;
+#endif
+
+in vec2 LocalPos;
+flat in vec2 HalfSize;
+flat in vec2 Params;
+flat in uint Type;
+flat in vec4 FillColor;
+flat in vec4 StrokeColor;
+#ifdef PICKING
+flat in uint ShapeId;
+#endif
+
+// ShapeType in ShapeRenderer.h
+const uint SHAPE_CIRCLE = 0u;
+const uint SHAPE_ELLIPSE = 1u;
+const uint SHAPE_ROUNDED_RECT = 2u;
+const uint SHAPE_LINE = 3u;
+const uint SHAPE_RING = 4u;
+
+// signed distance to the outline in world units, negative inside
+float ShapeDistance(vec2 p)
+{
+    if (Type == SHAPE_CIRCLE)
+        return length(p) - HalfSize.x;
+    if (Type == SHAPE_ELLIPSE)
+    {
+        // first order approximation, exact on the outline which is all the edge needs
+        float k0 = length(p / HalfSize);
+        float k1 = length(p / (HalfSize * HalfSize));
+        return k0 * (k0 - 1.0) / max(k1, 1e-6);
+    }
+    if (Type == SHAPE_ROUNDED_RECT)
+    {
+        vec2 q = abs(p) - HalfSize + Params.x;
+        return length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - Params.x;
+    }
+    if (Type == SHAPE_LINE)
+        return length(vec2(max(abs(p.x) - HalfSize.x, 0.0), p.y)) - HalfSize.y;
+    // SHAPE_RING
+    return abs(length(p) - HalfSize.x) - 0.5 * Params.x;
+}
+
+void main()
+{
+    float distance = ShapeDistance(LocalPos);
+#ifdef PICKING
+    // the same hit test as ShapeBvh::Pick: inside a visible fill or on a visible stroke, no antialiasing
+    bool hit = (FillColor.a > 0.0 && distance <= 0.0) || (Params.y > 0.0 && StrokeColor.a > 0.0 && abs(distance) <= 0.5 * Params.y);
+    if (!hit)
+        discard;
+    id = ShapeId;
+#else
+    // distance change per pixel, so the edge is a pixel wide at any scale or angle
+    float pixel = max(length(vec2(dFdx(distance), dFdy(distance))), 1e-6);
+    float fillCoverage = clamp(0.5 - distance / pixel, 0.0, 1.0);
+    float strokeCoverage = Params.y > 0.0 ? clamp(0.5 - (abs(distance) - 0.5 * Params.y) / pixel, 0.0, 1.0) : 0.0;
+
+    // premultiplied, the stroke over the fill
+    vec4 fill = vec4(FillColor.rgb * FillColor.a, FillColor.a) * fillCoverage;
+    vec4 stroke = vec4(StrokeColor.rgb * StrokeColor.a, StrokeColor.a) * strokeCoverage;
+    color = stroke + fill * (1.0 - stroke.a);
+    if (color.a <= 0.0)
+        discard;
+#endif
+}
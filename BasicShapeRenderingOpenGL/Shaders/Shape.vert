@@ -0,0 +1,73 @@
+#version 330 core
+// one instance per shape, the quad corners come from gl_VertexID (a 4 vertex triangle strip)
+layout (location = 0) in vec3 aCenter;
+layout (location = 1) in vec2 aHalfSize;        // radii, half extents, or half length and half thickness
+layout (location = 2) in vec2 aParams;          // corner radius or ring thickness, stroke width
+layout (location = 3) in uvec2 aRotationType;   // rotation in 1/65536 turns, shape type
+layout (location = 4) in vec4 aFillColor;       // sRGB encoded
+layout (location = 5) in vec4 aStrokeColor;
+
+out vec2 LocalPos;
+flat out vec2 HalfSize;
+flat out vec2 Params;
+flat out uint Type;
+flat out vec4 FillColor;
+flat out vec4 StrokeColor;
+#ifdef PICKING
+flat out uint ShapeId;      // 1 based, 0 is the cleared background
+#endif
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+const uint SHAPE_LINE = 3u;
+const uint SHAPE_RING = 4u;
+
+vec3 SrgbToLinear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+vec2 ProjectToPixels(vec3 position)
+{
+    vec4 clip = viewProjection * vec4(position, 1.0);
+    return clip.xy / max(clip.w, 1e-5) * 0.5 * viewportSize;
+}
+
+void main()
+{
+    float angle = float(aRotationType.x) * (6.28318530718 / 65536.0);
+    vec2 axisX = vec2(cos(angle), sin(angle));
+    vec2 axisY = vec2(-axisX.y, axisX.x);
+
+    // extent of the shape's outline around the center
+    vec2 extent = aHalfSize;
+    if (aRotationType.y == SHAPE_LINE)
+        extent.x += aHalfSize.y;    // round caps
+    else if (aRotationType.y == SHAPE_RING)
+        extent += 0.5 * aParams.x;
+
+    // grow the quad by half the stroke and 1.5 pixels so the antialiased edge isn't cut off
+    vec2 centerPixels = ProjectToPixels(aCenter);
+    float pixelsPerUnit = min(length(ProjectToPixels(aCenter + vec3(axisX, 0.0)) - centerPixels),
+        length(ProjectToPixels(aCenter + vec3(axisY, 0.0)) - centerPixels));
+    extent += 0.5 * aParams.y + 1.5 / max(pixelsPerUnit, 1e-4);
+
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    LocalPos = corner * extent;
+    gl_Position = viewProjection * vec4(aCenter + vec3(axisX * LocalPos.x + axisY * LocalPos.y, 0.0), 1.0);
+
+    HalfSize = aHalfSize;
+    Params = aParams;
+    Type = aRotationType.y;
+    FillColor = vec4(SrgbToLinear(aFillColor.rgb), aFillColor.a);
+    StrokeColor = vec4(SrgbToLinear(aStrokeColor.rgb), aStrokeColor.a);
+#ifdef PICKING
+    ShapeId = uint(gl_InstanceID) + 1u;
+#endif
+}
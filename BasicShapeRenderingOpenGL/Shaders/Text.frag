@@ -0,0 +1,24 @@
+#version 330 core
+out vec4 color;
+
+in vec2 TexCoord;
+flat in vec4 Color;
+
+uniform sampler2D glyphs;
+
+// the atlas stores 0.5 on the outline and 0.25 per grid unit, a unit is a pixel at 16 px text
+const float OUTLINE_EDGE = 0.3;
+const vec4 OUTLINE_COLOR = vec4(0.0, 0.0, 0.0, 0.7);
+
+void main()
+{
+    float distance = texture(glyphs, TexCoord).r;
+    // a pixel of antialiasing at any size, whatever the minification
+    float width = max(fwidth(distance), 1e-4);
+    float fill = clamp((distance - 0.5) / width + 0.5, 0.0, 1.0) * Color.a;
+    float outline = clamp((distance - OUTLINE_EDGE) / width + 0.5, 0.0, 1.0) * OUTLINE_COLOR.a * Color.a;
+    if (fill + outline <= 0.0)
+        discard;
+    // premultiplied, the fill over its outline
+    color = vec4(Color.rgb * fill, fill) + vec4(OUTLINE_COLOR.rgb * outline, outline) * (1.0 - fill);
+}
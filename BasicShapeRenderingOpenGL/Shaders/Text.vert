@@ -0,0 +1,50 @@
+#version 330 core
+// one instance per glyph, the quad corners come from gl_VertexID (a 4 vertex triangle strip)
+layout (location = 0) in vec3 aAnchor;      // world position, or pixels from the top left for screen text
+layout (location = 1) in vec2 aOffset;      // pixels from the anchor, y up
+layout (location = 2) in vec2 aSize;        // pixels
+layout (location = 3) in vec4 aTexRect;     // uv min, uv max in the atlas
+layout (location = 4) in vec4 aColor;       // sRGB encoded
+
+out vec2 TexCoord;
+flat out vec4 Color;
+
+// per frame data, bound once at UniformBindingFrame
+layout (std140) uniform FrameData
+{
+    mat4 viewProjection;    // projection * view, multiplied once on the CPU
+    float time;
+    vec2 viewportSize;      // framebuffer size in pixels
+};
+
+uniform bool screenSpace;
+
+vec3 SrgbToLinear(vec3 c)
+{
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(0.04045, c));
+}
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pixel = aOffset + corner * aSize;
+    TexCoord = mix(aTexRect.xy, aTexRect.zw, corner);
+    Color = vec4(SrgbToLinear(aColor.rgb), aColor.a);
+
+    if (screenSpace)
+    {
+        vec2 position = vec2(aAnchor.x, viewportSize.y - aAnchor.y) + pixel;
+        gl_Position = vec4(position / viewportSize * 2.0 - 1.0, 0.0, 1.0);
+        return;
+    }
+
+    // labels keep their pixel size at any distance, the offset is scaled by w to undo the divide
+    vec4 clip = viewProjection * vec4(aAnchor, 1.0);
+    if (clip.w <= 0.0)
+    {
+        // behind the camera: outside the clip volume, nothing is rasterized
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+    gl_Position = clip + vec4(pixel * 2.0 / viewportSize * clip.w, 0.0, 0.0);
+}
@@ -0,0 +1,251 @@
+#include "AssetCache.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    unsigned long long hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string HashToString(unsigned long long hash)
+{
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", hash);
+    return buffer;
+}
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    mData = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mData)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    mFile = file;
+    mMapping = mapping;
+    mSize = (size_t)size.QuadPart;
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps its own reference to the file
+    close(file);
+    if (data == MAP_FAILED)
+        return false;
+
+    mData = (const unsigned char*)data;
+    mSize = (size_t)info.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (!mData)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+    mFile = nullptr;
+    mMapping = nullptr;
+#else
+    munmap((void*)mData, mSize);
+#endif
+    mData = nullptr;
+    mSize = 0;
+}
+
+AssetCache::AssetCache(const std::string& cacheDirectory)
+    : mDirectory(cacheDirectory)
+{
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+    LoadIndex();
+}
+
+AssetCache::~AssetCache()
+{
+    SaveIndex();
+}
+
+std::string AssetCache::GetKey(const std::string& sourcePath, const std::string& kind)
+{
+    std::error_code error;
+    unsigned long long size = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return std::string();
+    long long modifiedTime = (long long)std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+
+    // size and mtime unchanged, trust the hash we already have
+    unsigned long long contentHash;
+    auto found = mSources.find(sourcePath);
+    if (found != mSources.end() && found->second.size == size && found->second.modifiedTime == modifiedTime)
+    {
+        contentHash = found->second.hash;
+    }
+    else
+    {
+        MappedFile source;
+        if (!source.Open(sourcePath))
+            return std::string();
+        contentHash = HashBytes(source.GetData(), source.GetSize());
+        mSources[sourcePath] = { size, modifiedTime, contentHash };
+        mIndexDirty = true;
+        mStats.sourcesHashed++;
+    }
+
+    return kind + "-" + HashToString(HashBytes(kind.data(), kind.size(), contentHash));
+}
+
+std::string AssetCache::GetKey(const void* data, size_t size, const std::string& kind)
+{
+    unsigned long long contentHash = HashBytes(data, size);
+    return kind + "-" + HashToString(HashBytes(kind.data(), kind.size(), contentHash));
+}
+
+bool AssetCache::Load(const std::string& key, MappedFile& file)
+{
+    if (!key.empty() && file.Open(GetEntryPath(key)))
+    {
+        mStats.hits++;
+        return true;
+    }
+    mStats.misses++;
+    return false;
+}
+
+bool AssetCache::Store(const std::string& key, const void* data, size_t size)
+{
+    if (key.empty())
+        return false;
+
+    // write to a temporary first so a crash never leaves a truncated entry behind
+    std::string path = GetEntryPath(key);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary);
+        if (!file)
+            return false;
+        file.write((const char*)data, size);
+        if (!file)
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::cout << "AssetCache: failed to store " << key << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+std::string AssetCache::GetEntryPath(const std::string& key) const
+{
+    return mDirectory + "/" + key + ".bin";
+}
+
+void AssetCache::LoadIndex()
+{
+    std::ifstream file(mDirectory + "/index.txt");
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // size mtime hash path, the path goes last since it may contain spaces
+        std::istringstream stream(line);
+        SourceRecord record;
+        std::string hash, path;
+        if (!(stream >> record.size >> record.modifiedTime >> hash))
+            continue;
+        std::getline(stream >> std::ws, path);
+        // a corrupt or truncated line is dropped, its source is simply cooked again
+        char* end = nullptr;
+        errno = 0;
+        record.hash = strtoull(hash.c_str(), &end, 16);
+        if (path.empty() || !isxdigit((unsigned char)hash[0]) || *end != '\0' || errno == ERANGE)
+            continue;
+        mSources[path] = record;
+    }
+}
+
+void AssetCache::SaveIndex()
+{
+    if (!mIndexDirty)
+        return;
+
+    std::ofstream file(mDirectory + "/index.txt");
+    for (const auto& source : mSources)
+    {
+        file << source.second.size << " " << source.second.modifiedTime << " "
+            << HashToString(source.second.hash) << " " << source.first << "\n";
+    }
+    mIndexDirty = false;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 64 bit FNV-1a, pass the previous result as seed to hash several pieces together
+unsigned long long HashBytes(const void* data, size_t size, unsigned long long seed = 14695981039346656037ull);
+std::string HashToString(unsigned long long hash);
+
+// Read only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const unsigned char* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+
+private:
+	const unsigned char* mData = nullptr;
+	size_t mSize = 0;
+#ifdef _WIN32
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+struct AssetCacheStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int sourcesHashed = 0;	// sources whose size/mtime changed and had to be hashed again
+};
+
+// On disk cache of processed assets (cooked textures, program binaries, ...). Entries are keyed by
+// the content hash of their source plus the kind of processing, so renaming or touching a file
+// never invalidates anything. Sources are only re-hashed when their size or mtime changes.
+class AssetCache
+{
+public:
+	AssetCache(const std::string& cacheDirectory);
+	~AssetCache();
+
+	// key for the processed form of sourcePath, kind should change whenever the processing does
+	std::string GetKey(const std::string& sourcePath, const std::string& kind);
+	// key for data that doesn't come from a file, e.g. embedded shader sources
+	std::string GetKey(const void* data, size_t size, const std::string& kind);
+
+	// maps the cached entry, returns false on a miss
+	bool Load(const std::string& key, MappedFile& file);
+	bool Store(const std::string& key, const void* data, size_t size);
+
+	void SaveIndex();
+	const AssetCacheStats& GetStats() const { return mStats; }
+
+private:
+	struct SourceRecord
+	{
+		unsigned long long size;
+		long long modifiedTime;
+		unsigned long long hash;
+	};
+
+	std::string GetEntryPath(const std::string& key) const;
+	void LoadIndex();
+
+	std::string mDirectory;
+	std::unordered_map<std::string, SourceRecord> mSources;
+	bool mIndexDirty = false;
+	AssetCacheStats mStats;
+};
@@ -1,12 +1,13 @@
 #include "Buffer.h"
+#include "RenderDevice.h"
 #include <glad/glad.h>
 
 VertexBuffer::VertexBuffer(std::vector<float> vertices)
 {
-    glGenBuffers(1, &mVertexBufferObject);
+    mVertexBufferObject = GetRenderDevice().GenBuffer();
 
     Bind();
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+    GetRenderDevice().BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
 }
 
 VertexBuffer::~VertexBuffer()
@@ -16,25 +17,25 @@ VertexBuffer::~VertexBuffer()
 
 void VertexBuffer::Bind()
 {
-    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    GetRenderDevice().BindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
 }
 
 void VertexBuffer::Unbind()
 {
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    GetRenderDevice().BindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void VertexBuffer::DeleteVertexBuffer()
 {
-    glDeleteBuffers(1, &mVertexBufferObject);
+    GetRenderDevice().DeleteBuffer(mVertexBufferObject);
 }
 
 IndexBuffer::IndexBuffer(std::vector<unsigned int> indices)
 {
-    glGenBuffers(1, &mIndexBuffer);
+    mIndexBuffer = GetRenderDevice().GenBuffer();
 
     Bind();
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    GetRenderDevice().BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 }
 
 IndexBuffer::~IndexBuffer()
@@ -44,15 +45,15 @@ IndexBuffer::~IndexBuffer()
 
 void IndexBuffer::Bind()
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
+    GetRenderDevice().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuffer);
 }
 
 void IndexBuffer::Unbind()
 {
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    GetRenderDevice().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 void IndexBuffer::DeleteIndexBuffer()
 {
-    glDeleteBuffers(1, &mIndexBuffer);
+    GetRenderDevice().DeleteBuffer(mIndexBuffer);
 }
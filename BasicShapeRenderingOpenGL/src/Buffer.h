@@ -6,6 +6,8 @@ class VertexBuffer
 public:
 	VertexBuffer(std::vector<float> vertices);
 	~VertexBuffer();
+	VertexBuffer(const VertexBuffer&) = delete;
+	VertexBuffer& operator=(const VertexBuffer&) = delete;
 	void Bind();
 	void Unbind();
 	unsigned int GetVertexBuffer() const { return mVertexBufferObject; }
@@ -19,6 +21,8 @@ class IndexBuffer
 public:
 	IndexBuffer(std::vector<unsigned int> indices);
 	~IndexBuffer();
+	IndexBuffer(const IndexBuffer&) = delete;
+	IndexBuffer& operator=(const IndexBuffer&) = delete;
 	void Bind();
 	void Unbind();
 	unsigned int GetIndexBuffer() const { return mIndexBuffer; }
@@ -2,9 +2,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 Camera::Camera(float screenWidth, float screenHeight)
+    : mAspect(screenWidth / screenHeight), mViewportSize(screenWidth, screenHeight)
 {
-    mProjection = glm::perspective(glm::radians(mFov), screenWidth / screenHeight, 0.1f, 100.0f);
-    mView = glm::lookAt(mCameraPos, mCameraPos + mCameraFront, mCameraUp);
+    UpdateMatrices();
 }
 
 Camera::~Camera()
@@ -27,6 +27,8 @@ void Camera::MouseCallback(double xposIn, double yposIn)
     float yoffset = mLastY - ypos; // reversed since y-coordinates go from bottom to top
     mLastX = xpos;
     mLastY = ypos;
+    if (xoffset == 0.0f && yoffset == 0.0f)
+        return;
 
     float sensitivity = 0.1f; // change this value to your liking
     xoffset *= sensitivity;
@@ -46,8 +48,7 @@ void Camera::MouseCallback(double xposIn, double yposIn)
     front.y = sin(glm::radians(mPitch));
     front.z = sin(glm::radians(mYaw)) * cos(glm::radians(mPitch));
     mCameraFront = glm::normalize(front);
-
-    RecalculateViewMatrix();
+    mViewDirty = true;
 }
 
 void Camera::ScrollCallback(double xoffset, double yoffset)
@@ -57,24 +58,119 @@ void Camera::ScrollCallback(double xoffset, double yoffset)
         mFov = 1.0f;
     if (mFov > 45.0f)
         mFov = 45.0f;
+    mProjectionDirty = true;
+}
+
+void Camera::SetViewportSize(float width, float height)
+{
+    if (width <= 0.0f || height <= 0.0f)
+        return;
+    mViewportSize = glm::vec2(width, height);
+    if (width / height == mAspect)
+        return;
+    mAspect = width / height;
+    mProjectionDirty = true;
+}
+
+void Camera::SetReversedZ(bool reversedZ)
+{
+    if (reversedZ == mReversedZ)
+        return;
+    mReversedZ = reversedZ;
+    mProjectionDirty = true;
 }
 
 void Camera::processInput(GLFWwindow* window, float deltaTime)
 {
+    ProcessMovement(glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS, glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS,
+        glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS, glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS, deltaTime);
+}
+
+void Camera::ProcessMovement(bool forward, bool backward, bool left, bool right, float deltaTime)
+{
+    mPreviousCameraPos = mCameraPos;
+    if (!forward && !backward && !left && !right)
+        return;
+
     float cameraSpeed = static_cast<float>(2.5 * deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+    if (forward)
         mCameraPos += cameraSpeed * mCameraFront;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+    if (backward)
         mCameraPos -= cameraSpeed * mCameraFront;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+    if (left)
         mCameraPos -= glm::normalize(glm::cross(mCameraFront, mCameraUp)) * cameraSpeed;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+    if (right)
         mCameraPos += glm::normalize(glm::cross(mCameraFront, mCameraUp)) * cameraSpeed;
+    mViewDirty = true;
+}
 
-    RecalculateViewMatrix();
+glm::mat4 Camera::GetInterpolatedViewProjection(float alpha)
+{
+    // standing still the cached matrix is exact
+    if (mPreviousCameraPos == mCameraPos)
+        return GetViewProjection();
+
+    UpdateMatrices();
+    return mProjection * BuildView(glm::mix(mPreviousCameraPos, mCameraPos, alpha));
 }
 
-void Camera::RecalculateViewMatrix()
+bool Camera::UpdateMatrices()
 {
-    mView = glm::lookAt(mCameraPos, mCameraPos + mCameraFront, mCameraUp);
+    if (!mViewDirty && !mProjectionDirty)
+        return false;
+
+    if (mViewDirty)
+    {
+        mView = BuildView(mCameraPos);
+        // rotation and translation only, so the inverse is the transposed rotation and the rotated, negated translation
+        glm::mat3 rotation = glm::transpose(glm::mat3(mView));
+        mInverseView = glm::mat4(rotation);
+        mInverseView[3] = glm::vec4(-(rotation * glm::vec3(mView[3])), 1.0f);
+    }
+    if (mProjectionDirty)
+        BuildProjection();
+
+    mViewProjection = mProjection * mView;
+    mInverseViewProjection = mInverseView * mInverseProjection;
+    mViewDirty = false;
+    mProjectionDirty = false;
+    mMatrixRebuilds++;
+    return true;
+}
+
+glm::mat4 Camera::BuildView(const glm::vec3& position) const
+{
+    return glm::lookAt(position, position + mCameraFront, mCameraUp);
+}
+
+void Camera::BuildProjection()
+{
+    float focal = 1.0f / tan(glm::radians(mFov) * 0.5f);
+    mProjection = glm::mat4(0.0f);
+    mInverseProjection = glm::mat4(0.0f);
+    mProjection[0][0] = focal / mAspect;
+    mProjection[1][1] = focal;
+    mInverseProjection[0][0] = mAspect / focal;
+    mInverseProjection[1][1] = 1.0f / focal;
+
+    if (mReversedZ)
+    {
+        // clip z is the near distance and w the view depth, so depth = near / depth falls from 1 towards 0
+        mProjection[2][3] = -1.0f;
+        mProjection[3][2] = mNear;
+        mInverseProjection[3][2] = -1.0f;
+        mInverseProjection[2][3] = 1.0f / mNear;
+    }
+    else
+    {
+        // same as glm::perspective
+        float a = (mFar + mNear) / (mNear - mFar);
+        float b = 2.0f * mFar * mNear / (mNear - mFar);
+        mProjection[2][2] = a;
+        mProjection[2][3] = -1.0f;
+        mProjection[3][2] = b;
+        mInverseProjection[3][2] = -1.0f;
+        mInverseProjection[2][3] = 1.0f / b;
+        mInverseProjection[3][3] = a / b;
+    }
 }
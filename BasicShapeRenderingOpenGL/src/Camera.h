@@ -1,6 +1,10 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <GLFW/glfw3.h>
+
+// Keeps view, projection, view-projection and their inverses. Input and resizes only mark them
+// dirty, they are rebuilt together the next time one is asked for. The inverses come from the
+// structure of the matrices (rigid view, perspective projection) rather than a general inverse.
 class Camera
 {
 public:
@@ -9,18 +13,47 @@ public:
 
 	void MouseCallback(double xposIn, double yposIn);
 	void ScrollCallback(double xoffset, double yoffset);
+	// from the framebuffer size, sizes of 0 (a minimized window) are ignored
+	void SetViewportSize(float width, float height);
+	const glm::vec2& GetViewportSize() const { return mViewportSize; }
+	// infinite far plane with depth 1 at the near plane and 0 at infinity, needs
+	// glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE), a GL_GREATER depth test and a depth clear of 0
+	void SetReversedZ(bool reversedZ);
+	bool IsReversedZ() const { return mReversedZ; }
 
 	void processInput(GLFWwindow* window, float deltaTime);
-	glm::mat4 GetCameraView() const { return mView; }
-	glm::mat4 GetCameraProjection() const { return mProjection; }
+	// same as processInput with the keys already sampled, safe to call off the GL thread
+	void ProcessMovement(bool forward, bool backward, bool left, bool right, float deltaTime);
+
+	const glm::mat4& GetCameraView() { UpdateMatrices(); return mView; }
+	const glm::mat4& GetCameraProjection() { UpdateMatrices(); return mProjection; }
+	const glm::mat4& GetViewProjection() { UpdateMatrices(); return mViewProjection; }
+	const glm::mat4& GetInverseView() { UpdateMatrices(); return mInverseView; }
+	const glm::mat4& GetInverseProjection() { UpdateMatrices(); return mInverseProjection; }
+	const glm::mat4& GetInverseViewProjection() { UpdateMatrices(); return mInverseViewProjection; }
+	// view-projection between the position before and after the last movement step, alpha from FrameClock
+	glm::mat4 GetInterpolatedViewProjection(float alpha);
 
-	void RecalculateViewMatrix();
+	// returns whether anything was dirty
+	bool UpdateMatrices();
+	unsigned long long GetMatrixRebuildCount() const { return mMatrixRebuilds; }
 
 private:
+	glm::mat4 BuildView(const glm::vec3& position) const;
+	void BuildProjection();
+
 	glm::mat4 mProjection;
 	glm::mat4 mView;
+	glm::mat4 mViewProjection;
+	glm::mat4 mInverseView;
+	glm::mat4 mInverseProjection;
+	glm::mat4 mInverseViewProjection;
+	bool mViewDirty = true;
+	bool mProjectionDirty = true;
+	unsigned long long mMatrixRebuilds = 0;
 
 	glm::vec3 mCameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
+	glm::vec3 mPreviousCameraPos = glm::vec3(0.0f, 0.0f, 3.0f);
 	glm::vec3 mCameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 	glm::vec3 mCameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
@@ -30,4 +63,9 @@ private:
 	float mLastX = 800.0f / 2.0;
 	float mLastY = 600.0 / 2.0;
 	float mFov = 45.0f;
-};
\ No newline at end of file
+	float mAspect;
+	glm::vec2 mViewportSize;
+	float mNear = 0.1f;
+	float mFar = 100.0f;
+	bool mReversedZ = false;
+};
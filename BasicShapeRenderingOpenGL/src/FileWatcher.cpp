@@ -0,0 +1,151 @@
+#include "FileWatcher.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+bool ReadTextFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+FileWatcher::FileWatcher(const std::vector<std::string>& paths)
+    : mPaths(paths), mRunning(true)
+{
+    mThread = std::thread(&FileWatcher::Run, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    mRunning = false;
+    if (mThread.joinable())
+        mThread.join();
+}
+
+std::vector<FileChange> FileWatcher::PollChanges()
+{
+    std::vector<FileChange> changes;
+    std::lock_guard<std::mutex> lock(mMutex);
+    changes.swap(mChanges);
+    return changes;
+}
+
+void FileWatcher::QueueChange(const std::string& path)
+{
+    FileChange change;
+    change.path = path;
+    // editors may truncate before writing, an empty read is picked up again by the next event
+    if (!ReadTextFile(path, change.contents) || change.contents.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (FileChange& queued : mChanges)
+    {
+        if (queued.path == path)
+        {
+            queued.contents = std::move(change.contents);
+            return;
+        }
+    }
+    mChanges.push_back(std::move(change));
+}
+
+#ifdef __linux__
+void FileWatcher::Run()
+{
+    int inotify = inotify_init1(IN_NONBLOCK);
+    if (inotify < 0)
+        return;
+
+    // watch the directories, editors often save by writing a new file and renaming it over the old one
+    std::vector<std::pair<int, std::filesystem::path>> directories;
+    for (const std::string& path : mPaths)
+    {
+        std::filesystem::path directory = std::filesystem::path(path).parent_path();
+        if (directory.empty())
+            directory = ".";
+
+        bool watched = false;
+        for (const auto& entry : directories)
+            watched = watched || entry.second == directory;
+        if (watched)
+            continue;
+
+        int watch = inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (watch >= 0)
+            directories.emplace_back(watch, directory);
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (mRunning)
+    {
+        // wake up regularly so the destructor doesn't wait long
+        pollfd descriptor = { inotify, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(inotify, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const inotify_event* event = (const inotify_event*)(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0)
+                continue;
+
+            for (const auto& entry : directories)
+            {
+                if (entry.first != event->wd)
+                    continue;
+                for (const std::string& path : mPaths)
+                {
+                    std::filesystem::path watchedPath(path);
+                    std::filesystem::path directory = watchedPath.parent_path();
+                    if ((directory.empty() ? std::filesystem::path(".") : directory) == entry.second
+                        && watchedPath.filename() == event->name)
+                        QueueChange(path);
+                }
+            }
+        }
+    }
+    close(inotify);
+}
+#else
+void FileWatcher::Run()
+{
+    std::vector<std::filesystem::file_time_type> modifiedTimes(mPaths.size());
+    for (size_t i = 0; i < mPaths.size(); i++)
+    {
+        std::error_code error;
+        modifiedTimes[i] = std::filesystem::last_write_time(mPaths[i], error);
+    }
+
+    while (mRunning)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        for (size_t i = 0; i < mPaths.size(); i++)
+        {
+            std::error_code error;
+            std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(mPaths[i], error);
+            if (!error && modifiedTime != modifiedTimes[i])
+            {
+                modifiedTimes[i] = modifiedTime;
+                QueueChange(mPaths[i]);
+            }
+        }
+    }
+}
+#endif
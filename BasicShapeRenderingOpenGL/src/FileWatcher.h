@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool ReadTextFile(const std::string& path, std::string& contents);
+
+struct FileChange
+{
+	std::string path;
+	std::string contents;	// read on the watcher thread so the caller never touches the disk
+};
+
+// Watches a set of files on a background thread, with inotify on Linux and by polling
+// modification times elsewhere. Changes are collected until PollChanges is called.
+class FileWatcher
+{
+public:
+	FileWatcher(const std::vector<std::string>& paths);
+	~FileWatcher();
+
+	// never blocks on the watcher thread for longer than it takes to swap a vector
+	std::vector<FileChange> PollChanges();
+
+private:
+	void Run();
+	void QueueChange(const std::string& path);
+
+	std::vector<std::string> mPaths;
+	std::vector<FileChange> mChanges;
+	std::mutex mMutex;
+	std::atomic<bool> mRunning;
+	std::thread mThread;
+};
@@ -0,0 +1,402 @@
+#include "FontAtlas.h"
+#include "AssetCache.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+    // A glyph as polylines on a grid 16 units high: the descender at 0, the baseline at 4, the
+    // x-height at 12 and the cap height at 16. Strokes are separated by spaces and every point is
+    // two base 17 digits (0-9, a-g), x then y; a single point is a dot.
+    struct StrokeGlyph
+    {
+        uint32_t codepoint;
+        float advance;      // grid units, including the spacing to the next glyph
+        const char* strokes;
+    };
+
+    const StrokeGlyph strokeGlyphs[] =
+    {
+        { ' ', 5, "" },
+        { '!', 4, "1g18 14" },
+        { '"', 7, "1g1d 4g4d" },
+        { '#', 11, "2e24 6e64 0b8b 0787" },
+        { '$', 11, "8d6f2f0d0c2a6a8887652507 4g44" },
+        { '%', 11, "048g 0g2g2e0e0g 6686846466" },
+        { '&', 11, "841b1e3g4g5e5c0806244488" },
+        { '\'', 4, "1g1d" },
+        { '(', 6, "3g1d1734" },
+        { ')', 6, "0g2d2704" },
+        { '*', 11, "4e48 1d79 197d" },
+        { '+', 11, "0a8a 4e46" },
+        { ',', 4, "1502" },
+        { '-', 9, "1a6a" },
+        { '.', 4, "14" },
+        { '/', 10, "048g" },
+        { '0', 11, "2g6g8e866424060e2g 167e" },
+        { '1', 11, "2d4g44 2464" },
+        { '2', 11, "0e2g6g8e8c0484" },
+        { '3', 11, "0e2g6g8e8c6a3a 6a8886642406" },
+        { '4', 11, "646g0888" },
+        { '5', 11, "8g0g0a6a8886642406" },
+        { '6', 11, "6g2g0e06246486886a0a" },
+        { '7', 11, "0g8g8e34" },
+        { '8', 11, "2a0c0e2g6g8e8c6a2a 2a0806246486886a" },
+        { '9', 11, "2464868e6g2g0e0c2a8a" },
+        { ':', 4, "14 1b" },
+        { ';', 4, "1502 1b" },
+        { '<', 11, "8e0a86" },
+        { '=', 11, "0c8c 0888" },
+        { '>', 11, "0e8a06" },
+        { '?', 11, "0e2g6g8e8c4947 44" },
+        { '@', 11, "686c3c2a293868898e6g2g0e062474" },
+        { 'A', 11, "044g84 1777" },
+        { 'B', 11, "040g5g7e7c5a0a 5a88866404" },
+        { 'C', 11, "8e6g2g0e06246486" },
+        { 'D', 11, "040g4g8c884404" },
+        { 'E', 11, "8g0g0484 0a6a" },
+        { 'F', 11, "8g0g04 0a6a" },
+        { 'G', 11, "8e6g2g0e062464868959" },
+        { 'H', 11, "040g 848g 0a8a" },
+        { 'I', 7, "0g4g 2g24 0444" },
+        { 'J', 11, "8g86642406" },
+        { 'K', 11, "040g 8g08 3b84" },
+        { 'L', 11, "0g0484" },
+        { 'M', 11, "040g4a8g84" },
+        { 'N', 11, "040g848g" },
+        { 'O', 11, "2g6g8e866424060e2g" },
+        { 'P', 11, "040g6g8e8c6a0a" },
+        { 'Q', 11, "2g6g8e866424060e2g 5783" },
+        { 'R', 11, "040g6g8e8c6a0a 4a84" },
+        { 'S', 11, "8e6g2g0e0c2a6a8886642406" },
+        { 'T', 11, "0g8g 4g44" },
+        { 'U', 11, "0g062464868g" },
+        { 'V', 11, "0g448g" },
+        { 'W', 11, "0g244c648g" },
+        { 'X', 11, "0g84 8g04" },
+        { 'Y', 11, "0g4a8g 4a44" },
+        { 'Z', 11, "0g8g0484" },
+        { '[', 6, "3g1g1434" },
+        { '\\', 10, "0g84" },
+        { ']', 6, "0g2g2404" },
+        { '^', 11, "0c4g8c" },
+        { '_', 10, "0181" },
+        { '`', 6, "1g3e" },
+        { 'a', 10, "1c5c7a74 782806245476" },
+        { 'b', 10, "0g04 0a2c5c7a76542406" },
+        { 'c', 10, "7a5c2c0a06245476" },
+        { 'd', 10, "7g74 7a5c2c0a06245476" },
+        { 'e', 10, "08787a5c2c0a062464" },
+        { 'f', 7, "6g4g2e24 0c5c" },
+        { 'g', 10, "7c725010 7a5c2c0a07255577" },
+        { 'h', 10, "0g04 0a2c5c7a74" },
+        { 'i', 4, "1c14 1f" },
+        { 'j', 6, "3c321000 3f" },
+        { 'k', 9, "0g04 6c07 2964" },
+        { 'l', 5, "1g1634" },
+        { 'm', 11, "0c04 0a2c3c4a44 4a6c7c8a84" },
+        { 'n', 10, "0c04 0a2c5c7a74" },
+        { 'o', 10, "2c5c7a765424060a2c" },
+        { 'p', 10, "0c00 0a2c5c7a76542406" },
+        { 'q', 10, "7c70 7a5c2c0a06245476" },
+        { 'r', 8, "0c04 093c6c" },
+        { 's', 10, "7a5c2c0a285876542406" },
+        { 't', 8, "2f264464 0c5c" },
+        { 'u', 10, "0c06245476 7c74" },
+        { 'v', 9, "0c346c" },
+        { 'w', 11, "0c244a648c" },
+        { 'x', 10, "0c74 7c04" },
+        { 'y', 10, "0c45 7c2010" },
+        { 'z', 10, "0c7c0474" },
+        { '{', 7, "4g3g2f2b1a29253444" },
+        { '|', 4, "1g10" },
+        { '}', 7, "0g1g2f2b3a29251404" },
+        { '~', 11, "0a2c4a688a" },
+        { 0xB0, 6, "1g3g4f4d3c1c0d0f1g" },      // degree sign
+        { 0xB5, 10, "0c00 06245476 7c74" },     // micro sign
+        { 0xD7, 11, "1b75 157b" },              // multiplication sign
+    };
+
+    const float unitsPerEm = 16.0f;
+    const float baselineUnits = 4.0f;
+    const float capHeightUnits = 12.0f;
+    const float lineHeightUnits = 20.0f;
+    const float leftBearingUnits = 1.0f;
+    const float strokeHalfWidth = 0.6f;     // grid units
+    // the field covers this many units on either side of the outline, room for outlines and glow
+    const float distanceRange = 2.0f;
+    const int pixelsPerUnit = 4;
+    const int atlasWidth = 512;
+
+    const unsigned int FontAtlasMagic = 0x41464453;    // "SDFA"
+
+    struct FontAtlasHeader
+    {
+        unsigned int magic;
+        int width;
+        int height;
+        int glyphCount;
+    };
+
+    struct CookedGlyph
+    {
+        uint32_t codepoint;
+        GlyphMetrics metrics;
+    };
+
+    float ParseCoordinate(char c)
+    {
+        return (float)(c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+
+    std::vector<std::vector<glm::vec2>> ParseStrokes(const char* strokes)
+    {
+        std::vector<std::vector<glm::vec2>> result(1);
+        for (const char* c = strokes; *c; )
+        {
+            if (*c == ' ')
+            {
+                result.emplace_back();
+                c++;
+                continue;
+            }
+            result.back().push_back(glm::vec2(ParseCoordinate(c[0]), ParseCoordinate(c[1])));
+            c += c[1] ? 2 : 1;
+        }
+        if (result.back().empty())
+            result.pop_back();
+        return result;
+    }
+
+    float DistanceToSegment(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b)
+    {
+        glm::vec2 ab = b - a;
+        float lengthSquared = glm::dot(ab, ab);
+        float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(p - a, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+        return glm::length(p - (a + ab * t));
+    }
+
+    // everything the rasterized atlas depends on, so changing the font or a parameter is a new cache entry
+    std::string GetFontIdentity()
+    {
+        std::string identity = std::to_string(strokeHalfWidth) + "|" + std::to_string(distanceRange) + "|"
+            + std::to_string(pixelsPerUnit) + "|" + std::to_string(atlasWidth) + "\n";
+        for (const StrokeGlyph& glyph : strokeGlyphs)
+            identity += std::to_string(glyph.codepoint) + " " + std::to_string(glyph.advance) + " " + glyph.strokes + "\n";
+        return identity;
+    }
+}
+
+FontAtlas::FontAtlas(AssetCache* cache)
+{
+    std::vector<unsigned char> pixels;
+    std::string key;
+    bool cooked = false;
+    if (cache)
+    {
+        // warm start, metrics and pixels come straight out of the mapped cache entry
+        std::string identity = GetFontIdentity();
+        key = cache->GetKey(identity.data(), identity.size(), "sdf-font-v1");
+        MappedFile file;
+        FontAtlasHeader header;
+        if (cache->Load(key, file) && file.GetSize() >= sizeof(header))
+        {
+            memcpy(&header, file.GetData(), sizeof(header));
+            size_t glyphBytes = (size_t)header.glyphCount * sizeof(CookedGlyph);
+            size_t pixelBytes = (size_t)header.width * header.height;
+            if (header.magic == FontAtlasMagic && file.GetSize() == sizeof(header) + glyphBytes + pixelBytes)
+            {
+                const unsigned char* data = file.GetData() + sizeof(header);
+                for (int i = 0; i < header.glyphCount; i++)
+                {
+                    CookedGlyph glyph;
+                    memcpy(&glyph, data + i * sizeof(CookedGlyph), sizeof(glyph));
+                    AddGlyph(glyph.codepoint, glyph.metrics);
+                }
+                pixels.assign(data + glyphBytes, data + glyphBytes + pixelBytes);
+                mWidth = header.width;
+                mHeight = header.height;
+                cooked = true;
+            }
+        }
+    }
+
+    if (!cooked)
+    {
+        Rasterize(pixels);
+        if (cache)
+        {
+            std::vector<CookedGlyph> glyphs;
+            for (const StrokeGlyph& glyph : strokeGlyphs)
+                glyphs.push_back({ glyph.codepoint, GetGlyph(glyph.codepoint) });
+            FontAtlasHeader header = { FontAtlasMagic, mWidth, mHeight, (int)glyphs.size() };
+            std::vector<unsigned char> data(sizeof(header) + glyphs.size() * sizeof(CookedGlyph) + pixels.size());
+            memcpy(data.data(), &header, sizeof(header));
+            memcpy(data.data() + sizeof(header), glyphs.data(), glyphs.size() * sizeof(CookedGlyph));
+            memcpy(data.data() + sizeof(header) + glyphs.size() * sizeof(CookedGlyph), pixels.data(), pixels.size());
+            if (!cache->Store(key, data.data(), data.size()))
+                std::cout << "Failed to cache the font atlas" << std::endl;
+        }
+    }
+
+    // a distance field filters linearly, mips keep small text from shimmering
+    mTexture.reset(new Texture(pixels.data(), mWidth, mHeight, 1, false));
+    mTexture->SetWrap(GL_CLAMP_TO_EDGE);
+}
+
+FontAtlas::~FontAtlas()
+{
+    DeleteFontAtlas();
+}
+
+void FontAtlas::AddGlyph(uint32_t codepoint, const GlyphMetrics& metrics)
+{
+    if (codepoint < 128)
+    {
+        mAscii[codepoint] = metrics;
+        mHasAscii[codepoint] = true;
+    }
+    else
+    {
+        mGlyphs[codepoint] = metrics;
+    }
+    mGlyphCount++;
+}
+
+void FontAtlas::Rasterize(std::vector<unsigned char>& pixels)
+{
+    struct Cell
+    {
+        const StrokeGlyph* glyph;
+        std::vector<std::vector<glm::vec2>> strokes;
+        glm::vec2 origin;   // grid units at the cell's lower left pixel corner
+        int width, height, x, y;
+    };
+
+    // cells cover the strokes plus the distance range, packed onto shelves tallest first
+    float padding = strokeHalfWidth + distanceRange;
+    std::vector<Cell> cells;
+    for (const StrokeGlyph& glyph : strokeGlyphs)
+    {
+        Cell cell = { &glyph, ParseStrokes(glyph.strokes), glm::vec2(0.0f), 0, 0, 0, 0 };
+        if (!cell.strokes.empty())
+        {
+            glm::vec2 low = cell.strokes[0][0], high = low;
+            for (const std::vector<glm::vec2>& stroke : cell.strokes)
+            {
+                for (const glm::vec2& point : stroke)
+                {
+                    low = glm::min(low, point);
+                    high = glm::max(high, point);
+                }
+            }
+            cell.origin = low - padding;
+            cell.width = (int)std::ceil((high.x - low.x + 2.0f * padding) * pixelsPerUnit);
+            cell.height = (int)std::ceil((high.y - low.y + 2.0f * padding) * pixelsPerUnit);
+        }
+        cells.push_back(cell);
+    }
+    std::vector<Cell*> order;
+    for (Cell& cell : cells)
+        order.push_back(&cell);
+    std::stable_sort(order.begin(), order.end(), [](const Cell* a, const Cell* b) { return a->height > b->height; });
+
+    // a pixel of gutter keeps bilinear filtering and the first mips from bleeding between glyphs
+    int x = 1, y = 1, shelfHeight = 0;
+    for (Cell* cell : order)
+    {
+        if (cell->width == 0)
+            continue;
+        if (x + cell->width + 1 > atlasWidth)
+        {
+            x = 1;
+            y += shelfHeight + 1;
+            shelfHeight = 0;
+        }
+        cell->x = x;
+        cell->y = y;
+        x += cell->width + 1;
+        shelfHeight = std::max(shelfHeight, cell->height);
+    }
+    mWidth = atlasWidth;
+    mHeight = 1;
+    while (mHeight < y + shelfHeight + 1)
+        mHeight *= 2;
+
+    // 0.5 on the outline, 0 and 1 at distanceRange outside and inside it
+    pixels.assign((size_t)mWidth * mHeight, 0);
+    float unitsPerPixel = 1.0f / pixelsPerUnit;
+    for (const Cell& cell : cells)
+    {
+        for (int row = 0; row < cell.height; row++)
+        {
+            for (int column = 0; column < cell.width; column++)
+            {
+                glm::vec2 p = cell.origin + (glm::vec2((float)column, (float)row) + 0.5f) * unitsPerPixel;
+                float distance = 1e9f;
+                for (const std::vector<glm::vec2>& stroke : cell.strokes)
+                {
+                    if (stroke.size() == 1)
+                        distance = std::min(distance, glm::length(p - stroke[0]));
+                    for (size_t i = 1; i < stroke.size(); i++)
+                        distance = std::min(distance, DistanceToSegment(p, stroke[i - 1], stroke[i]));
+                }
+                float value = glm::clamp(0.5f + (strokeHalfWidth - distance) / (2.0f * distanceRange), 0.0f, 1.0f);
+                pixels[(size_t)(cell.y + row) * mWidth + cell.x + column] = (unsigned char)(value * 255.0f + 0.5f);
+            }
+        }
+
+        GlyphMetrics metrics;
+        metrics.advance = cell.glyph->advance / unitsPerEm;
+        if (cell.width > 0)
+        {
+            metrics.offset = glm::vec2(cell.origin.x + leftBearingUnits, cell.origin.y - baselineUnits) / unitsPerEm;
+            metrics.size = glm::vec2((float)cell.width, (float)cell.height) * unitsPerPixel / unitsPerEm;
+            metrics.uvMin = glm::vec2((float)cell.x / mWidth, (float)cell.y / mHeight);
+            metrics.uvMax = glm::vec2((float)(cell.x + cell.width) / mWidth, (float)(cell.y + cell.height) / mHeight);
+        }
+        AddGlyph(cell.glyph->codepoint, metrics);
+    }
+}
+
+const GlyphMetrics& FontAtlas::GetGlyph(uint32_t codepoint) const
+{
+    if (codepoint < 128 && mHasAscii[codepoint])
+        return mAscii[codepoint];
+    std::unordered_map<uint32_t, GlyphMetrics>::const_iterator glyph = mGlyphs.find(codepoint);
+    if (glyph != mGlyphs.end())
+        return glyph->second;
+    return mAscii['?'];
+}
+
+bool FontAtlas::HasGlyph(uint32_t codepoint) const
+{
+    return codepoint < 128 ? mHasAscii[codepoint] : mGlyphs.count(codepoint) != 0;
+}
+
+float FontAtlas::GetAscent() const
+{
+    return capHeightUnits / unitsPerEm;
+}
+
+float FontAtlas::GetLineHeight() const
+{
+    return lineHeightUnits / unitsPerEm;
+}
+
+void FontAtlas::Bind(unsigned int slot)
+{
+    if (mTexture)
+        mTexture->Bind(slot);
+}
+
+void FontAtlas::DeleteFontAtlas()
+{
+    if (mTexture)
+        mTexture.reset();
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Texture.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class AssetCache;
+
+// Where a glyph is in the atlas and how it sits on the line, in ems (the font size) from the pen
+// position on the baseline, y up
+struct GlyphMetrics
+{
+	glm::vec2 offset = glm::vec2(0.0f);	// lower left corner of the glyph's quad
+	glm::vec2 size = glm::vec2(0.0f);	// 0 for glyphs without ink, like the space
+	glm::vec2 uvMin = glm::vec2(0.0f);
+	glm::vec2 uvMax = glm::vec2(0.0f);
+	float advance = 0.0f;
+};
+
+// Signed distance field atlas of the built in stroke font. Every glyph is a few polylines on a
+// small grid, rasterized once into a single channel atlas as the distance to its strokes (0.5 on
+// the outline) so it stays sharp at any size, and cooked into the asset cache so later runs only
+// map it. Covers printable ASCII plus a few symbols for stats (degree, micro, times).
+class FontAtlas
+{
+public:
+	// cache is optional, without it the atlas is rasterized every time
+	FontAtlas(AssetCache* cache = nullptr);
+	~FontAtlas();
+	FontAtlas(const FontAtlas&) = delete;
+	FontAtlas& operator=(const FontAtlas&) = delete;
+
+	// characters the font doesn't have come back as '?'
+	const GlyphMetrics& GetGlyph(uint32_t codepoint) const;
+	bool HasGlyph(uint32_t codepoint) const;
+	size_t GetGlyphCount() const { return mGlyphCount; }
+
+	// cap height and line spacing in ems
+	float GetAscent() const;
+	float GetLineHeight() const;
+
+	void Bind(unsigned int slot);
+	void DeleteFontAtlas();
+
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+
+private:
+	void AddGlyph(uint32_t codepoint, const GlyphMetrics& metrics);
+	// shelf packs and rasterizes every glyph into pixels, filling in the metrics
+	void Rasterize(std::vector<unsigned char>& pixels);
+
+	// ASCII is looked up by index, the rest in the map
+	GlyphMetrics mAscii[128];
+	bool mHasAscii[128] = {};
+	std::unordered_map<uint32_t, GlyphMetrics> mGlyphs;
+	size_t mGlyphCount = 0;
+
+	std::unique_ptr<Texture> mTexture;
+	int mWidth = 0;
+	int mHeight = 0;
+};
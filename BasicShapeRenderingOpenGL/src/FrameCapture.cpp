@@ -0,0 +1,209 @@
+#include "FrameCapture.h"
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+FrameCapture::FrameCapture(const std::string& directory, CaptureFormat format, unsigned int bufferCount, unsigned int encoderThreads)
+    : mDirectory(directory), mFormat(format), mReadbacks(bufferCount < 2 ? 2 : bufferCount)
+{
+    std::error_code error;
+    std::filesystem::create_directories(mDirectory, error);
+
+    for (Readback& readback : mReadbacks)
+        glGenBuffers(1, &readback.buffer);
+    for (unsigned int i = 0; i < (encoderThreads < 1 ? 1 : encoderThreads); i++)
+        mThreads.push_back(std::thread(&FrameCapture::Run, this));
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+void FrameCapture::Capture(int width, int height)
+{
+    mFrame++;
+    if ((!mScreenshotRequested && !mContinuous) || width <= 0 || height <= 0)
+        return;
+    mScreenshotRequested = false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // every buffer still in flight, the oldest read has to finish before its buffer can be reused
+    if (mPendingReadbacks == mReadbacks.size())
+    {
+        Resolve(mReadbacks[mOldestReadback], true);
+        mStalls++;
+    }
+
+    Readback& readback = mReadbacks[mNextReadback];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if (readback.width != width || readback.height != height)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+        readback.width = width;
+        readback.height = height;
+    }
+    // with a pack buffer bound this only queues the copy, the pointer is an offset into the buffer
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frame = mFrame;
+    readback.screenshot = !mContinuous;
+
+    mNextReadback = (mNextReadback + 1) % mReadbacks.size();
+    mPendingReadbacks++;
+    mCaptured++;
+    mCaptureMilliseconds += MillisecondsSince(start);
+}
+
+void FrameCapture::Poll()
+{
+    if (mPendingReadbacks == 0)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (mPendingReadbacks > 0 && Resolve(mReadbacks[mOldestReadback], false))
+        ;
+    mPollMilliseconds += MillisecondsSince(start);
+}
+
+bool FrameCapture::Resolve(Readback& readback, bool wait)
+{
+    GLsync fence = (GLsync)readback.fence;
+    GLenum status = glClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 100000000 : 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, 0, 100000000);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    glDeleteSync(fence);
+    readback.fence = nullptr;
+    mOldestReadback = (mOldestReadback + 1) % mReadbacks.size();
+    mPendingReadbacks--;
+
+    EncodeJob job;
+    job.frame = readback.frame;
+    job.image.width = readback.width;
+    job.image.height = readback.height;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // the encoders can't keep up, skip the frame instead of queueing without bound
+        if (!readback.screenshot && mJobs.size() >= mReadbacks.size() * 2)
+        {
+            mDropped++;
+            return true;
+        }
+        if (!mFreeImages.empty())
+        {
+            job.image.pixels.swap(mFreeImages.back());
+            mFreeImages.pop_back();
+        }
+    }
+
+    size_t size = (size_t)readback.width * readback.height * 4;
+    job.image.pixels.resize(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (data)
+    {
+        memcpy(job.image.pixels.data(), data, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!data)
+    {
+        mFailed++;
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mCondition.notify_one();
+    return true;
+}
+
+void FrameCapture::Stop()
+{
+    while (mPendingReadbacks > 0)
+        Resolve(mReadbacks[mOldestReadback], true);
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+
+    for (Readback& readback : mReadbacks)
+    {
+        glDeleteBuffers(1, &readback.buffer);
+        readback.buffer = 0;
+    }
+}
+
+void FrameCapture::Run()
+{
+    while (true)
+    {
+        EncodeJob job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return !mJobs.empty() || !mRunning; });
+            // whatever is queued is still written when stopping
+            if (mJobs.empty())
+                return;
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::ostringstream path;
+        path << mDirectory << "/frame_" << std::setw(6) << std::setfill('0') << job.frame << (mFormat == CaptureFormatPNG ? ".png" : ".ppm");
+        bool written = mFormat == CaptureFormatPNG ? job.image.WritePNG(path.str()) : job.image.WritePPM(path.str());
+        double milliseconds = MillisecondsSince(start);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (written)
+            mEncoded++;
+        else
+            mFailed++;
+        mEncodeMilliseconds += milliseconds;
+        mFreeImages.push_back(std::move(job.image.pixels));
+    }
+}
+
+void FrameCapture::Report() const
+{
+    if (mCaptured == 0)
+        return;
+
+    std::cout << "Frame capture: " << mCaptured << " frames captured, " << mEncoded << " written to " << mDirectory << ", "
+        << mDropped << " dropped, " << mFailed << " failed, " << mStalls << " stalls" << std::endl;
+    std::cout << "  GL thread " << (mCaptureMilliseconds + mPollMilliseconds) / mCaptured << " ms per captured frame (read "
+        << mCaptureMilliseconds / mCaptured << " ms, map and copy " << mPollMilliseconds / mCaptured << " ms), encoding "
+        << (mEncoded ? mEncodeMilliseconds / mEncoded : 0.0) << " ms per image on " << mThreads.size() << " workers" << std::endl;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "SoftwareRasterizer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum CaptureFormat
+{
+	CaptureFormatPNG,
+	CaptureFormatRaw	// binary PPM, nothing to compress
+};
+
+// Screenshots and continuous capture without stalling on glReadPixels. Capture starts a read of
+// the bound read framebuffer into the next pixel pack buffer of a ring and fences it, Poll maps
+// the buffers whose fence has signalled (a couple of frames later) and copies them out, and a
+// worker thread encodes and writes the images. Only when every buffer of the ring is still in
+// flight does Capture wait for the oldest one. Continuous capture drops frames while the encoders
+// are behind, screenshots are always written.
+class FrameCapture
+{
+public:
+	FrameCapture(const std::string& directory, CaptureFormat format = CaptureFormatPNG, unsigned int bufferCount = 3, unsigned int encoderThreads = 2);
+	~FrameCapture();
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// captures the next frame only
+	void RequestScreenshot() { mScreenshotRequested = true; }
+	// captures every frame until switched off
+	void SetContinuous(bool continuous) { mContinuous = continuous; }
+	bool IsContinuous() const { return mContinuous; }
+
+	// call once the frame is drawn, before swapping buffers
+	void Capture(int width, int height);
+	// hands finished reads to the encoder, never blocks
+	void Poll();
+	// waits for every read and the encoder, then deletes the buffers; the context must be current
+	void Stop();
+
+	void Report() const;
+
+private:
+	struct Readback
+	{
+		unsigned int buffer = 0;
+		void* fence = nullptr;	// GLsync, kept opaque so the header doesn't need glad
+		int width = 0;
+		int height = 0;
+		unsigned long long frame = 0;
+		bool screenshot = false;
+	};
+	struct EncodeJob
+	{
+		SoftwareImage image;
+		unsigned long long frame = 0;
+	};
+
+	// false when not waiting and the read hasn't finished yet
+	bool Resolve(Readback& readback, bool wait);
+	void Run();
+
+	std::string mDirectory;
+	CaptureFormat mFormat;
+	bool mScreenshotRequested = false;
+	bool mContinuous = false;
+	unsigned long long mFrame = 0;
+
+	std::vector<Readback> mReadbacks;
+	unsigned int mNextReadback = 0;
+	unsigned int mOldestReadback = 0;
+	unsigned int mPendingReadbacks = 0;
+
+	// the workers take jobs in order, their pixel vectors come back through mFreeImages for reuse
+	std::deque<EncodeJob> mJobs;
+	std::vector<std::vector<unsigned char>> mFreeImages;
+	bool mRunning = true;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::vector<std::thread> mThreads;
+
+	// stats, GL thread time covers Capture and Poll
+	unsigned long long mCaptured = 0;
+	unsigned long long mEncoded = 0;
+	unsigned long long mStalls = 0;
+	unsigned long long mDropped = 0;
+	unsigned long long mFailed = 0;
+	double mCaptureMilliseconds = 0.0;
+	double mPollMilliseconds = 0.0;
+	double mEncodeMilliseconds = 0.0;
+};
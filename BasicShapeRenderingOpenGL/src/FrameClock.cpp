@@ -0,0 +1,127 @@
+#include "FrameClock.h"
+
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    // how long before the deadline the limiter stops sleeping and starts spinning
+    const int64_t spinNanoseconds = 2000000;
+    // frames the swap interval controller looks at before deciding
+    const unsigned int swapIntervalWindow = 60;
+}
+
+FrameClock::FrameClock(double stepSeconds, unsigned int maxStepsPerFrame)
+    : mStart(Now()), mStep((int64_t)(stepSeconds * 1e9)), mMaxStepsPerFrame(maxStepsPerFrame)
+{
+    mFrameStart = mStart;
+    if (mStep < 1)
+        mStep = 1;
+}
+
+int64_t FrameClock::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned int FrameClock::Tick()
+{
+    int64_t now = Now();
+    mFrameDuration = now - mFrameStart;
+    mFrameStart = now;
+    mAccumulator += mFrameDuration;
+
+    unsigned int steps = (unsigned int)(mAccumulator / mStep);
+    mAccumulator -= (int64_t)steps * mStep;
+    if (steps > mMaxStepsPerFrame)
+    {
+        mDroppedSteps += steps - mMaxStepsPerFrame;
+        steps = mMaxStepsPerFrame;
+    }
+    mSteps += steps;
+
+    // the first tick only measures the time spent loading
+    if (mFrames++ == 0)
+        return steps;
+
+    double frameMilliseconds = (double)mFrameDuration * 1e-6;
+    mFrameMillisecondsSum += frameMilliseconds;
+    mFrameMillisecondsSquaredSum += frameMilliseconds * frameMilliseconds;
+    if (frameMilliseconds > mLongestFrameMilliseconds)
+        mLongestFrameMilliseconds = frameMilliseconds;
+
+    // a little slack, vsynced frames land on either side of the refresh interval
+    bool missed = mDeadline > 0 && mFrameDuration > mDeadline + mDeadline / 10;
+    if (missed)
+        mMissedDeadlines++;
+    mRecentMisses += missed ? 1 : 0;
+    mRecentFrames++;
+    if (mFrameDuration > mRecentLongest)
+        mRecentLongest = mFrameDuration;
+    return steps;
+}
+
+void FrameClock::SetFrameDeadline(double seconds)
+{
+    mDeadline = (int64_t)(seconds * 1e9);
+}
+
+void FrameClock::SetFrameLimit(double framesPerSecond)
+{
+    mFrameLimit = framesPerSecond > 0.0 ? (int64_t)(1e9 / framesPerSecond) : 0;
+    mNextFrame = 0;
+    if (mFrameLimit > 0 && mDeadline == 0)
+        mDeadline = mFrameLimit;
+}
+
+void FrameClock::WaitForNextFrame()
+{
+    if (mFrameLimit == 0)
+        return;
+
+    int64_t now = Now();
+    // deadlines advance by whole intervals so the average rate stays exact, after a long frame start over
+    if (mNextFrame == 0 || now - mNextFrame > mFrameLimit)
+        mNextFrame = now;
+    mNextFrame += mFrameLimit;
+
+    int64_t remaining = mNextFrame - now;
+    if (remaining > spinNanoseconds)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - spinNanoseconds));
+    while (Now() < mNextFrame)
+        std::this_thread::yield();
+}
+
+int FrameClock::UpdateSwapInterval()
+{
+    if (mAdaptiveVsync)
+        return mSwapInterval = -1;
+    if (mDeadline == 0 || mRecentFrames < swapIntervalWindow)
+        return mSwapInterval;
+
+    // stop syncing once a tenth of the frames miss, sync again when every frame of a window had headroom
+    if (mSwapInterval == 1 && mRecentMisses * 10 >= mRecentFrames)
+        mSwapInterval = 0;
+    else if (mSwapInterval == 0 && mRecentLongest < mDeadline - mDeadline / 5)
+        mSwapInterval = 1;
+
+    mRecentMisses = 0;
+    mRecentFrames = 0;
+    mRecentLongest = 0;
+    return mSwapInterval;
+}
+
+void FrameClock::Report() const
+{
+    if (mFrames < 2)
+        return;
+
+    double frames = (double)(mFrames - 1);
+    double mean = mFrameMillisecondsSum / frames;
+    double jitter = std::sqrt(std::fmax(0.0, mFrameMillisecondsSquaredSum / frames - mean * mean));
+    std::cout << "Frame clock: " << mFrames - 1 << " frames, " << mean << " ms mean, " << jitter << " ms jitter, "
+        << mLongestFrameMilliseconds << " ms longest, " << mMissedDeadlines << " missed deadlines" << std::endl;
+    std::cout << "  " << mSteps << " fixed steps of " << GetStepSeconds() * 1000.0 << " ms, " << mDroppedSteps << " dropped after hitches, swap interval "
+        << mSwapInterval << std::endl;
+}
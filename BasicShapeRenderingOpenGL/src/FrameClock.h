@@ -0,0 +1,70 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Monotonic frame clock with a 64 bit nanosecond time base, so times stay exact however long
+// the program runs. The simulation advances in fixed steps, Tick returns how many to run and
+// GetAlpha how far the render time is between the last two steps for interpolation.
+// The limiter sleeps until shortly before the deadline and spins for the rest, since sleeps
+// routinely overshoot by a millisecond or more.
+class FrameClock
+{
+public:
+	FrameClock(double stepSeconds = 1.0 / 120.0, unsigned int maxStepsPerFrame = 8);
+
+	// advances to the current time and returns the number of fixed steps to simulate, after a
+	// hitch no more than maxStepsPerFrame are run and the rest of the backlog is dropped
+	unsigned int Tick();
+
+	// seconds since the clock was created, as of the last Tick
+	double GetTime() const { return ToSeconds(mFrameStart - mStart); }
+	double GetStepSeconds() const { return ToSeconds(mStep); }
+	// 0 at the last simulated step, approaching 1 just before the next one
+	float GetAlpha() const { return (float)((double)mAccumulator / (double)mStep); }
+	double GetFrameSeconds() const { return ToSeconds(mFrameDuration); }
+
+	// frames longer than this count as missed, usually the refresh interval
+	void SetFrameDeadline(double seconds);
+	// caps the frame rate, 0 leaves pacing to vsync
+	void SetFrameLimit(double framesPerSecond);
+	void WaitForNextFrame();
+
+	// picks a swap interval from recent misses: -1 when the driver supports adaptive vsync,
+	// otherwise 1 while frames make the deadline and 0 (tearing instead of halving the rate) while they don't
+	void SetAdaptiveVsyncSupported(bool supported) { mAdaptiveVsync = supported; }
+	int UpdateSwapInterval();
+
+	void Report() const;
+
+	// steady clock nanoseconds, the time base for input timestamps as well
+	static int64_t Now();
+
+private:
+	static double ToSeconds(int64_t nanoseconds) { return (double)nanoseconds * 1e-9; }
+
+	int64_t mStart;
+	int64_t mFrameStart;
+	int64_t mFrameDuration = 0;
+	int64_t mStep;
+	int64_t mAccumulator = 0;
+	unsigned int mMaxStepsPerFrame;
+
+	int64_t mFrameLimit = 0;
+	int64_t mNextFrame = 0;
+	int64_t mDeadline = 0;
+
+	bool mAdaptiveVsync = false;
+	int mSwapInterval = 1;
+	unsigned int mRecentMisses = 0;		// in the current window of frames
+	unsigned int mRecentFrames = 0;
+	int64_t mRecentLongest = 0;
+
+	// pacing stats
+	unsigned long long mFrames = 0;
+	unsigned long long mSteps = 0;
+	unsigned long long mDroppedSteps = 0;
+	unsigned long long mMissedDeadlines = 0;
+	double mFrameMillisecondsSum = 0.0;
+	double mFrameMillisecondsSquaredSum = 0.0;
+	double mLongestFrameMilliseconds = 0.0;
+};
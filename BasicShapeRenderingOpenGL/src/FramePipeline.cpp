@@ -0,0 +1,150 @@
+#include "FramePipeline.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+namespace
+{
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+FramePipeline::FramePipeline(BuildFunction build, bool threaded, unsigned int framesInFlight)
+    : mBuild(std::move(build)), mThreaded(threaded), mFramesInFlight(framesInFlight < 1 ? 1 : framesInFlight)
+{
+    if (mThreaded)
+        mThread = std::thread(&FramePipeline::Run, this);
+}
+
+FramePipeline::~FramePipeline()
+{
+    Stop();
+}
+
+void FramePipeline::BeginFrame(const FrameInput& input)
+{
+    if (!mThreaded)
+    {
+        mInput = input;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mInput = input;
+        mRequested = true;
+    }
+    mCondition.notify_all();
+}
+
+FramePacket& FramePipeline::AcquireFrame()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (mFrames == 0)
+        mFirstFrame = start;
+
+    unsigned int slot = mBuildSlot;
+    if (mThreaded)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mReady; });
+        mReady = false;
+    }
+    else
+    {
+        mBuild(mInput, mPackets[slot]);
+        mBuildMilliseconds += MillisecondsSince(start);
+    }
+    // the next BeginFrame builds into the other packet while this one is submitted
+    mBuildSlot ^= 1;
+
+    mAcquired = std::chrono::steady_clock::now();
+    if (mThreaded)
+        mAcquireWaitMilliseconds += std::chrono::duration<double, std::milli>(mAcquired - start).count();
+    return mPackets[slot];
+}
+
+void FramePipeline::EndFrame()
+{
+    mSubmitMilliseconds += MillisecondsSince(mAcquired);
+
+    mFences.push_back(GetRenderDevice().FenceSync());
+    std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+    while (mFences.size() > mFramesInFlight)
+    {
+        GLsync fence = (GLsync)mFences.front();
+        // the flush bit makes sure the fence actually reaches the GPU, otherwise this could wait forever
+        while (GetRenderDevice().ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+        GetRenderDevice().DeleteSync(fence);
+        mFences.pop_front();
+    }
+    mFenceWaitMilliseconds += MillisecondsSince(waitStart);
+
+    mLastFrame = std::chrono::steady_clock::now();
+    mFrames++;
+}
+
+void FramePipeline::Stop()
+{
+    if (mThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mRunning = false;
+        }
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    for (void* fence : mFences)
+        GetRenderDevice().DeleteSync((GLsync)fence);
+    mFences.clear();
+}
+
+void FramePipeline::Run()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [this] { return mRequested || !mRunning; });
+        if (!mRunning)
+            return;
+        mRequested = false;
+        FrameInput input = mInput;
+        FramePacket& packet = mPackets[mBuildSlot];
+
+        // the GL thread only touches the other packet until it acquires this one
+        lock.unlock();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        mBuild(input, packet);
+        double buildMilliseconds = MillisecondsSince(start);
+        lock.lock();
+
+        mBuildMilliseconds += buildMilliseconds;
+        mReady = true;
+        mCondition.notify_all();
+    }
+}
+
+void FramePipeline::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    double frames = (double)mFrames;
+    double totalMilliseconds = std::chrono::duration<double, std::milli>(mLastFrame - mFirstFrame).count();
+    double frameMilliseconds = totalMilliseconds / frames;
+    double buildMilliseconds = mBuildMilliseconds / frames;
+    double submitMilliseconds = mSubmitMilliseconds / frames;
+
+    std::cout << "Frame pipeline (" << (mThreaded ? "threaded" : "serial") << ", " << mFramesInFlight << " frames in flight): "
+        << mFrames << " frames, " << frameMilliseconds << " ms/frame (" << 1000.0 / frameMilliseconds << " fps)" << std::endl;
+    std::cout << "  build " << buildMilliseconds << " ms, submit " << submitMilliseconds << " ms, waiting on worker "
+        << mAcquireWaitMilliseconds / frames << " ms, waiting on fences " << mFenceWaitMilliseconds / frames << " ms" << std::endl;
+}
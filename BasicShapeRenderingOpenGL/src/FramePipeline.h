@@ -0,0 +1,87 @@
+#pragma once
+#include "UniformBuffer.h"
+#include "InputQueue.h"
+#include "ShapeRenderer.h"
+#include "Occlusion.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Input collected on the GL thread (GLFW callbacks only run there) and handed to the worker
+struct FrameInput
+{
+	double time = 0.0;		// FrameClock time, seconds since startup
+	unsigned int steps = 0;	// fixed simulation steps to run this frame
+	double stepSeconds = 0.0;
+	float alpha = 0.0f;		// interpolation between the last two steps
+	std::vector<InputEvent> events;	// everything since the last frame, in order
+};
+
+// Everything the GL thread needs to submit a frame, no GL calls are made while building it
+struct FramePacket
+{
+	FrameInput input;
+	FrameUniforms frameUniforms;
+	std::vector<DrawUniforms> draws;
+	std::vector<OcclusionBounds> drawBounds;	// of each draw's quad, for the occlusion culler
+	ShapeBatch shapes;
+	int64_t inputTimestamp = 0;	// oldest input event the frame reacts to, 0 for none
+};
+
+// Two stage frame loop: while the GL thread submits frame N the worker runs the update and
+// builds the packet for frame N+1. A fence is inserted after every submitted frame and the GL
+// thread waits on the oldest one once more than framesInFlight frames are queued on the GPU.
+// With threaded set to false the packet is built inline in AcquireFrame, for comparison.
+class FramePipeline
+{
+public:
+	using BuildFunction = std::function<void(const FrameInput&, FramePacket&)>;
+
+	FramePipeline(BuildFunction build, bool threaded = true, unsigned int framesInFlight = 2);
+	~FramePipeline();
+
+	// starts building the next frame, must alternate with AcquireFrame
+	void BeginFrame(const FrameInput& input);
+	// waits for the frame started by the last BeginFrame, valid until the next AcquireFrame
+	FramePacket& AcquireFrame();
+	// call once the frame's commands are issued, before swapping buffers
+	void EndFrame();
+	// joins the worker and deletes the fences, call while the context is still current
+	void Stop();
+
+	void Report() const;
+
+private:
+	void Run();
+
+	BuildFunction mBuild;
+	bool mThreaded;
+	unsigned int mFramesInFlight;
+
+	FramePacket mPackets[2];
+	FrameInput mInput;
+	unsigned int mBuildSlot = 0;
+	bool mRequested = false;
+	bool mReady = false;
+	bool mRunning = true;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::thread mThread;
+
+	std::deque<void*> mFences;	// GLsync, kept opaque so the header doesn't need glad
+
+	// stats, build time is measured on the worker, the rest on the GL thread
+	unsigned long long mFrames = 0;
+	double mBuildMilliseconds = 0.0;
+	double mAcquireWaitMilliseconds = 0.0;
+	double mSubmitMilliseconds = 0.0;
+	double mFenceWaitMilliseconds = 0.0;
+	std::chrono::steady_clock::time_point mFirstFrame;
+	std::chrono::steady_clock::time_point mAcquired;
+	std::chrono::steady_clock::time_point mLastFrame;
+};
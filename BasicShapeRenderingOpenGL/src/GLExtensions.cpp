@@ -0,0 +1,72 @@
+#include "GLExtensions.h"
+
+#include <cstring>
+
+GLExtensions glExtensions;
+
+bool HasGLExtension(const char* name)
+{
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+void LoadGLExtensions(GLADloadproc load)
+{
+    glExtensions.EXT_texture_compression_s3tc = HasGLExtension("GL_EXT_texture_compression_s3tc");
+
+    if (HasGLExtension("GL_ARB_bindless_texture"))
+    {
+        glExtensions.GetTextureHandleARB = (PFNGLGETTEXTUREHANDLEARBPROC)load("glGetTextureHandleARB");
+        glExtensions.MakeTextureHandleResidentARB = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)load("glMakeTextureHandleResidentARB");
+        glExtensions.MakeTextureHandleNonResidentARB = (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)load("glMakeTextureHandleNonResidentARB");
+        glExtensions.UniformHandleui64ARB = (PFNGLUNIFORMHANDLEUI64ARBPROC)load("glUniformHandleui64ARB");
+        glExtensions.ProgramUniformHandleui64ARB = (PFNGLPROGRAMUNIFORMHANDLEUI64ARBPROC)load("glProgramUniformHandleui64ARB");
+
+        glExtensions.ARB_bindless_texture = glExtensions.GetTextureHandleARB && glExtensions.MakeTextureHandleResidentARB
+            && glExtensions.MakeTextureHandleNonResidentARB && glExtensions.UniformHandleui64ARB;
+    }
+
+    if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+    {
+        glExtensions.MaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+        glExtensions.KHR_parallel_shader_compile = glExtensions.MaxShaderCompilerThreadsKHR != nullptr;
+    }
+
+    // glad only loads the 4.1 entry points on a 4.1 context, the extension exposes the same names
+    if (HasGLExtension("GL_ARB_separate_shader_objects") || GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1))
+    {
+        if (!glad_glProgramUniform1i)
+        {
+            glad_glProgramUniform1i = (PFNGLPROGRAMUNIFORM1IPROC)load("glProgramUniform1i");
+            glad_glProgramUniform1f = (PFNGLPROGRAMUNIFORM1FPROC)load("glProgramUniform1f");
+            glad_glProgramUniform3fv = (PFNGLPROGRAMUNIFORM3FVPROC)load("glProgramUniform3fv");
+            glad_glProgramUniform4fv = (PFNGLPROGRAMUNIFORM4FVPROC)load("glProgramUniform4fv");
+            glad_glProgramUniformMatrix3fv = (PFNGLPROGRAMUNIFORMMATRIX3FVPROC)load("glProgramUniformMatrix3fv");
+            glad_glProgramUniformMatrix4fv = (PFNGLPROGRAMUNIFORMMATRIX4FVPROC)load("glProgramUniformMatrix4fv");
+        }
+        glExtensions.ARB_separate_shader_objects = glad_glProgramUniform1i && glad_glProgramUniform1f && glad_glProgramUniform3fv
+            && glad_glProgramUniform4fv && glad_glProgramUniformMatrix3fv && glad_glProgramUniformMatrix4fv;
+    }
+
+    if (HasGLExtension("GL_ARB_clip_control") || GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 5))
+    {
+        glExtensions.ClipControl = (PFNGLCLIPCONTROLPROC)load("glClipControl");
+        glExtensions.ARB_clip_control = glExtensions.ClipControl != nullptr;
+    }
+
+    glExtensions.ARB_ES3_compatibility = HasGLExtension("GL_ARB_ES3_compatibility") || GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+
+    if (HasGLExtension("GL_ARB_draw_indirect") || GLVersion.major >= 4)
+    {
+        glExtensions.DrawArraysIndirect = (PFNGLDRAWARRAYSINDIRECTPROC)load("glDrawArraysIndirect");
+        glExtensions.ARB_draw_indirect = glExtensions.DrawArraysIndirect != nullptr;
+    }
+    glExtensions.ARB_query_buffer_object = HasGLExtension("GL_ARB_query_buffer_object") || GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+
+// glad was generated for the 4.6 core profile with no extensions, so the few
+// extensions we make use of are queried and loaded here once glad is ready.
+
+// ARB_bindless_texture
+typedef GLuint64(APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC)(GLuint texture);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC)(GLuint64 handle);
+typedef void(APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC)(GLuint64 handle);
+typedef void(APIENTRYP PFNGLUNIFORMHANDLEUI64ARBPROC)(GLint location, GLuint64 value);
+typedef void(APIENTRYP PFNGLPROGRAMUNIFORMHANDLEUI64ARBPROC)(GLuint program, GLint location, GLuint64 value);
+
+// EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// KHR_parallel_shader_compile
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+struct GLExtensions
+{
+	bool EXT_texture_compression_s3tc = false;
+
+	bool ARB_bindless_texture = false;
+	PFNGLGETTEXTUREHANDLEARBPROC GetTextureHandleARB = nullptr;
+	PFNGLMAKETEXTUREHANDLERESIDENTARBPROC MakeTextureHandleResidentARB = nullptr;
+	PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC MakeTextureHandleNonResidentARB = nullptr;
+	PFNGLUNIFORMHANDLEUI64ARBPROC UniformHandleui64ARB = nullptr;
+	PFNGLPROGRAMUNIFORMHANDLEUI64ARBPROC ProgramUniformHandleui64ARB = nullptr;
+
+	bool KHR_parallel_shader_compile = false;
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC MaxShaderCompilerThreadsKHR = nullptr;
+
+	// core in 4.1, without it uniforms can only be set on the bound program
+	bool ARB_separate_shader_objects = false;
+
+	// core in 4.5, the window asks for 3.3 so it may only be there as the extension
+	bool ARB_clip_control = false;
+	PFNGLCLIPCONTROLPROC ClipControl = nullptr;
+
+	// core in 4.3, for GL_ANY_SAMPLES_PASSED_CONSERVATIVE queries
+	bool ARB_ES3_compatibility = false;
+
+	// core in 4.0 and 4.4, together they let the GPU write a draw's instance count from a query
+	bool ARB_draw_indirect = false;
+	PFNGLDRAWARRAYSINDIRECTPROC DrawArraysIndirect = nullptr;
+	bool ARB_query_buffer_object = false;
+};
+
+extern GLExtensions glExtensions;
+
+// call after gladLoadGLLoader with the same loader
+void LoadGLExtensions(GLADloadproc load);
+bool HasGLExtension(const char* name);
@@ -0,0 +1,473 @@
+#include "HiZ.h"
+#include "RenderTarget.h"
+#include "RenderDevice.h"
+#include "Shader.h"
+#include "ShapeRenderer.h"
+#include "GLExtensions.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+
+namespace
+{
+    // the cull pass never rasterizes, the program only needs a fragment stage to link everywhere
+    const char* cullFragmentShaderSource = "#version 330 core\nvoid main()\n{\n}\n";
+    // frames of queries in flight before Build has to wait for the oldest
+    const unsigned int queryFrames = 4;
+    const char* stageNames[HiZStageCount] = { "pyramid", "cull", "draw" };
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+HiZCuller::HiZCuller(const std::string& reduceVertexSource, const std::string& reduceFragmentSource, const std::string& cullVertexSource,
+    const std::string& cullGeometrySource, HiZDrawMode drawMode, bool reversedZ)
+    : mDrawMode(drawMode), mReversedZ(reversedZ), mQueries(queryFrames)
+{
+    RenderDevice& device = GetRenderDevice();
+    mReduceShader.reset(new Shader(reduceVertexSource.c_str(), reduceFragmentSource.c_str()));
+    mReduceShader->Link();
+    mReduceShader->UseProgram();
+    mReduceShader->SetUniformInt("source", 0);
+    mReduceShader->SetUniformInt("reversedZ", reversedZ);
+
+    mCullShader = BuildCullShader(cullVertexSource, cullGeometrySource);
+    mCullShader->UseProgram();
+    mCullShader->SetUniformInt("hiZ", 0);
+    mCullShader->SetUniformInt("reversedZ", reversedZ);
+
+    mVertexArray = device.GenVertexArray();
+    mCullVertexArray = device.GenVertexArray();
+
+    // count, instance count, first and a reserved 0; the instance count is written by the query
+    const GLuint command[4] = { 0, 0, 0, 0 };
+    mIndirectBuffer = device.GenBuffer();
+    device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    device.BufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+    device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    for (unsigned int i = 0; i < mQueries.size(); i++)
+    {
+        FrameQueries& queries = mQueries[i];
+        if (BufferSlot(i) == i)
+            queries.visibleBuffer = device.GenBuffer();
+        queries.visible = device.GenQuery();
+        for (unsigned int& timer : queries.timers)
+            timer = device.GenQuery();
+    }
+}
+
+HiZCuller::~HiZCuller()
+{
+    DeleteHiZCuller();
+}
+
+std::unique_ptr<Shader> HiZCuller::BuildCullShader(const std::string& cullVertexSource, const std::string& cullGeometrySource)
+{
+    // the visible shapes come out exactly as they went in, 32 bytes as two uvec4s
+    std::unique_ptr<Shader> shader(new Shader(cullVertexSource.c_str(), cullFragmentShaderSource));
+    shader->SetGeometryShader(cullGeometrySource.c_str());
+    shader->SetTransformFeedbackVaryings({ "ShapeWords0", "ShapeWords1" });
+    shader->BeginLink();
+    return shader;
+}
+
+void HiZCuller::Reload(const std::string& reduceVertexSource, const std::string& reduceFragmentSource, const std::string& cullVertexSource,
+    const std::string& cullGeometrySource)
+{
+    // a reload still building is superseded, destroying it deletes its program and stages
+    mReduceReload.shader.reset(new Shader(reduceVertexSource.c_str(), reduceFragmentSource.c_str()));
+    mReduceReload.shader->BeginLink();
+    mReduceReload.updates = 0;
+    mCullReload.shader = BuildCullShader(cullVertexSource, cullGeometrySource);
+    mCullReload.updates = 0;
+}
+
+void HiZCuller::Update()
+{
+    if (mReduceReload.shader && FinishReload(mReduceReload, mReduceShader, "reduction"))
+        mReduceReload.shader.reset();
+    if (mCullReload.shader && FinishReload(mCullReload, mCullShader, "cull"))
+        mCullReload.shader.reset();
+}
+
+bool HiZCuller::FinishReload(PendingReload& reload, std::unique_ptr<Shader>& shader, const char* name)
+{
+    // without the extension there's no way to ask, so give the driver a frame and take the stall then
+    reload.updates++;
+    if (!reload.shader->IsLinkComplete() && (glExtensions.KHR_parallel_shader_compile || reload.updates < 2))
+        return false;
+
+    reload.shader->FinishLink();
+    if (!reload.shader->IsLinked())
+    {
+        std::cout << "Hi-Z " << name << " shader failed to reload, keeping the previous program" << std::endl;
+        return true;
+    }
+    // the uniforms set on the previous program carry over
+    shader->SwapProgram(*reload.shader);
+    std::cout << "Hi-Z " << name << " shader reloaded" << std::endl;
+    return true;
+}
+
+void HiZCuller::CreatePyramid(int width, int height)
+{
+    RenderDevice& device = GetRenderDevice();
+    DeletePyramid();
+    mWidth = width;
+    mHeight = height;
+
+    // the depth buffer single sampled, as a texture the reduction can read
+    mDepthTexture = device.GenTexture();
+    device.BindTexture(GL_TEXTURE_2D, mDepthTexture);
+    device.TexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mDepthFramebuffer = device.GenFramebuffer();
+    device.BindFramebuffer(GL_FRAMEBUFFER, mDepthFramebuffer);
+    device.FramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+    // depth only, a 3.3 framebuffer is incomplete while it draws to a missing color attachment
+    device.DrawBuffer(GL_NONE);
+    if (device.CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Hi-Z depth copy " << width << "x" << height << " is not complete" << std::endl;
+
+    // level 0 is half the depth buffer, down to 1x1
+    int levelWidth = std::max(width / 2, 1);
+    int levelHeight = std::max(height / 2, 1);
+    mLevels = 1;
+    while ((levelWidth >> mLevels) > 0 || (levelHeight >> mLevels) > 0)
+        mLevels++;
+    mPyramid = device.GenTexture();
+    device.BindTexture(GL_TEXTURE_2D, mPyramid);
+    device.TexStorage2D(GL_TEXTURE_2D, mLevels, GL_R32F, levelWidth, levelHeight);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    mReduceFramebuffer = device.GenFramebuffer();
+    device.BindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HiZCuller::Build(RenderTarget& depthTarget)
+{
+    RenderDevice& device = GetRenderDevice();
+    mFrame++;
+    mFrames++;
+
+    // whatever finished since, then the next queries of the ring, waiting only when they're still in flight
+    for (FrameQueries& queries : mQueries)
+    {
+        if (queries.pending)
+            Resolve(queries, false);
+    }
+    mCurrent = (mCurrent + 1) % mQueries.size();
+    FrameQueries& queries = mQueries[mCurrent];
+    if (queries.pending)
+    {
+        Resolve(queries, true);
+        mStalls++;
+    }
+    std::fill(std::begin(queries.timed), std::end(queries.timed), false);
+    queries.shapeCount = 0;
+    queries.counted = false;
+    queries.frame = mFrame;
+
+    BeginStage(HiZStagePyramid);
+    int width = depthTarget.GetWidth();
+    int height = depthTarget.GetHeight();
+    if (width != mWidth || height != mHeight)
+        CreatePyramid(width, height);
+
+    // with MSAA the blit takes one of the samples
+    device.BindFramebuffer(GL_READ_FRAMEBUFFER, depthTarget.GetFramebuffer());
+    device.BindFramebuffer(GL_DRAW_FRAMEBUFFER, mDepthFramebuffer);
+    device.BlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // every level from the one above it, which is made the only level so it's never read and written at once
+    device.BindFramebuffer(GL_FRAMEBUFFER, mReduceFramebuffer);
+    mReduceShader->UseProgram();
+    device.BindVertexArray(mVertexArray);
+    int levelWidth = width;
+    int levelHeight = height;
+    for (int level = 0; level < mLevels; level++)
+    {
+        levelWidth = std::max(levelWidth / 2, 1);
+        levelHeight = std::max(levelHeight / 2, 1);
+        if (level == 0)
+        {
+            device.BindTextureUnit(0, mDepthTexture);
+        }
+        else
+        {
+            device.BindTexture(GL_TEXTURE_2D, mPyramid);
+            device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            device.BindTextureUnit(0, mPyramid);
+        }
+        device.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mPyramid, level);
+        device.Viewport(0, 0, levelWidth, levelHeight);
+        device.DrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    device.BindTexture(GL_TEXTURE_2D, mPyramid);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mLevels - 1);
+    device.BindTexture(GL_TEXTURE_2D, 0);
+    depthTarget.Bind();
+    EndStage(HiZStagePyramid);
+}
+
+void HiZCuller::Cull(unsigned int instanceBuffer, size_t shapeCount)
+{
+    if (shapeCount == 0)
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    FrameQueries& queries = mQueries[mCurrent];
+    FrameQueries& target = mQueries[BufferSlot(mCurrent)];
+    BeginStage(HiZStageCull);
+    if (target.capacity < shapeCount)
+    {
+        target.capacity = std::max(target.capacity * 2, shapeCount);
+        device.BindBuffer(GL_ARRAY_BUFFER, target.visibleBuffer);
+        device.BufferData(GL_ARRAY_BUFFER, target.capacity * sizeof(ShapeInstance), NULL, GL_DYNAMIC_COPY);
+    }
+
+    // not instanced: one vertex, and one invocation, per shape
+    device.BindVertexArray(mCullVertexArray);
+    if (instanceBuffer != mInputBuffer)
+    {
+        mInputBuffer = instanceBuffer;
+        GLsizei stride = sizeof(ShapeInstance);
+        device.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        device.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, center));
+        device.VertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, halfSize));
+        device.VertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, params));
+        device.VertexAttribIPointer(3, 2, GL_UNSIGNED_SHORT, stride, offsetof(ShapeInstance, rotation));
+        device.VertexAttribIPointer(4, 4, GL_UNSIGNED_INT, stride, 0);
+        device.VertexAttribIPointer(5, 4, GL_UNSIGNED_INT, stride, 4 * sizeof(GLuint));
+        for (GLuint attribute = 0; attribute <= 5; attribute++)
+            device.EnableVertexAttribArray(attribute);
+    }
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    mCullShader->UseProgram();
+    mCullShader->SetUniformInt("hiZLevels", mLevels);
+    mCullShader->SetUniformInt("depthWidth", mWidth);
+    mCullShader->SetUniformInt("depthHeight", mHeight);
+    device.BindTextureUnit(0, mPyramid);
+
+    device.Enable(GL_RASTERIZER_DISCARD);
+    device.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, target.visibleBuffer);
+    device.BeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries.visible);
+    device.BeginTransformFeedback(GL_POINTS);
+    device.DrawArrays(GL_POINTS, 0, (GLsizei)shapeCount);
+    device.EndTransformFeedback();
+    device.EndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+    device.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    device.Disable(GL_RASTERIZER_DISCARD);
+
+    // the GPU copies the count into the instance count of the indirect draw once the query is done, the CPU never sees it
+    if (mDrawMode == HiZDrawIndirect)
+    {
+        device.BindBuffer(GL_QUERY_BUFFER, mIndirectBuffer);
+        device.GetQueryObjectuivToBuffer(queries.visible, GL_QUERY_RESULT, sizeof(GLuint));
+        device.BindBuffer(GL_QUERY_BUFFER, 0);
+    }
+    queries.shapeCount = shapeCount;
+    mDrawn = mCurrent;
+    mDrawable = mDrawMode == HiZDrawIndirect || FindCountedFrame();
+    EndStage(HiZStageCull);
+}
+
+bool HiZCuller::FindCountedFrame()
+{
+    // never this frame's: its cull was only just queued, reading its count would wait for everything ahead of it
+    RenderDevice& device = GetRenderDevice();
+    for (unsigned int back = 1; back < mQueries.size(); back++)
+    {
+        unsigned int frame = (mCurrent + (unsigned int)mQueries.size() - back) % mQueries.size();
+        FrameQueries& queries = mQueries[frame];
+        if (queries.shapeCount == 0)
+            continue;
+        if (!queries.counted)
+        {
+            GLuint available = 0;
+            device.GetQueryObjectuiv(queries.visible, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+            GLuint visible = 0;
+            device.GetQueryObjectuiv(queries.visible, GL_QUERY_RESULT, &visible);
+            queries.visibleCount = std::min((size_t)visible, queries.shapeCount);
+            queries.counted = true;
+        }
+        mDrawn = frame;
+        return true;
+    }
+    return false;
+}
+
+bool HiZCuller::DrawVisible(unsigned int mode, int vertexCount)
+{
+    FrameQueries& queries = mQueries[mCurrent];
+    if (queries.shapeCount == 0)
+        return true;
+
+    RenderDevice& device = GetRenderDevice();
+    if (mDrawMode == HiZDrawIndirect)
+    {
+        BeginStage(HiZStageDraw);
+        device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+        if (vertexCount != mIndirectVertexCount)
+        {
+            GLuint count = (GLuint)vertexCount;
+            device.BufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(count), &count);
+            mIndirectVertexCount = vertexCount;
+        }
+        device.DrawArraysIndirect(mode, 0);
+        device.BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        EndStage(HiZStageDraw);
+        return true;
+    }
+
+    // the shapes an earlier frame kept, as they were then; until one is counted all of them are drawn instead,
+    // which costs the GPU the culled ones but never stalls the CPU
+    mReadbackDraws++;
+    if (!mDrawable)
+    {
+        mUnculledDraws++;
+        return false;
+    }
+    const FrameQueries& drawn = mQueries[mDrawn];
+    mDrawLatency += mFrame - drawn.frame;
+
+    BeginStage(HiZStageDraw);
+    if (drawn.visibleCount > 0)
+        device.DrawArraysInstanced(mode, 0, vertexCount, (GLsizei)drawn.visibleCount);
+    EndStage(HiZStageDraw);
+    return true;
+}
+
+void HiZCuller::BeginStage(HiZStage stage)
+{
+    FrameQueries& queries = mQueries[mCurrent];
+    mStageStart = std::chrono::steady_clock::now();
+    GetRenderDevice().BeginQuery(GL_TIME_ELAPSED, queries.timers[stage]);
+    queries.timed[stage] = true;
+}
+
+void HiZCuller::EndStage(HiZStage stage)
+{
+    FrameQueries& queries = mQueries[mCurrent];
+    GetRenderDevice().EndQuery(GL_TIME_ELAPSED);
+    queries.lastQuery = queries.timers[stage];
+    queries.pending = true;
+    mCpuMilliseconds[stage] += MillisecondsSince(mStageStart);
+    mCpuStages[stage]++;
+}
+
+bool HiZCuller::Resolve(FrameQueries& queries, bool wait)
+{
+    RenderDevice& device = GetRenderDevice();
+    if (!wait)
+    {
+        GLuint available = 0;
+        device.GetQueryObjectuiv(queries.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    for (int stage = 0; stage < HiZStageCount; stage++)
+    {
+        if (!queries.timed[stage])
+            continue;
+        GLuint nanoseconds = 0;
+        device.GetQueryObjectuiv(queries.timers[stage], GL_QUERY_RESULT, &nanoseconds);
+        mGpuNanoseconds[stage] += nanoseconds;
+        mGpuStages[stage]++;
+    }
+    if (queries.shapeCount > 0)
+    {
+        GLuint visible = 0;
+        device.GetQueryObjectuiv(queries.visible, GL_QUERY_RESULT, &visible);
+        mLastShapes = queries.shapeCount;
+        mLastVisible = std::min((size_t)visible, queries.shapeCount);
+        queries.visibleCount = mLastVisible;
+        queries.counted = true;
+        mShapes += mLastShapes;
+        mVisible += mLastVisible;
+    }
+    queries.pending = false;
+    mResolved++;
+    mTotalLatency += mFrame - queries.frame;
+    return true;
+}
+
+void HiZCuller::DeletePyramid()
+{
+    RenderDevice& device = GetRenderDevice();
+    if (mDepthFramebuffer)
+        device.DeleteFramebuffer(mDepthFramebuffer);
+    if (mReduceFramebuffer)
+        device.DeleteFramebuffer(mReduceFramebuffer);
+    if (mDepthTexture)
+        device.DeleteTexture(mDepthTexture);
+    if (mPyramid)
+        device.DeleteTexture(mPyramid);
+    mDepthFramebuffer = mReduceFramebuffer = mDepthTexture = mPyramid = 0;
+    mWidth = mHeight = mLevels = 0;
+}
+
+void HiZCuller::DeleteHiZCuller()
+{
+    RenderDevice& device = GetRenderDevice();
+    DeletePyramid();
+    for (FrameQueries& queries : mQueries)
+    {
+        if (queries.visible)
+            device.DeleteQuery(queries.visible);
+        if (queries.visibleBuffer)
+            device.DeleteBuffer(queries.visibleBuffer);
+        for (unsigned int timer : queries.timers)
+        {
+            if (timer)
+                device.DeleteQuery(timer);
+        }
+    }
+    mQueries.clear();
+    if (mVertexArray)
+        device.DeleteVertexArray(mVertexArray);
+    if (mCullVertexArray)
+        device.DeleteVertexArray(mCullVertexArray);
+    if (mIndirectBuffer)
+        device.DeleteBuffer(mIndirectBuffer);
+    mVertexArray = mCullVertexArray = mIndirectBuffer = mInputBuffer = 0;
+    mDrawn = 0;
+    mDrawable = false;
+    mReduceShader.reset();
+    mCullShader.reset();
+    mReduceReload.shader.reset();
+    mCullReload.shader.reset();
+}
+
+void HiZCuller::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    std::cout << "Hi-Z (" << (mDrawMode == HiZDrawIndirect ? "indirect" : "readback") << "): " << mLevels << " levels, "
+        << (mShapes ? 100.0 * (mShapes - mVisible) / mShapes : 0.0) << "% of " << (mResolved ? (double)mShapes / mResolved : 0.0)
+        << " shapes per frame culled, results read after " << (mResolved ? (double)mTotalLatency / mResolved : 0.0) << " frames on average, "
+        << mStalls << " stalls" << std::endl;
+    for (int stage = 0; stage < HiZStageCount; stage++)
+    {
+        std::cout << "  " << stageNames[stage] << ": " << (mCpuStages[stage] ? mCpuMilliseconds[stage] / mCpuStages[stage] : 0.0) << " ms CPU, "
+            << (mGpuStages[stage] ? mGpuNanoseconds[stage] * 1e-6 / mGpuStages[stage] : 0.0) << " ms GPU";
+        if (stage == HiZStageDraw && mDrawMode == HiZDrawReadback)
+            std::cout << ", " << mUnculledDraws << " of " << mReadbackDraws << " draws unculled, no count was in yet, the others "
+                << (mReadbackDraws > mUnculledDraws ? (double)mDrawLatency / (mReadbackDraws - mUnculledDraws) : 0.0) << " frames late on average";
+        std::cout << std::endl;
+    }
+}
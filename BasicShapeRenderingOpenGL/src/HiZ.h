@@ -0,0 +1,149 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class RenderTarget;
+class Shader;
+
+enum HiZDrawMode
+{
+	HiZDrawIndirect,	// the visible count goes from the query into an indirect draw on the GPU (ARB_draw_indirect and ARB_query_buffer_object)
+	HiZDrawReadback		// every frame culls into a buffer of its own and draws the newest earlier one whose count the CPU can
+						// read without waiting: those shapes as they were a frame or more ago, every shape until one is in
+};
+
+enum HiZStage
+{
+	HiZStagePyramid,	// depth copy and reduction
+	HiZStageCull,
+	HiZStageDraw,
+	HiZStageCount
+};
+
+// Hierarchical Z occlusion culling of the shapes, for scenes with too many of them for a query each.
+// Build copies the depth of the opaque pass out of the scene target and reduces it into a pyramid of
+// R32F mips (HiZReduce.vert/.frag), every texel the farthest depth under it. Cull runs a point per
+// shape through HiZCull.vert, which projects the shape's outline, reads the level where it covers
+// at most 2x2 texels and keeps it unless it's behind all four; HiZCull.geom emits only the shapes
+// kept, so transform feedback packs them into a buffer of their own and a primitives written query
+// counts them. DrawVisible draws such a buffer with its count from the query, see HiZDrawMode.
+// Reload rebuilds the programs from edited sources in the background, Update swaps them in.
+// With MSAA the copy keeps one sample per pixel, so the edges of occluders are off by up to a pixel.
+// Every stage is timed on the CPU and with GL_TIME_ELAPSED queries, read back frames later without waiting.
+class HiZCuller
+{
+public:
+	HiZCuller(const std::string& reduceVertexSource, const std::string& reduceFragmentSource, const std::string& cullVertexSource,
+		const std::string& cullGeometrySource, HiZDrawMode drawMode = HiZDrawReadback, bool reversedZ = false);
+	~HiZCuller();
+	HiZCuller(const HiZCuller&) = delete;
+	HiZCuller& operator=(const HiZCuller&) = delete;
+
+	// starts the culler's frame: call once per frame after the occluders are drawn into depthTarget, whose depth
+	// has to be GL_DEPTH_COMPONENT32F; leaves depthTarget bound
+	void Build(RenderTarget& depthTarget);
+	// packs the ShapeInstances in instanceBuffer that pass into the frame's visible buffer, with the viewProjection in FrameData
+	void Cull(unsigned int instanceBuffer, size_t shapeCount);
+	// vertexCount vertices per visible shape, with the program and a vertex array over GetVisibleBuffer bound;
+	// never waits, false with HiZDrawReadback when no earlier frame's count is in yet and the caller has to draw every shape
+	bool DrawVisible(unsigned int mode, int vertexCount);
+
+	// hot reload, a program that fails to build keeps the previous one
+	void Reload(const std::string& reduceVertexSource, const std::string& reduceFragmentSource, const std::string& cullVertexSource,
+		const std::string& cullGeometrySource);
+	// call once per frame, never waits on the driver when KHR_parallel_shader_compile is available;
+	// without it a reload is left a frame to build
+	void Update();
+
+	// the buffer DrawVisible draws from, after Cull; with HiZDrawReadback it changes every frame
+	unsigned int GetVisibleBuffer() const { return mQueries.empty() ? 0 : mQueries[BufferSlot(mDrawn)].visibleBuffer; }
+	HiZDrawMode GetDrawMode() const { return mDrawMode; }
+	// of the latest frame whose results are in
+	size_t GetShapeCount() const { return mLastShapes; }
+	size_t GetCulledCount() const { return mLastShapes - mLastVisible; }
+
+	void DeleteHiZCuller();
+	void Report() const;
+
+private:
+	struct FrameQueries
+	{
+		unsigned int visible = 0;					// GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN
+		unsigned int timers[HiZStageCount] = {};	// GL_TIME_ELAPSED
+		bool timed[HiZStageCount] = {};				// the stages that ran this frame
+		unsigned int lastQuery = 0;					// the results are in once this one's are
+		bool pending = false;
+		size_t shapeCount = 0;						// culled, 0 when Cull didn't run
+		unsigned long long frame = 0;
+		unsigned int visibleBuffer = 0;				// the shapes kept; with HiZDrawIndirect only the first frame's is used
+		size_t capacity = 0;						// shapes visibleBuffer has room for
+		size_t visibleCount = 0;					// of the visible query, once counted
+		bool counted = false;
+	};
+
+	struct PendingReload
+	{
+		std::unique_ptr<Shader> shader;
+		unsigned int updates = 0;	// Update calls since it was submitted
+	};
+
+	// the cull program with its geometry stage and varyings, linking in the background
+	std::unique_ptr<Shader> BuildCullShader(const std::string& cullVertexSource, const std::string& cullGeometrySource);
+	// true once the reload is done with, swapped in or not
+	bool FinishReload(PendingReload& reload, std::unique_ptr<Shader>& shader, const char* name);
+	void BeginStage(HiZStage stage);
+	void EndStage(HiZStage stage);
+	// false when not waiting and the results aren't in yet
+	bool Resolve(FrameQueries& queries, bool wait);
+	// HiZDrawReadback: points mDrawn at the newest earlier frame whose count is in, false when there's none
+	bool FindCountedFrame();
+	unsigned int BufferSlot(unsigned int frame) const { return mDrawMode == HiZDrawIndirect ? 0 : frame; }
+	void CreatePyramid(int width, int height);
+	void DeletePyramid();
+
+	HiZDrawMode mDrawMode;
+	bool mReversedZ;
+	std::unique_ptr<Shader> mReduceShader;
+	std::unique_ptr<Shader> mCullShader;
+	PendingReload mReduceReload;
+	PendingReload mCullReload;
+	unsigned int mVertexArray = 0;			// empty, for the fullscreen triangle
+	unsigned int mCullVertexArray = 0;		// a point per shape of mInputBuffer
+	unsigned int mInputBuffer = 0;
+	unsigned int mIndirectBuffer = 0;		// one DrawArraysIndirectCommand
+	int mIndirectVertexCount = 0;
+
+	int mWidth = 0;
+	int mHeight = 0;
+	int mLevels = 0;
+	unsigned int mDepthTexture = 0;
+	unsigned int mDepthFramebuffer = 0;
+	unsigned int mPyramid = 0;
+	unsigned int mReduceFramebuffer = 0;
+
+	std::vector<FrameQueries> mQueries;
+	unsigned int mCurrent = 0;
+	unsigned int mDrawn = 0;				// the frame of mQueries DrawVisible draws
+	bool mDrawable = false;					// mDrawn was culled and counted
+	unsigned long long mFrame = 0;
+	std::chrono::steady_clock::time_point mStageStart;
+	size_t mLastShapes = 0;
+	size_t mLastVisible = 0;
+
+	unsigned long long mFrames = 0;
+	unsigned long long mResolved = 0;
+	unsigned long long mTotalLatency = 0;	// frames from issuing the queries to reading them
+	unsigned long long mStalls = 0;			// queries of the ring still in flight when their turn came
+	unsigned long long mShapes = 0;			// over the resolved frames
+	unsigned long long mVisible = 0;
+	unsigned long long mGpuNanoseconds[HiZStageCount] = {};
+	unsigned long long mGpuStages[HiZStageCount] = {};
+	double mCpuMilliseconds[HiZStageCount] = {};
+	unsigned long long mCpuStages[HiZStageCount] = {};
+	unsigned long long mReadbackDraws = 0;	// DrawVisible calls with HiZDrawReadback
+	unsigned long long mUnculledDraws = 0;	// of them, no count was in and every shape was drawn
+	unsigned long long mDrawLatency = 0;	// frames from the cull to the draw of the others
+};
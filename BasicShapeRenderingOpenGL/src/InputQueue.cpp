@@ -0,0 +1,116 @@
+#include "InputQueue.h"
+#include "FrameClock.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+namespace
+{
+    // frames past this many are measured no more, keeps a stalled GPU from growing the queue
+    const size_t maxPendingFrames = 8;
+}
+
+void InputQueue::PushKey(int key, int action)
+{
+    InputEvent event = { InputEventKey, FrameClock::Now() };
+    event.key = key;
+    event.action = action;
+    mEvents.push_back(event);
+}
+
+void InputQueue::PushCursor(double x, double y)
+{
+    InputEvent event = { InputEventCursor, FrameClock::Now() };
+    event.x = x;
+    event.y = y;
+    mEvents.push_back(event);
+}
+
+void InputQueue::PushScroll(double x, double y)
+{
+    InputEvent event = { InputEventScroll, FrameClock::Now() };
+    event.x = x;
+    event.y = y;
+    mEvents.push_back(event);
+}
+
+void InputQueue::PushResize(int width, int height)
+{
+    InputEvent event = { InputEventResize, FrameClock::Now() };
+    event.x = width;
+    event.y = height;
+    mEvents.push_back(event);
+}
+
+std::vector<InputEvent> InputQueue::Drain()
+{
+    std::vector<InputEvent> events;
+    events.swap(mEvents);
+    return events;
+}
+
+void InputState::Apply(const InputEvent& event)
+{
+    if (event.type != InputEventKey || event.key < 0)
+        return;
+    if ((size_t)event.key >= mKeys.size())
+        mKeys.resize(event.key + 1, false);
+    // GLFW_RELEASE is 0, press and repeat both mean held
+    mKeys[event.key] = event.action != 0;
+}
+
+bool InputState::IsKeyDown(int key) const
+{
+    return key >= 0 && (size_t)key < mKeys.size() && mKeys[key];
+}
+
+InputLatency::~InputLatency()
+{
+    DeleteFences();
+}
+
+void InputLatency::EndFrame(int64_t inputTimestamp)
+{
+    if (inputTimestamp == 0 || mPending.size() >= maxPendingFrames)
+        return;
+    mPending.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), inputTimestamp });
+    glFlush();
+}
+
+void InputLatency::Poll()
+{
+    while (!mPending.empty())
+    {
+        PendingFrame& frame = mPending.front();
+        GLenum status = glClientWaitSync((GLsync)frame.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+
+        if (status != GL_WAIT_FAILED)
+        {
+            double latencyMilliseconds = (double)(FrameClock::Now() - frame.inputTimestamp) * 1e-6;
+            mLatencyMillisecondsSum += latencyMilliseconds;
+            if (latencyMilliseconds > mLongestMilliseconds)
+                mLongestMilliseconds = latencyMilliseconds;
+            mSamples++;
+        }
+        glDeleteSync((GLsync)frame.fence);
+        mPending.pop_front();
+    }
+}
+
+void InputLatency::DeleteFences()
+{
+    for (PendingFrame& frame : mPending)
+        glDeleteSync((GLsync)frame.fence);
+    mPending.clear();
+}
+
+void InputLatency::Report() const
+{
+    if (mSamples == 0)
+        return;
+    std::cout << "Input latency: " << mSamples << " frames with input, " << mLatencyMillisecondsSum / (double)mSamples << " ms mean, "
+        << mLongestMilliseconds << " ms longest (input event to GPU done with the swap)" << std::endl;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+enum InputEventType
+{
+	InputEventKey,
+	InputEventCursor,	// x, y in screen coordinates, unaccelerated with raw mouse motion
+	InputEventScroll,	// x, y offsets
+	InputEventResize,	// x, y framebuffer size in pixels
+};
+
+struct InputEvent
+{
+	InputEventType type;
+	int64_t timestamp;	// FrameClock::Now when the callback ran
+	int key = 0;
+	int action = 0;
+	double x = 0.0;
+	double y = 0.0;
+};
+
+// Filled by the GLFW callbacks during glfwPollEvents and drained once per frame, so every
+// event reaches the frame update in order instead of only the state at the time of polling.
+class InputQueue
+{
+public:
+	void PushKey(int key, int action);
+	void PushCursor(double x, double y);
+	void PushScroll(double x, double y);
+	void PushResize(int width, int height);
+
+	std::vector<InputEvent> Drain();
+
+private:
+	std::vector<InputEvent> mEvents;
+};
+
+// Held keys, rebuilt from key events on whichever thread runs the update
+class InputState
+{
+public:
+	void Apply(const InputEvent& event);
+	bool IsKeyDown(int key) const;
+
+private:
+	std::vector<bool> mKeys;
+};
+
+// Input to photon latency, approximated as the time from the oldest input event that went into
+// a frame until the GPU has finished that frame's commands and its swap. A fence is inserted
+// after the swap and polled without blocking on the next frames.
+class InputLatency
+{
+public:
+	InputLatency() = default;
+	~InputLatency();
+	InputLatency(const InputLatency&) = delete;
+	InputLatency& operator=(const InputLatency&) = delete;
+
+	// call right after glfwSwapBuffers, 0 when the frame had no new input
+	void EndFrame(int64_t inputTimestamp);
+	void Poll();
+	void DeleteFences();
+
+	void Report() const;
+
+private:
+	struct PendingFrame
+	{
+		void* fence;	// GLsync
+		int64_t inputTimestamp;
+	};
+	std::deque<PendingFrame> mPending;
+
+	unsigned long long mSamples = 0;
+	double mLatencyMillisecondsSum = 0.0;
+	double mLongestMilliseconds = 0.0;
+};
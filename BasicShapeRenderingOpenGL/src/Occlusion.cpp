@@ -0,0 +1,166 @@
+#include "Occlusion.h"
+#include "GLExtensions.h"
+#include "RenderDevice.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// boxes the camera is this close to could be cut by the near plane and are drawn without asking
+static const float nearMargin = 0.25f;
+
+OcclusionCuller::OcclusionCuller(OcclusionMode mode, float inflate)
+    : mMode(mode), mInflate(inflate)
+{
+    // the conservative query can stop at the first sample that passes, possibly at coarse rasterization
+    mQueryTarget = glExtensions.ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+    mVertexArray = GetRenderDevice().GenVertexArray();
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+    DeleteOcclusionCuller();
+}
+
+void OcclusionCuller::BeginFrame(size_t objectCount)
+{
+    RenderDevice& device = GetRenderDevice();
+    mFrame++;
+    for (size_t i = objectCount; i < mObjects.size(); i++)
+    {
+        if (mObjects[i].query)
+            device.DeleteQuery(mObjects[i].query);
+    }
+    mObjects.resize(objectCount);
+
+    mFrameCulled = 0;
+    if (mMode == OcclusionModeReadback)
+    {
+        for (ObjectState& object : mObjects)
+        {
+            if (object.pending)
+            {
+                GLuint available = 0;
+                device.GetQueryObjectuiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available)
+                {
+                    GLuint passed = 0;
+                    device.GetQueryObjectuiv(object.query, GL_QUERY_RESULT, &passed);
+                    object.visible = passed != 0;
+                    object.pending = false;
+
+                    unsigned long long latency = mFrame - object.issuedFrame;
+                    mResults++;
+                    mTotalLatency += latency;
+                    mMaxLatency = std::max(mMaxLatency, latency);
+                }
+            }
+            if (!object.visible)
+                mFrameCulled++;
+        }
+    }
+
+    mFrames++;
+    mObjectFrames += objectCount;
+    mCulled += mFrameCulled;
+}
+
+bool OcclusionCuller::IsVisible(size_t object) const
+{
+    return mMode == OcclusionModeConditionalRender || object >= mObjects.size() || mObjects[object].visible;
+}
+
+void OcclusionCuller::BeginDraw(size_t object)
+{
+    if (mMode == OcclusionModeConditionalRender && object < mObjects.size() && mObjects[object].conditional)
+        GetRenderDevice().BeginConditionalRender(mObjects[object].query, GL_QUERY_WAIT);
+}
+
+void OcclusionCuller::EndDraw(size_t object)
+{
+    if (mMode == OcclusionModeConditionalRender && object < mObjects.size() && mObjects[object].conditional)
+        GetRenderDevice().EndConditionalRender();
+}
+
+void OcclusionCuller::Query(const std::vector<OcclusionBounds>& bounds, const glm::mat4& viewProjection, Shader& boxShader)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    RenderDevice& device = GetRenderDevice();
+    if (mObjects.size() < bounds.size())
+        mObjects.resize(bounds.size());
+
+    // the camera ends up at (0, 0, z, 0) in clip space
+    glm::vec4 eye = glm::inverse(viewProjection) * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    glm::vec3 eyePosition = glm::vec3(eye) / eye.w;
+
+    device.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    device.DepthMask(GL_FALSE);
+    boxShader.UseProgram();
+    device.BindVertexArray(mVertexArray);
+    for (size_t i = 0; i < bounds.size(); i++)
+    {
+        ObjectState& object = mObjects[i];
+        glm::vec3 boundsMin = bounds[i].boundsMin - mInflate;
+        glm::vec3 boundsMax = bounds[i].boundsMax + mInflate;
+        if (glm::all(glm::greaterThan(eyePosition, boundsMin - nearMargin)) && glm::all(glm::lessThan(eyePosition, boundsMax + nearMargin)))
+        {
+            // a box around the camera can't hide anything, whatever the last query said
+            object.visible = true;
+            object.conditional = false;
+            mInside++;
+            continue;
+        }
+        if (object.pending)
+        {
+            mStillPending++;
+            continue;
+        }
+
+        if (!object.query)
+            object.query = device.GenQuery();
+        boxShader.SetUniformFloat3("boxMin", boundsMin);
+        boxShader.SetUniformFloat3("boxMax", boundsMax);
+        device.BeginQuery(mQueryTarget, object.query);
+        device.DrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+        device.EndQuery(mQueryTarget);
+        object.pending = mMode == OcclusionModeReadback;
+        object.conditional = mMode == OcclusionModeConditionalRender;
+        object.issuedFrame = mFrame;
+        mQueries++;
+    }
+    device.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    device.DepthMask(GL_TRUE);
+    mQueryMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::DeleteOcclusionCuller()
+{
+    RenderDevice& device = GetRenderDevice();
+    for (ObjectState& object : mObjects)
+    {
+        if (object.query)
+            device.DeleteQuery(object.query);
+    }
+    mObjects.clear();
+    if (mVertexArray)
+        device.DeleteVertexArray(mVertexArray);
+    mVertexArray = 0;
+}
+
+void OcclusionCuller::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    std::cout << "Occlusion (" << (mMode == OcclusionModeReadback ? "readback" : "conditional render") << "): " << (double)mObjectFrames / mFrames
+        << " objects and " << (double)mQueries / mFrames << " queries per frame, " << mQueryMilliseconds / mFrames << " ms/frame issuing them";
+    if (mMode == OcclusionModeReadback)
+    {
+        std::cout << ", " << (mObjectFrames ? 100.0 * mCulled / mObjectFrames : 0.0) << "% culled, results read after "
+            << (mResults ? (double)mTotalLatency / mResults : 0.0) << " frames on average (max " << mMaxLatency << "), "
+            << mStillPending << " queries held back while the last was in flight";
+    }
+    std::cout << ", " << mInside << " boxes around the camera" << std::endl;
+}
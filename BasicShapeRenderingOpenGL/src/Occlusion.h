@@ -0,0 +1,86 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+
+class Shader;
+
+enum OcclusionMode
+{
+	OcclusionModeReadback,			// results are read once they're available, until then objects keep their last one
+	OcclusionModeConditionalRender	// the GPU drops the draws itself on last frame's query, nothing is read back
+};
+
+// world space bounds of an object
+struct OcclusionBounds
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Skips objects hidden behind the depth drawn before them. After the objects of a frame, Query
+// draws every object's bounding box (OcclusionBox.vert/.frag, color and depth writes off) inside
+// an occlusion query, GL_ANY_SAMPLES_PASSED_CONSERVATIVE where the driver has it, and the next
+// frames decide from those results:
+// - readback: BeginFrame reads the queries that are available without ever waiting, an object is
+//   drawn when its last result found samples and it isn't queried again until that result is in,
+//   so a slow GPU makes results older instead of stalling the CPU
+// - conditional render: every draw goes between BeginDraw/EndDraw, which wrap it in
+//   glBeginConditionalRender on the previous frame's query; the GPU waits for the query, the CPU never does
+// Either way the visibility is a frame behind, so something coming out from behind an occluder
+// pops in a frame late. Objects are identified by their index in the bounds given to Query.
+class OcclusionCuller
+{
+public:
+	// boxes are grown by inflate so a flat object's box isn't hidden by the object itself
+	OcclusionCuller(OcclusionMode mode = OcclusionModeReadback, float inflate = 0.01f);
+	~OcclusionCuller();
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	// collects the finished results, call once per frame before drawing the objects
+	void BeginFrame(size_t objectCount);
+	// always true in conditional render mode, new objects are visible until their first result
+	bool IsVisible(size_t object) const;
+	void BeginDraw(size_t object);
+	void EndDraw(size_t object);
+
+	// after the objects with the depth test on; viewProjection has to be the one in FrameData
+	void Query(const std::vector<OcclusionBounds>& bounds, const glm::mat4& viewProjection, Shader& boxShader);
+
+	OcclusionMode GetMode() const { return mMode; }
+	// objects IsVisible turns down this frame, only known on the CPU with readback
+	size_t GetCulledCount() const { return mFrameCulled; }
+
+	void DeleteOcclusionCuller();
+	void Report() const;
+
+private:
+	struct ObjectState
+	{
+		unsigned int query = 0;
+		bool pending = false;		// issued, result not read yet (readback)
+		bool conditional = false;	// issued last frame, its draw can depend on it (conditional render)
+		bool visible = true;
+		unsigned long long issuedFrame = 0;
+	};
+
+	OcclusionMode mMode;
+	float mInflate;
+	unsigned int mQueryTarget;
+	unsigned int mVertexArray = 0;	// empty, the box corners come from gl_VertexID
+	std::vector<ObjectState> mObjects;
+	unsigned long long mFrame = 0;
+	size_t mFrameCulled = 0;
+
+	unsigned long long mFrames = 0;
+	unsigned long long mObjectFrames = 0;	// objects summed over the frames
+	unsigned long long mCulled = 0;
+	unsigned long long mQueries = 0;
+	unsigned long long mResults = 0;
+	unsigned long long mTotalLatency = 0;	// frames from issuing a query to reading it
+	unsigned long long mMaxLatency = 0;
+	unsigned long long mStillPending = 0;	// queries not issued because the last one was in flight
+	unsigned long long mInside = 0;			// camera inside the box, drawn without asking
+	double mQueryMilliseconds = 0.0;
+};
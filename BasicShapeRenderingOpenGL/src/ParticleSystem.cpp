@@ -0,0 +1,288 @@
+#include "ParticleSystem.h"
+#include "RenderDevice.h"
+#include "GLExtensions.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLE_SYSTEM_SSE2
+#endif
+
+namespace
+{
+    // transform feedback discards the rasterizer, the fragment stage never runs
+    const char* updateFragmentShaderSource = "#version 330 core\nvoid main()\n{\n}\n";
+
+    // PCG hash, the same as Hash in ParticleUpdate.vert so both paths spawn alike
+    uint32_t Hash(uint32_t x)
+    {
+        uint32_t state = x * 747796405u + 2891336453u;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    float Random(uint32_t& state)
+    {
+        state = Hash(state);
+        return (state >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // a new life at the emitter, age is how far into it the particle already is
+    void Spawn(Particle& particle, uint32_t index, uint32_t seed, float age, const ParticleEmitter& emitter)
+    {
+        uint32_t state = index ^ Hash(seed);
+        float lifetime = emitter.minLifetime + (emitter.maxLifetime - emitter.minLifetime) * Random(state);
+        float cosTheta = 1.0f + (cosf(emitter.spread) - 1.0f) * Random(state);
+        float sinTheta = sqrtf(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        float phi = 6.2831853f * Random(state);
+        float speed = emitter.minSpeed + (emitter.maxSpeed - emitter.minSpeed) * Random(state);
+
+        glm::vec3 direction = glm::normalize(emitter.direction);
+        glm::vec3 tangent = glm::normalize(glm::cross(fabsf(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), direction));
+        glm::vec3 bitangent = glm::cross(direction, tangent);
+        glm::vec3 velocity = (tangent * (sinTheta * cosf(phi)) + bitangent * (sinTheta * sinf(phi)) + direction * cosTheta) * speed;
+
+        particle.positionAge = glm::vec4(emitter.position, age);
+        particle.velocityLifetime = glm::vec4(velocity, lifetime);
+    }
+}
+
+ParticleSystem::ParticleSystem(size_t count, const ParticleEmitter& emitter, const std::string& updateShaderSource, ParticleSimulation simulation)
+    : mCount(count), mEmitter(emitter), mSimulation(simulation)
+{
+    // births are staggered over a lifetime so the emitter starts at its steady rate
+    std::vector<Particle> particles(mCount);
+    for (size_t i = 0; i < mCount; i++)
+    {
+        uint32_t state = Hash((uint32_t)i);
+        particles[i].positionAge = glm::vec4(emitter.position, -Random(state) * emitter.maxLifetime);
+        particles[i].velocityLifetime = glm::vec4(0.0f, 0.0f, 0.0f, emitter.maxLifetime);
+    }
+
+    RenderDevice& device = GetRenderDevice();
+    unsigned int bufferCount = mSimulation == ParticleSimulationGPU ? 2 : 1;
+    for (unsigned int i = 0; i < bufferCount; i++)
+    {
+        mBuffers[i] = device.GenBuffer();
+        device.BindBuffer(GL_ARRAY_BUFFER, mBuffers[i]);
+        // the CPU path replaces the whole buffer every step
+        device.BufferData(GL_ARRAY_BUFFER, mCount * sizeof(Particle), i == 0 ? particles.data() : NULL,
+            mSimulation == ParticleSimulationGPU ? GL_DYNAMIC_COPY : GL_STREAM_DRAW);
+        mDrawArrays[i] = CreateVertexArray(mBuffers[i], true);
+        if (mSimulation == ParticleSimulationGPU)
+            mUpdateArrays[i] = CreateVertexArray(mBuffers[i], false);
+    }
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (mSimulation == ParticleSimulationGPU)
+    {
+        mUpdateShader.reset(new Shader(updateShaderSource.c_str(), updateFragmentShaderSource));
+        mUpdateShader->SetTransformFeedbackVaryings({ "PositionAge", "VelocityLifetime" });
+        mUpdateShader->Link();
+    }
+    else
+    {
+        mParticles.swap(particles);
+    }
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    DeleteParticleSystem();
+}
+
+unsigned int ParticleSystem::CreateVertexArray(unsigned int buffer, bool instanced)
+{
+    RenderDevice& device = GetRenderDevice();
+    unsigned int vertexArray = device.GenVertexArray();
+    device.BindVertexArray(vertexArray);
+    device.BindBuffer(GL_ARRAY_BUFFER, buffer);
+    device.VertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), offsetof(Particle, positionAge));
+    device.VertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), offsetof(Particle, velocityLifetime));
+    for (GLuint attribute = 0; attribute < 2; attribute++)
+    {
+        device.EnableVertexAttribArray(attribute);
+        if (instanced)
+            device.VertexAttribDivisor(attribute, 1);
+    }
+    device.BindVertexArray(0);
+    return vertexArray;
+}
+
+void ParticleSystem::Reload(const std::string& updateShaderSource)
+{
+    if (mSimulation != ParticleSimulationGPU)
+        return;
+
+    // a reload still building is superseded, destroying it deletes its program and stages
+    mUpdateReload.reset(new Shader(updateShaderSource.c_str(), updateFragmentShaderSource));
+    mUpdateReload->SetTransformFeedbackVaryings({ "PositionAge", "VelocityLifetime" });
+    mUpdateReload->BeginLink();
+    mReloadUpdates = 0;
+}
+
+bool ParticleSystem::FinishReload()
+{
+    // without the extension there's no way to ask, so give the driver a frame and take the stall then
+    mReloadUpdates++;
+    if (!mUpdateReload->IsLinkComplete() && (glExtensions.KHR_parallel_shader_compile || mReloadUpdates < 2))
+        return false;
+
+    mUpdateReload->FinishLink();
+    if (!mUpdateReload->IsLinked())
+    {
+        std::cout << "Particle update shader failed to reload, keeping the previous program" << std::endl;
+        return true;
+    }
+    // the uniforms are set again every step anyway
+    mUpdateShader->SwapProgram(*mUpdateReload);
+    std::cout << "Particle update shader reloaded" << std::endl;
+    return true;
+}
+
+void ParticleSystem::Update(float deltaTime)
+{
+    if (mUpdateReload && FinishReload())
+        mUpdateReload.reset();
+    if (mCount == 0 || deltaTime <= 0.0f)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (mSimulation == ParticleSimulationGPU)
+        UpdateGPU(deltaTime);
+    else
+        UpdateCPU(deltaTime);
+    mStep++;
+    mUpdates++;
+    mUpdateMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::UpdateGPU(float deltaTime)
+{
+    RenderDevice& device = GetRenderDevice();
+    Shader& shader = *mUpdateShader;
+    shader.UseProgram();
+    shader.SetUniformFloat("deltaTime", deltaTime);
+    shader.SetUniformInt("seed", (int)mStep);
+    shader.SetUniformFloat3("emitterPosition", mEmitter.position);
+    shader.SetUniformFloat3("emitterDirection", glm::normalize(mEmitter.direction));
+    shader.SetUniformFloat("cosSpread", cosf(mEmitter.spread));
+    shader.SetUniformFloat4("speedLifetime", glm::vec4(mEmitter.minSpeed, mEmitter.maxSpeed, mEmitter.minLifetime, mEmitter.maxLifetime));
+    shader.SetUniformFloat3("gravity", mEmitter.gravity);
+    shader.SetUniformFloat("dragFactor", expf(-mEmitter.drag * deltaTime));
+
+    // one point per particle, written to the other buffer
+    device.Enable(GL_RASTERIZER_DISCARD);
+    device.BindVertexArray(mUpdateArrays[mCurrent]);
+    device.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mBuffers[1 - mCurrent]);
+    device.BeginTransformFeedback(GL_POINTS);
+    device.DrawArrays(GL_POINTS, 0, (GLsizei)mCount);
+    device.EndTransformFeedback();
+    device.BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    device.Disable(GL_RASTERIZER_DISCARD);
+    mCurrent = 1 - mCurrent;
+}
+
+void ParticleSystem::UpdateCPU(float deltaTime)
+{
+    float dragFactor = expf(-mEmitter.drag * deltaTime);
+    glm::vec3 gravityStep = mEmitter.gravity * deltaTime;
+#ifdef PARTICLE_SYSTEM_SSE2
+    // a particle is two vec4s, so a register holds one: the w lanes carry age and lifetime along
+    const __m128 gravity = _mm_setr_ps(gravityStep.x, gravityStep.y, gravityStep.z, 0.0f);
+    const __m128 drag = _mm_setr_ps(dragFactor, dragFactor, dragFactor, 1.0f);
+    const __m128 step = _mm_set1_ps(deltaTime);
+    const __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 wOne = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+#endif
+
+    for (size_t i = 0; i < mCount; i++)
+    {
+        Particle& particle = mParticles[i];
+        float previousAge = particle.positionAge.w;
+        float age = previousAge + deltaTime;
+        if (age < 0.0f)
+        {
+            particle.positionAge.w = age;
+            continue;
+        }
+        if (previousAge < 0.0f || age >= particle.velocityLifetime.w)
+        {
+            // born this step, or died and starts over with what's left of the step
+            Spawn(particle, (uint32_t)i, mStep, previousAge < 0.0f ? age : age - particle.velocityLifetime.w, mEmitter);
+            continue;
+        }
+#ifdef PARTICLE_SYSTEM_SSE2
+        __m128 velocity = _mm_loadu_ps(&particle.velocityLifetime.x);
+        velocity = _mm_mul_ps(_mm_add_ps(velocity, gravity), drag);
+        // position += velocity * dt and age += dt in one multiply-add
+        __m128 position = _mm_loadu_ps(&particle.positionAge.x);
+        position = _mm_add_ps(position, _mm_mul_ps(_mm_or_ps(_mm_and_ps(velocity, xyzMask), wOne), step));
+        _mm_storeu_ps(&particle.velocityLifetime.x, velocity);
+        _mm_storeu_ps(&particle.positionAge.x, position);
+#else
+        glm::vec3 velocity = (glm::vec3(particle.velocityLifetime) + gravityStep) * dragFactor;
+        particle.velocityLifetime = glm::vec4(velocity, particle.velocityLifetime.w);
+        particle.positionAge = glm::vec4(glm::vec3(particle.positionAge) + velocity * deltaTime, age);
+#endif
+    }
+
+    // orphan and refill, the draw of the last step may still be reading the old storage
+    RenderDevice& device = GetRenderDevice();
+    device.BindBuffer(GL_ARRAY_BUFFER, mBuffers[0]);
+    device.BufferData(GL_ARRAY_BUFFER, mCount * sizeof(Particle), NULL, GL_STREAM_DRAW);
+    device.BufferSubData(GL_ARRAY_BUFFER, 0, mCount * sizeof(Particle), mParticles.data());
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleSystem::Draw(Shader& shader)
+{
+    if (mCount == 0 || !mDrawArrays[mCurrent])
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    // additive, so the order the particles are in doesn't matter
+    device.Enable(GL_BLEND);
+    device.BlendFunc(GL_ONE, GL_ONE);
+    shader.UseProgram();
+    shader.SetUniformFloat("spriteSize", mEmitter.spriteSize);
+    shader.SetUniformFloat4("startColor", mEmitter.startColor);
+    shader.SetUniformFloat4("endColor", mEmitter.endColor);
+    device.BindVertexArray(mDrawArrays[mCurrent]);
+    device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)mCount);
+    device.Disable(GL_BLEND);
+}
+
+void ParticleSystem::DeleteParticleSystem()
+{
+    RenderDevice& device = GetRenderDevice();
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        if (mUpdateArrays[i])
+            device.DeleteVertexArray(mUpdateArrays[i]);
+        if (mDrawArrays[i])
+            device.DeleteVertexArray(mDrawArrays[i]);
+        if (mBuffers[i])
+            device.DeleteBuffer(mBuffers[i]);
+        mUpdateArrays[i] = mDrawArrays[i] = mBuffers[i] = 0;
+    }
+    if (mUpdateShader)
+        mUpdateShader.reset();
+    mUpdateReload.reset();
+}
+
+void ParticleSystem::Report() const
+{
+    if (mUpdates == 0)
+        return;
+
+    std::cout << "Particles: " << mCount << " simulated on the " << (mSimulation == ParticleSimulationGPU ? "GPU" : "CPU") << ", "
+        << mUpdateMilliseconds / mUpdates << " ms of CPU time per update" << std::endl;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "Shader.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One particle as the simulation buffers hold it, the vertex layout of ParticleUpdate.vert and Particle.vert
+struct Particle
+{
+	glm::vec4 positionAge;			// age < 0 is not born yet, age >= lifetime is dead until respawned
+	glm::vec4 velocityLifetime;
+};
+static_assert(sizeof(Particle) == 32, "Particle has to match the attribute layout of the particle shaders");
+
+enum ParticleSimulation
+{
+	ParticleSimulationGPU,	// transform feedback between two buffers, nothing leaves the GPU
+	ParticleSimulationCPU	// SSE2 on the CPU, uploaded every step
+};
+
+struct ParticleEmitter
+{
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 direction = glm::vec3(0.0f, 1.0f, 0.0f);
+	float spread = 0.5f;			// half angle of the emission cone, radians
+	float minSpeed = 1.0f;
+	float maxSpeed = 2.0f;
+	float minLifetime = 1.0f;
+	float maxLifetime = 2.0f;
+	glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+	float drag = 0.0f;				// velocity decays by exp(-drag * seconds)
+	float spriteSize = 8.0f;		// pixels at a distance of 1, shrinks to half over the lifetime
+	glm::vec4 startColor = glm::vec4(1.0f, 0.6f, 0.1f, 1.0f);	// linear
+	glm::vec4 endColor = glm::vec4(0.6f, 0.05f, 0.0f, 0.0f);
+};
+
+// A fixed pool of particles from one emitter. Every particle is always in the buffer: it's born
+// at a staggered time, integrated under gravity and drag, and respawned at the emitter as soon as
+// its lifetime runs out, so the emission rate is the particle count over the mean lifetime and
+// nothing has to be compacted. Particles are drawn as one instanced quad each straight from the
+// simulation buffer, as round sprites additively blended so they don't need sorting.
+class ParticleSystem
+{
+public:
+	// updateShaderSource is ParticleUpdate.vert, linked here with its transform feedback outputs
+	ParticleSystem(size_t count, const ParticleEmitter& emitter, const std::string& updateShaderSource,
+		ParticleSimulation simulation = ParticleSimulationGPU);
+	~ParticleSystem();
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+	void SetEmitter(const ParticleEmitter& emitter) { mEmitter = emitter; }
+	const ParticleEmitter& GetEmitter() const { return mEmitter; }
+	ParticleSimulation GetSimulation() const { return mSimulation; }
+	size_t GetCount() const { return mCount; }
+
+	// hot reload of ParticleUpdate.vert, built in the background and swapped in by a later Update;
+	// a program that fails to build keeps the previous one, the CPU path has nothing to reload
+	void Reload(const std::string& updateShaderSource);
+	// advances every particle, no CPU work per particle on the GPU path
+	void Update(float deltaTime);
+	// Particle.vert/.frag, the buffer Update wrote last is the instance data
+	void Draw(Shader& shader);
+	void DeleteParticleSystem();
+
+	void Report() const;
+
+private:
+	// true once the reload is done with, swapped in or not
+	bool FinishReload();
+	void UpdateGPU(float deltaTime);
+	void UpdateCPU(float deltaTime);
+	// the particle attributes of buffer, per vertex for the update and per instance for drawing
+	unsigned int CreateVertexArray(unsigned int buffer, bool instanced);
+
+	size_t mCount;
+	ParticleEmitter mEmitter;
+	ParticleSimulation mSimulation;
+	unsigned int mStep = 0;			// seeds the respawn randomness
+
+	// GPU: the update reads mBuffers[mCurrent] and writes the other one, then they swap
+	std::unique_ptr<Shader> mUpdateShader;
+	std::unique_ptr<Shader> mUpdateReload;	// linking, not swapped in yet
+	unsigned int mReloadUpdates = 0;		// Update calls since it was submitted
+	unsigned int mBuffers[2] = { 0, 0 };
+	unsigned int mUpdateArrays[2] = { 0, 0 };
+	unsigned int mDrawArrays[2] = { 0, 0 };
+	unsigned int mCurrent = 0;
+	// CPU: the simulated copy, sent to mBuffers[0]
+	std::vector<Particle> mParticles;
+
+	unsigned long long mUpdates = 0;
+	double mUpdateMilliseconds = 0.0;	// CPU time spent in Update, the simulation itself on the CPU path
+};
@@ -0,0 +1,459 @@
+#include "Picking.h"
+#include "RenderTarget.h"
+#include "RenderDevice.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// GpuPicker
+
+GpuPicker::GpuPicker(unsigned int bufferCount)
+    : mReadbacks(bufferCount < 2 ? 2 : bufferCount)
+{
+    RenderDevice& device = GetRenderDevice();
+    for (Readback& readback : mReadbacks)
+    {
+        readback.buffer = device.GenBuffer();
+        device.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        device.BufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+    }
+    device.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+GpuPicker::~GpuPicker()
+{
+    DeleteGpuPicker();
+}
+
+void GpuPicker::Pick(ShapeRenderer& shapeRenderer, Shader& pickingShader, RenderTarget& sceneTarget, int x, int y)
+{
+    int width = sceneTarget.GetWidth();
+    int height = sceneTarget.GetHeight();
+    if (x < 0 || y < 0 || x >= width || y >= height || mReadbacks[0].buffer == 0)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // a depth blit needs the same format on both sides
+    unsigned int depthFormat = sceneTarget.GetDesc().depthFormat;
+    if (!mTarget || mTarget->GetDesc().depthFormat != depthFormat)
+    {
+        RenderTargetDesc desc;
+        desc.width = width;
+        desc.height = height;
+        desc.colorFormat = GL_R32UI;
+        desc.depthFormat = depthFormat;
+        mTarget = std::make_unique<RenderTarget>(desc);
+    }
+    mTarget->Resize(width, height);
+
+    // the scene's depth under the pixel, with MSAA the blit takes one of the samples
+    RenderDevice& device = GetRenderDevice();
+    if (depthFormat)
+    {
+        device.BindFramebuffer(GL_READ_FRAMEBUFFER, sceneTarget.GetFramebuffer());
+        device.BindFramebuffer(GL_DRAW_FRAMEBUFFER, mTarget->GetFramebuffer());
+        device.BlitFramebuffer(x, y, x + 1, y + 1, x, y, x + 1, y + 1, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+    mTarget->Bind();
+
+    // the clear honours the scissor too, so nothing outside the pixel is written or cleared
+    const GLuint background = 0;
+    device.Enable(GL_SCISSOR_TEST);
+    device.Scissor(x, y, 1, 1);
+    device.ClearBufferuiv(GL_COLOR, 0, &background);
+    if (depthFormat)
+    {
+        device.Enable(GL_DEPTH_TEST);
+        device.DepthMask(GL_FALSE);
+    }
+    shapeRenderer.Redraw(pickingShader);
+    if (depthFormat)
+    {
+        device.DepthMask(GL_TRUE);
+        device.Disable(GL_DEPTH_TEST);
+    }
+    device.Disable(GL_SCISSOR_TEST);
+
+    // every buffer still in flight, the oldest read has to finish before its buffer can be reused
+    if (mPendingReadbacks == mReadbacks.size())
+    {
+        Resolve(mReadbacks[mOldestReadback], true);
+        mStalls++;
+    }
+
+    Readback& readback = mReadbacks[mNextReadback];
+    mTarget->BindRead();
+    device.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    // with a pack buffer bound this only queues the copy
+    device.ReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+    device.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = device.FenceSync();
+    readback.frame = mFrame;
+
+    mNextReadback = (mNextReadback + 1) % mReadbacks.size();
+    mPendingReadbacks++;
+    mPicks++;
+    mPickMilliseconds += MillisecondsSince(start);
+}
+
+void GpuPicker::Poll()
+{
+    mFrame++;
+    while (mPendingReadbacks > 0 && Resolve(mReadbacks[mOldestReadback], false))
+        ;
+}
+
+bool GpuPicker::Resolve(Readback& readback, bool wait)
+{
+    RenderDevice& device = GetRenderDevice();
+    GLsync fence = (GLsync)readback.fence;
+    GLenum status = device.ClientWaitSync(fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 100000000 : 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+        status = device.ClientWaitSync(fence, 0, 100000000);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+    device.DeleteSync(fence);
+    readback.fence = nullptr;
+    mOldestReadback = (mOldestReadback + 1) % mReadbacks.size();
+    mPendingReadbacks--;
+
+    device.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    void* data = device.MapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), GL_MAP_READ_BIT);
+    if (data)
+    {
+        GLuint id;
+        memcpy(&id, data, sizeof(id));
+        device.UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        // ids are 1 based, the background is 0
+        mPickedShape = (int)id - 1;
+        mLatency = mFrame - readback.frame;
+        mResolved++;
+        mTotalLatency += mLatency;
+    }
+    device.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void GpuPicker::DeleteGpuPicker()
+{
+    while (mPendingReadbacks > 0)
+        Resolve(mReadbacks[mOldestReadback], true);
+
+    RenderDevice& device = GetRenderDevice();
+    for (Readback& readback : mReadbacks)
+    {
+        if (readback.buffer)
+            device.DeleteBuffer(readback.buffer);
+        readback.buffer = 0;
+    }
+    mTarget.reset();
+}
+
+void GpuPicker::Report() const
+{
+    if (mPicks == 0)
+        return;
+
+    std::cout << "GPU picking: " << mPicks << " picks, resolved after " << (mResolved ? (double)mTotalLatency / mResolved : 0.0) << " frames on average, "
+        << mStalls << " stalls, " << mPickMilliseconds / mPicks << " ms of CPU time per pick" << std::endl;
+}
+
+// ShapeBvh
+
+// extent of the outline around the center in the shape's own axes, like Shape.vert without the pixel of antialiasing
+static glm::vec2 ShapeExtent(const ShapeInstance& shape)
+{
+    glm::vec2 halfSize = glm::vec2(glm::unpackHalf1x16(shape.halfSize[0]), glm::unpackHalf1x16(shape.halfSize[1]));
+    glm::vec2 params = glm::vec2(glm::unpackHalf1x16(shape.params[0]), glm::unpackHalf1x16(shape.params[1]));
+    glm::vec2 extent = halfSize;
+    if (shape.type == ShapeLine)
+        extent.x += halfSize.y;
+    else if (shape.type == ShapeRing)
+        extent += 0.5f * params.x;
+    return extent + 0.5f * params.y;
+}
+
+static float ShapeAngle(const ShapeInstance& shape)
+{
+    return shape.rotation * (6.28318530718f / 65536.0f);
+}
+
+// ShapeDistance of Shape.frag
+static float ShapeDistance(const ShapeInstance& shape, const glm::vec2& p)
+{
+    glm::vec2 halfSize = glm::vec2(glm::unpackHalf1x16(shape.halfSize[0]), glm::unpackHalf1x16(shape.halfSize[1]));
+    float param = glm::unpackHalf1x16(shape.params[0]);
+    switch (shape.type)
+    {
+    case ShapeCircle:
+        return glm::length(p) - halfSize.x;
+    case ShapeEllipse:
+    {
+        float k0 = glm::length(p / halfSize);
+        float k1 = glm::length(p / (halfSize * halfSize));
+        return k0 * (k0 - 1.0f) / std::max(k1, 1e-6f);
+    }
+    case ShapeRoundedRect:
+    {
+        glm::vec2 q = glm::abs(p) - halfSize + param;
+        return glm::length(glm::max(q, 0.0f)) + std::min(std::max(q.x, q.y), 0.0f) - param;
+    }
+    case ShapeLine:
+        return glm::length(glm::vec2(std::max(std::abs(p.x) - halfSize.x, 0.0f), p.y)) - halfSize.y;
+    default:
+        return std::abs(glm::length(p) - halfSize.x) - 0.5f * param;
+    }
+}
+
+PickRay MakePickRay(const glm::mat4& viewProjection, int x, int y, const glm::vec2& viewportSize)
+{
+    glm::mat4 inverse = glm::inverse(viewProjection);
+    // the camera ends up at (0, 0, z, 0) in clip space, whatever the depth convention
+    glm::vec4 eye = inverse * glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
+    glm::vec2 ndc = (glm::vec2((float)x, (float)y) + 0.5f) / viewportSize * 2.0f - 1.0f;
+    // a depth between the planes in both conventions, -1..1 and reversed 1..0
+    glm::vec4 point = inverse * glm::vec4(ndc, 0.5f, 1.0f);
+
+    PickRay ray;
+    ray.origin = glm::vec3(eye) / eye.w;
+    ray.direction = glm::normalize(glm::vec3(point) / point.w - ray.origin);
+    return ray;
+}
+
+float IntersectMesh(const PickRay& ray, const std::vector<float>& vertices, unsigned int stride,
+    const std::vector<unsigned int>& indices, const glm::mat4& model)
+{
+    float nearest = INFINITY;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        glm::vec3 corners[3];
+        for (int j = 0; j < 3; j++)
+        {
+            const float* position = &vertices[(size_t)indices[i + j] * stride];
+            corners[j] = glm::vec3(model * glm::vec4(position[0], position[1], position[2], 1.0f));
+        }
+
+        // Moller-Trumbore, both faces since culling is off
+        glm::vec3 edge1 = corners[1] - corners[0];
+        glm::vec3 edge2 = corners[2] - corners[0];
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (std::abs(determinant) < 1e-12f)
+            continue;
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 offset = ray.origin - corners[0];
+        float u = glm::dot(offset, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f)
+            continue;
+        glm::vec3 q = glm::cross(offset, edge1);
+        float v = glm::dot(ray.direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f)
+            continue;
+        float t = glm::dot(edge2, q) * inverseDeterminant;
+        if (t >= 0.0f)
+            nearest = std::min(nearest, t);
+    }
+    return nearest;
+}
+
+// the bits of a 10 bit value spread out to every third bit
+static uint32_t SpreadBits(uint32_t value)
+{
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+void ShapeBvh::Build(const std::vector<ShapeInstance>& shapes)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mShapes = shapes;
+    std::vector<ShapeBounds> bounds(shapes.size());
+    glm::vec3 centerMin = glm::vec3(INFINITY), centerMax = glm::vec3(-INFINITY);
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        // the rotated extent's bounds, flat on the shape's plane
+        float angle = ShapeAngle(shapes[i]);
+        glm::vec2 extent = ShapeExtent(shapes[i]);
+        float c = std::abs(std::cos(angle));
+        float s = std::abs(std::sin(angle));
+        glm::vec3 half = glm::vec3(c * extent.x + s * extent.y, s * extent.x + c * extent.y, 0.0f);
+        bounds[i].boundsMin = shapes[i].center - half;
+        bounds[i].boundsMax = shapes[i].center + half;
+        bounds[i].shape = (uint32_t)i;
+        centerMin = glm::min(centerMin, shapes[i].center);
+        centerMax = glm::max(centerMax, shapes[i].center);
+    }
+
+    // One sort along a Morton curve through the centers instead of a partition per node: halves of
+    // the order are halves of space, so splitting every range in the middle still gives a balanced tree
+    std::vector<uint64_t> keys(shapes.size());
+    glm::vec3 scale = 1023.0f / glm::max(centerMax - centerMin, glm::vec3(1e-6f));
+    for (size_t i = 0; i < shapes.size(); i++)
+    {
+        glm::uvec3 cell = glm::uvec3((shapes[i].center - centerMin) * scale);
+        uint64_t code = SpreadBits(cell.x) | (SpreadBits(cell.y) << 1) | (SpreadBits(cell.z) << 2);
+        keys[i] = (code << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+    mBounds.resize(shapes.size());
+    for (size_t i = 0; i < keys.size(); i++)
+        mBounds[i] = bounds[(uint32_t)keys[i]];
+
+    mNodes.clear();
+    if (!shapes.empty())
+    {
+        mNodes.reserve(shapes.size() / 2 + 1);
+        mNodes.resize(1);
+        BuildNode(0, 0, (uint32_t)shapes.size());
+    }
+
+    mBuilds++;
+    mBuildMilliseconds += MillisecondsSince(start);
+}
+
+void ShapeBvh::BuildNode(uint32_t nodeIndex, uint32_t begin, uint32_t end)
+{
+    const uint32_t leafSize = 4;
+
+    Node node;
+    if (end - begin <= leafSize)
+    {
+        node.boundsMin = glm::vec3(INFINITY);
+        node.boundsMax = glm::vec3(-INFINITY);
+        node.lastShape = -1;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            node.boundsMin = glm::min(node.boundsMin, mBounds[i].boundsMin);
+            node.boundsMax = glm::max(node.boundsMax, mBounds[i].boundsMax);
+            node.lastShape = std::max(node.lastShape, (int32_t)mBounds[i].shape);
+        }
+        node.first = begin;
+        node.count = end - begin;
+        mNodes[nodeIndex] = node;
+        return;
+    }
+
+    // both children next to each other, so a node only needs the index of the first; its bounds are theirs
+    uint32_t first = (uint32_t)mNodes.size();
+    mNodes.resize(mNodes.size() + 2);
+    uint32_t middle = begin + (end - begin) / 2;
+    BuildNode(first, begin, middle);
+    BuildNode(first + 1, middle, end);
+    node.boundsMin = glm::min(mNodes[first].boundsMin, mNodes[first + 1].boundsMin);
+    node.boundsMax = glm::max(mNodes[first].boundsMax, mNodes[first + 1].boundsMax);
+    node.lastShape = std::max(mNodes[first].lastShape, mNodes[first + 1].lastShape);
+    node.first = first;
+    node.count = 0;
+    mNodes[nodeIndex] = node;
+}
+
+// slab test up to maxDistance, the bounds of a shape are flat so the entry and exit can be the same point
+static bool HitBounds(const PickRay& ray, const glm::vec3& inverseDirection, float maxDistance, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    glm::vec3 t0 = (boundsMin - ray.origin) * inverseDirection;
+    glm::vec3 t1 = (boundsMax - ray.origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+    return enter <= exit && enter < maxDistance;
+}
+
+bool ShapeBvh::HitShape(const PickRay& ray, float maxDistance, uint32_t index) const
+{
+    const ShapeInstance& shape = mShapes[index];
+    if (std::abs(ray.direction.z) < 1e-6f)
+        return false;
+    // at or behind maxDistance fails the depth test, like an equal depth does
+    float t = (shape.center.z - ray.origin.z) / ray.direction.z;
+    if (t < 0.0f || t >= maxDistance)
+        return false;
+
+    // into the shape's axes, like LocalPos in Shape.vert
+    glm::vec2 offset = glm::vec2(ray.origin + ray.direction * t) - glm::vec2(shape.center);
+    float angle = ShapeAngle(shape);
+    glm::vec2 axisX = glm::vec2(std::cos(angle), std::sin(angle));
+    glm::vec2 local = glm::vec2(glm::dot(offset, axisX), glm::dot(offset, glm::vec2(-axisX.y, axisX.x)));
+
+    // the PICKING hit rule of Shape.frag
+    float distance = ShapeDistance(shape, local);
+    float strokeWidth = glm::unpackHalf1x16(shape.params[1]);
+    bool fill = (shape.fillColor >> 24) > 0;
+    bool stroke = strokeWidth > 0.0f && (shape.strokeColor >> 24) > 0;
+    return (fill && distance <= 0.0f) || (stroke && std::abs(distance) <= 0.5f * strokeWidth);
+}
+
+int ShapeBvh::Pick(const PickRay& ray, float maxDistance) const
+{
+    if (mNodes.empty())
+        return -1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    glm::vec3 inverseDirection = 1.0f / ray.direction;
+    int best = -1;
+    uint32_t stack[64];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const Node& node = mNodes[stack[--stackSize]];
+        // nothing below was drawn after the best hit so far
+        if (node.lastShape <= best || !HitBounds(ray, inverseDirection, maxDistance, node.boundsMin, node.boundsMax))
+            continue;
+        if (node.count == 0)
+        {
+            // the child with the later shapes first, its hits prune more of the other one
+            bool secondFirst = mNodes[node.first + 1].lastShape > mNodes[node.first].lastShape;
+            stack[stackSize++] = secondFirst ? node.first : node.first + 1;
+            stack[stackSize++] = secondFirst ? node.first + 1 : node.first;
+            continue;
+        }
+        for (uint32_t i = node.first; i < node.first + node.count; i++)
+        {
+            uint32_t shape = mBounds[i].shape;
+            if ((int)shape > best && HitBounds(ray, inverseDirection, maxDistance, mBounds[i].boundsMin, mBounds[i].boundsMax)
+                && HitShape(ray, maxDistance, shape))
+                best = (int)shape;
+        }
+    }
+
+    mPicks++;
+    mPickMilliseconds += MillisecondsSince(start);
+    return best;
+}
+
+int ShapeBvh::PickLinear(const PickRay& ray, float maxDistance) const
+{
+    // from the last shape drawn, the first hit is the one on top
+    for (size_t i = mShapes.size(); i > 0; i--)
+    {
+        if (HitShape(ray, maxDistance, (uint32_t)(i - 1)))
+            return (int)(i - 1);
+    }
+    return -1;
+}
+
+void ShapeBvh::Report() const
+{
+    if (mBuilds == 0)
+        return;
+
+    std::cout << "Shape BVH: " << mShapes.size() << " shapes in " << mNodes.size() << " nodes, " << mBuildMilliseconds / mBuilds << " ms per build";
+    if (mPicks > 0)
+        std::cout << ", " << mPickMilliseconds * 1000.0 / mPicks << " us per pick";
+    std::cout << std::endl;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "ShapeRenderer.h"
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class RenderTarget;
+class Shader;
+
+// Which shape is under a pixel, read back from the GPU without waiting on it. Pick draws the shape
+// ids (the Shape shaders with PICKING) into an R32UI target, scissored to the one pixel so the
+// rest of the target is never touched, and queues the read of that pixel into the next pixel pack
+// buffer of a ring behind a fence. Poll maps the reads that have finished, so the picked shape is
+// always at least a frame old; only when every buffer of the ring is still in flight does Pick
+// wait for the oldest one. The scene's depth under the pixel is copied into the target and the ids
+// are tested against it without writing, as the shape pass is, so shapes hidden behind the quads
+// are never picked; of the others the shape drawn last wins, the one on top in the scene.
+class GpuPicker
+{
+public:
+	GpuPicker(unsigned int bufferCount = 3);
+	~GpuPicker();
+	GpuPicker(const GpuPicker&) = delete;
+	GpuPicker& operator=(const GpuPicker&) = delete;
+
+	// redraws what shapeRenderer drew this frame into sceneTarget, x and y are the pixel from the
+	// bottom left of it. Without a depth attachment on sceneTarget nothing is hidden. Leaves the
+	// picker's target bound.
+	void Pick(ShapeRenderer& shapeRenderer, Shader& pickingShader, RenderTarget& sceneTarget, int x, int y);
+	// call once per frame before Pick, never waits
+	void Poll();
+
+	// index into the picked frame's ShapeBatch, -1 for none
+	int GetPickedShape() const { return mPickedShape; }
+	// frames between the read and its result
+	unsigned long long GetLatency() const { return mLatency; }
+
+	// waits for the reads still in flight and deletes the buffers and the target
+	void DeleteGpuPicker();
+	void Report() const;
+
+private:
+	struct Readback
+	{
+		unsigned int buffer = 0;
+		void* fence = nullptr;	// GLsync, kept opaque so the header doesn't need glad
+		unsigned long long frame = 0;
+	};
+
+	// false when not waiting and the read hasn't finished yet
+	bool Resolve(Readback& readback, bool wait);
+
+	std::unique_ptr<RenderTarget> mTarget;	// created by the first Pick, follows the framebuffer size
+	std::vector<Readback> mReadbacks;
+	unsigned int mNextReadback = 0;
+	unsigned int mOldestReadback = 0;
+	unsigned int mPendingReadbacks = 0;
+	unsigned long long mFrame = 0;
+
+	int mPickedShape = -1;
+	unsigned long long mLatency = 0;
+
+	unsigned long long mPicks = 0;
+	unsigned long long mResolved = 0;
+	unsigned long long mTotalLatency = 0;
+	unsigned long long mStalls = 0;
+	double mPickMilliseconds = 0.0;
+};
+
+// A ray in world space, direction normalized
+struct PickRay
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+// the ray from the camera through the center of pixel (x, y), from the bottom left of a viewport of viewportSize
+PickRay MakePickRay(const glm::mat4& viewProjection, int x, int y, const glm::vec2& viewportSize);
+// distance along the ray to the nearest triangle of an indexed mesh placed by model, INFINITY when it misses;
+// vertices start with a position, stride floats apart
+float IntersectMesh(const PickRay& ray, const std::vector<float>& vertices, unsigned int stride,
+	const std::vector<unsigned int>& indices, const glm::mat4& model);
+
+// The CPU alternative to GpuPicker: a bounding volume hierarchy over the shapes' bounds, built by
+// splitting their Morton order in halves, and the ray tested against each candidate's plane with the distance function of
+// Shape.frag and the same hit rule as its PICKING path, so both pick the same shape. The depth
+// test of the GPU pass is a distance along the ray: the caller finds the nearest opaque geometry
+// (IntersectMesh for the quads) and hits at or past it are hidden. The result is there the same
+// frame, at the cost of rebuilding the tree whenever the shapes move.
+class ShapeBvh
+{
+public:
+	void Build(const std::vector<ShapeInstance>& shapes);
+
+	// the shape drawn last of those the ray hits closer than maxDistance, -1 for none
+	int Pick(const PickRay& ray, float maxDistance = INFINITY) const;
+	// tests every shape, for comparison
+	int PickLinear(const PickRay& ray, float maxDistance = INFINITY) const;
+
+	size_t GetNodeCount() const { return mNodes.size(); }
+	void Report() const;
+
+private:
+	struct Node
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		uint32_t first;		// first child, the second follows it; the first of mBounds for leaves
+		uint32_t count;		// 0 for inner nodes
+		int32_t lastShape;	// highest shape index below, subtrees that can't beat the best hit are skipped
+	};
+
+	// a shape's bounds, flat on its plane; reordered by the build so every node's are contiguous
+	struct ShapeBounds
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		uint32_t shape;
+	};
+
+	// fills in the node over mBounds[begin, end), splitting it until the leaves are small
+	void BuildNode(uint32_t node, uint32_t begin, uint32_t end);
+	bool HitShape(const PickRay& ray, float maxDistance, uint32_t shape) const;
+
+	std::vector<ShapeInstance> mShapes;
+	std::vector<ShapeBounds> mBounds;	// the leaves refer to ranges of them
+	std::vector<Node> mNodes;
+
+	unsigned long long mBuilds = 0;
+	double mBuildMilliseconds = 0.0;
+	mutable unsigned long long mPicks = 0;
+	mutable double mPickMilliseconds = 0.0;
+};
@@ -0,0 +1,229 @@
+#include "PolylineRenderer.h"
+#include "ShapeRenderer.h"
+#include "Shader.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+PolylinePoint::PolylinePoint(const glm::vec3& position, float width, const glm::vec4& color)
+    : position(position), width(width), color(PackColorSRGB(color))
+{
+}
+
+// Polyline
+
+Polyline::Polyline(size_t capacity)
+    : mCapacity(capacity < 4 ? 4 : capacity)
+{
+    RenderDevice& device = GetRenderDevice();
+    mVertexArray = device.GenVertexArray();
+    device.BindVertexArray(mVertexArray);
+    mBuffer = device.GenBuffer();
+    device.BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    device.BufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(PolylinePoint), NULL, GL_DYNAMIC_DRAW);
+
+    // previous, start, end and next point of the segment, each a point further into the buffer
+    GLsizei stride = sizeof(PolylinePoint);
+    for (GLuint attribute = 0; attribute < 4; attribute++)
+        device.VertexAttribPointer(attribute, 3, GL_FLOAT, GL_FALSE, stride, attribute * stride + offsetof(PolylinePoint, position));
+    // width and color of the start point
+    device.VertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, stride + offsetof(PolylinePoint, width));
+    device.VertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, stride + offsetof(PolylinePoint, color));
+    for (GLuint attribute = 0; attribute <= 5; attribute++)
+    {
+        device.EnableVertexAttribArray(attribute);
+        device.VertexAttribDivisor(attribute, 1);
+    }
+    device.BindVertexArray(0);
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+Polyline::~Polyline()
+{
+    DeletePolyline();
+}
+
+static const size_t maxDirtyRanges = 16;
+
+void Polyline::MarkDirty(size_t first, size_t last)
+{
+    // edits usually continue where the last one stopped
+    if (!mDirtyRanges.empty() && first <= mDirtyRanges.back().second && last >= mDirtyRanges.back().first)
+    {
+        mDirtyRanges.back().first = std::min(mDirtyRanges.back().first, first);
+        mDirtyRanges.back().second = std::max(mDirtyRanges.back().second, last);
+        return;
+    }
+    mDirtyRanges.push_back({ first, last });
+    if (mDirtyRanges.size() <= maxDirtyRanges)
+        return;
+
+    // too many, merge the two closest; merging touching ones first usually frees enough
+    MergeDirtyRanges(0);
+    if (mDirtyRanges.size() <= maxDirtyRanges)
+        return;
+    size_t closest = 1;
+    for (size_t i = 2; i < mDirtyRanges.size(); i++)
+    {
+        if (mDirtyRanges[i].first - mDirtyRanges[i - 1].second < mDirtyRanges[closest].first - mDirtyRanges[closest - 1].second)
+            closest = i;
+    }
+    mDirtyRanges[closest - 1].second = mDirtyRanges[closest].second;
+    mDirtyRanges.erase(mDirtyRanges.begin() + closest);
+}
+
+void Polyline::MergeDirtyRanges(size_t gap)
+{
+    std::sort(mDirtyRanges.begin(), mDirtyRanges.end());
+    size_t merged = 0;
+    for (size_t i = 1; i < mDirtyRanges.size(); i++)
+    {
+        if (mDirtyRanges[i].first <= mDirtyRanges[merged].second + gap)
+            mDirtyRanges[merged].second = std::max(mDirtyRanges[merged].second, mDirtyRanges[i].second);
+        else
+            mDirtyRanges[++merged] = mDirtyRanges[i];
+    }
+    if (!mDirtyRanges.empty())
+        mDirtyRanges.resize(merged + 1);
+}
+
+void Polyline::SetPoints(const std::vector<PolylinePoint>& points)
+{
+    mPoints.clear();
+    if (!points.empty())
+    {
+        mPoints.reserve(points.size() + 2);
+        mPoints.push_back(points.front());
+        mPoints.insert(mPoints.end(), points.begin(), points.end());
+        mPoints.push_back(points.back());
+    }
+    MarkDirty(0, mPoints.size());
+}
+
+void Polyline::Append(const PolylinePoint& point)
+{
+    if (mPoints.empty())
+    {
+        mPoints.assign(3, point);
+        MarkDirty(0, 3);
+        return;
+    }
+    // the repeated last point becomes the new one and is repeated after it
+    mPoints.back() = point;
+    mPoints.push_back(point);
+    MarkDirty(mPoints.size() - 2, mPoints.size());
+}
+
+void Polyline::SetPoint(size_t index, const PolylinePoint& point)
+{
+    size_t first = index + 1;
+    size_t last = index + 2;
+    mPoints[index + 1] = point;
+    if (index == 0)
+    {
+        mPoints[0] = point;
+        first = 0;
+    }
+    if (index + 3 == mPoints.size())
+    {
+        mPoints.back() = point;
+        last = mPoints.size();
+    }
+    MarkDirty(first, last);
+}
+
+void Polyline::Clear()
+{
+    mPoints.clear();
+    mDirtyRanges.clear();
+}
+
+void Polyline::Upload()
+{
+    if (mPoints.size() > mCapacity)
+    {
+        while (mCapacity < mPoints.size())
+            mCapacity *= 2;
+        mReallocate = true;
+    }
+    if (!mReallocate && mDirtyRanges.empty())
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    device.BindBuffer(GL_ARRAY_BUFFER, mBuffer);
+    if (mReallocate)
+    {
+        // the attribute pointers stay valid, they refer to the buffer name and not its storage
+        device.BufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(PolylinePoint), NULL, GL_DYNAMIC_DRAW);
+        mDirtyRanges.assign(1, { 0, mPoints.size() });
+        mReallocate = false;
+    }
+    // a call per range, ranges a few points apart are cheaper sent together
+    MergeDirtyRanges(16);
+    for (const std::pair<size_t, size_t>& range : mDirtyRanges)
+    {
+        size_t last = std::min(range.second, mPoints.size());
+        if (range.first >= last)
+            continue;
+        size_t size = (last - range.first) * sizeof(PolylinePoint);
+        device.BufferSubData(GL_ARRAY_BUFFER, range.first * sizeof(PolylinePoint), size, &mPoints[range.first]);
+        mUploadedBytes += size;
+    }
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+    mDirtyRanges.clear();
+}
+
+void Polyline::Draw()
+{
+    Upload();
+    size_t pointCount = GetPointCount();
+    if (pointCount < 2 || !mVertexArray)
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    device.BindVertexArray(mVertexArray);
+    device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(pointCount - 1));
+}
+
+void Polyline::DeletePolyline()
+{
+    RenderDevice& device = GetRenderDevice();
+    if (mBuffer)
+        device.DeleteBuffer(mBuffer);
+    if (mVertexArray)
+        device.DeleteVertexArray(mVertexArray);
+    mBuffer = mVertexArray = 0;
+}
+
+// PolylineRenderer
+
+void PolylineRenderer::Draw(const std::vector<Polyline*>& polylines, Shader& shader)
+{
+    RenderDevice& device = GetRenderDevice();
+    // Polyline.frag writes premultiplied alpha, like the shapes
+    device.Enable(GL_BLEND);
+    device.BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    shader.UseProgram();
+    for (Polyline* polyline : polylines)
+    {
+        unsigned long long uploadedBytes = polyline->GetUploadedBytes();
+        polyline->Draw();
+        mUploadedBytes += polyline->GetUploadedBytes() - uploadedBytes;
+        mPointBytes += polyline->GetPointCount() * sizeof(PolylinePoint);
+        mSegments += polyline->GetPointCount() > 1 ? polyline->GetPointCount() - 1 : 0;
+    }
+    device.Disable(GL_BLEND);
+    mFrames++;
+}
+
+void PolylineRenderer::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    std::cout << "Polylines: " << (double)mSegments / mFrames << " segments per frame, " << (double)mUploadedBytes / mFrames
+        << " bytes uploaded per frame against " << (double)mPointBytes / mFrames << " for uploading every point" << std::endl;
+}
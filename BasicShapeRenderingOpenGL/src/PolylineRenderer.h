@@ -0,0 +1,84 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class Shader;
+
+// A point of a polyline, the segment to the next point takes its width and color
+struct PolylinePoint
+{
+	PolylinePoint() = default;
+	// color is linear and packed to sRGB RGBA8
+	PolylinePoint(const glm::vec3& position, float width, const glm::vec4& color);
+
+	glm::vec3 position;
+	float width = 1.0f;		// pixels, widths below a pixel fade out instead of thinning
+	uint32_t color = 0;
+};
+static_assert(sizeof(PolylinePoint) == 20, "PolylinePoint has to match the attribute layout of Polyline.vert");
+
+// Points of one polyline on the CPU and in a vertex buffer. The buffer holds the first and the
+// last point twice, so segment i reads points i - 1 to i + 2 as four attributes with a divisor of
+// one at consecutive offsets and knows both of its neighbours. Edits are kept as a few dirty
+// ranges and Upload sends each with glBufferSubData, so appending to or editing a few points of a
+// long line costs those points and not the line.
+class Polyline
+{
+public:
+	Polyline(size_t capacity = 1024);
+	~Polyline();
+	Polyline(const Polyline&) = delete;
+	Polyline& operator=(const Polyline&) = delete;
+
+	void SetPoints(const std::vector<PolylinePoint>& points);
+	void Append(const PolylinePoint& point);
+	void SetPoint(size_t index, const PolylinePoint& point);
+	void Clear();
+
+	size_t GetPointCount() const { return mPoints.empty() ? 0 : mPoints.size() - 2; }
+	const PolylinePoint& GetPoint(size_t index) const { return mPoints[index + 1]; }
+
+	// sends the points changed since the last upload, everything when the buffer had to grow
+	void Upload();
+	// one instanced strip of a quad per segment, with the program and blending already set
+	void Draw();
+	void DeletePolyline();
+
+	unsigned long long GetUploadedBytes() const { return mUploadedBytes; }
+
+private:
+	// [first, last) of mPoints indices; past a handful of ranges the closest ones are merged
+	void MarkDirty(size_t first, size_t last);
+	// sorts the ranges and joins the ones that overlap, touch or are at most gap points apart
+	void MergeDirtyRanges(size_t gap);
+
+	std::vector<PolylinePoint> mPoints;	// what the buffer holds, the endpoints repeated
+	size_t mCapacity;					// points the buffer has room for
+	std::vector<std::pair<size_t, size_t>> mDirtyRanges;
+	bool mReallocate = false;
+
+	unsigned int mVertexArray = 0;
+	unsigned int mBuffer = 0;
+	unsigned long long mUploadedBytes = 0;
+};
+
+// Draws polylines with Polyline.vert/.frag: each segment is extruded in screen space to its
+// pixel width plus a pixel for the antialiased edge, neighbouring segments meet at a miter and
+// open ends and sharp turns get round caps. Coverage comes from the distance to the segment.
+class PolylineRenderer
+{
+public:
+	// uploads what changed and draws every polyline, blending over what's drawn so far
+	void Draw(const std::vector<Polyline*>& polylines, Shader& shader);
+
+	void Report() const;
+
+private:
+	unsigned long long mFrames = 0;
+	unsigned long long mSegments = 0;
+	unsigned long long mUploadedBytes = 0;
+	unsigned long long mPointBytes = 0;	// what re-uploading every line each frame would have sent
+};
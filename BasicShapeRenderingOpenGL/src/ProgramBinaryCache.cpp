@@ -0,0 +1,105 @@
+#include "ProgramBinaryCache.h"
+#include "AssetCache.h"
+
+#include <glad/glad.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static const unsigned int ProgramBinaryMagic = 0x4E494250;	// "PBIN"
+
+struct ProgramBinaryHeader
+{
+	unsigned int magic;
+	unsigned int format;
+	double compileMilliseconds;
+};
+
+ProgramBinaryCache::ProgramBinaryCache(AssetCache& assetCache)
+    : mAssetCache(assetCache)
+{
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    mSupported = formats > 0;
+
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    mDriver = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+}
+
+std::string ProgramBinaryCache::GetKey(const char* vertexShaderSource, const char* fragmentShaderSource) const
+{
+    std::string identity = mDriver + "\n" + vertexShaderSource + "\n" + fragmentShaderSource;
+    return mAssetCache.GetKey(identity.data(), identity.size(), "program");
+}
+
+unsigned int ProgramBinaryCache::Load(const std::string& key)
+{
+    if (!mSupported)
+        return 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!mAssetCache.Load(key, file) || file.GetSize() <= sizeof(ProgramBinaryHeader))
+    {
+        mStats.misses++;
+        return 0;
+    }
+
+    ProgramBinaryHeader header;
+    memcpy(&header, file.GetData(), sizeof(header));
+    if (header.magic != ProgramBinaryMagic)
+    {
+        mStats.misses++;
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, file.GetData() + sizeof(header), (int)(file.GetSize() - sizeof(header)));
+
+    // a driver update or different GPU makes old binaries invalid, that shows up as a failed link
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        mStats.rejected++;
+        mStats.misses++;
+        return 0;
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    mStats.hits++;
+    mStats.millisecondsSaved += header.compileMilliseconds - elapsed.count();
+    return program;
+}
+
+void ProgramBinaryCache::Store(const std::string& key, unsigned int program, double compileMilliseconds)
+{
+    if (!mSupported)
+        return;
+
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<unsigned char> data(sizeof(ProgramBinaryHeader) + length);
+    ProgramBinaryHeader header = { ProgramBinaryMagic, 0, compileMilliseconds };
+    glGetProgramBinary(program, length, NULL, &header.format, data.data() + sizeof(header));
+    memcpy(data.data(), &header, sizeof(header));
+
+    mAssetCache.Store(key, data.data(), data.size());
+}
+
+void ProgramBinaryCache::Report() const
+{
+    unsigned int total = mStats.hits + mStats.misses;
+    std::cout << "Program binary cache: " << mStats.hits << "/" << total << " hits";
+    if (mStats.rejected)
+        std::cout << " (" << mStats.rejected << " rejected by the driver)";
+    std::cout << ", saved " << mStats.millisecondsSaved << " ms" << std::endl;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+
+class AssetCache;
+
+struct ProgramBinaryCacheStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int rejected = 0;		// binaries the driver refused, e.g. after a driver update
+	double millisecondsSaved = 0.0;	// recorded compile+link time minus binary load time
+};
+
+// Stores linked programs through glGetProgramBinary in the AssetCache so later runs skip
+// compiling and linking. Keys cover the full sources (so any defines baked into them) and the
+// driver vendor/renderer/version, a binary the driver rejects falls back to a normal compile.
+class ProgramBinaryCache
+{
+public:
+	// needs a current GL context
+	ProgramBinaryCache(AssetCache& assetCache);
+
+	bool IsSupported() const { return mSupported; }
+	std::string GetKey(const char* vertexShaderSource, const char* fragmentShaderSource) const;
+
+	// linked program created from the cached binary, 0 on a miss or rejected binary
+	unsigned int Load(const std::string& key);
+	void Store(const std::string& key, unsigned int program, double compileMilliseconds);
+
+	const ProgramBinaryCacheStats& GetStats() const { return mStats; }
+	void Report() const;
+
+private:
+	AssetCache& mAssetCache;
+	std::string mDriver;
+	bool mSupported = false;
+	ProgramBinaryCacheStats mStats;
+};
@@ -0,0 +1,789 @@
+#include "RenderDevice.h"
+#include "GLExtensions.h"
+
+#include <cstring>
+#include <iostream>
+
+static GLDevice glDevice;
+static RenderDevice* currentDevice = &glDevice;
+
+RenderDevice& GetRenderDevice()
+{
+    return *currentDevice;
+}
+
+void SetRenderDevice(RenderDevice* device)
+{
+    currentDevice = device ? device : &glDevice;
+}
+
+// GLDevice
+
+GLuint GLDevice::GenBuffer() { GLuint buffer = 0; glGenBuffers(1, &buffer); return buffer; }
+void GLDevice::DeleteBuffer(GLuint buffer) { glDeleteBuffers(1, &buffer); }
+void GLDevice::BindBuffer(GLenum target, GLuint buffer) { glBindBuffer(target, buffer); }
+void GLDevice::BindBufferBase(GLenum target, GLuint index, GLuint buffer) { glBindBufferBase(target, index, buffer); }
+void GLDevice::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) { glBindBufferRange(target, index, buffer, offset, size); }
+void GLDevice::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) { glBufferData(target, size, data, usage); }
+void GLDevice::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) { glBufferSubData(target, offset, size, data); }
+
+GLuint GLDevice::GenVertexArray() { GLuint vertexArray = 0; glGenVertexArrays(1, &vertexArray); return vertexArray; }
+void GLDevice::DeleteVertexArray(GLuint vertexArray) { glDeleteVertexArrays(1, &vertexArray); }
+void GLDevice::BindVertexArray(GLuint vertexArray) { glBindVertexArray(vertexArray); }
+void GLDevice::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset) { glVertexAttribPointer(index, size, type, normalized, stride, (void*)offset); }
+void GLDevice::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) { glVertexAttribIPointer(index, size, type, stride, (void*)offset); }
+void GLDevice::EnableVertexAttribArray(GLuint index) { glEnableVertexAttribArray(index); }
+void GLDevice::VertexAttribDivisor(GLuint index, GLuint divisor) { glVertexAttribDivisor(index, divisor); }
+
+GLuint GLDevice::GenTexture() { GLuint texture = 0; glGenTextures(1, &texture); return texture; }
+void GLDevice::DeleteTexture(GLuint texture) { glDeleteTextures(1, &texture); }
+void GLDevice::BindTexture(GLenum target, GLuint texture) { glBindTexture(target, texture); }
+void GLDevice::BindTextureUnit(GLuint unit, GLuint texture) { glBindTextureUnit(unit, texture); }
+void GLDevice::TexParameteri(GLenum target, GLenum name, GLint value) { glTexParameteri(target, name, value); }
+void GLDevice::TexParameteriv(GLenum target, GLenum name, const GLint* values) { glTexParameteriv(target, name, values); }
+void GLDevice::TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) { glTexStorage2D(target, levels, internalFormat, width, height); }
+void GLDevice::TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) { glTexSubImage2D(target, level, x, y, width, height, format, type, pixels); }
+void GLDevice::CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) { glCompressedTexSubImage2D(target, level, x, y, width, height, format, imageSize, data); }
+void GLDevice::GenerateMipmap(GLenum target) { glGenerateMipmap(target); }
+void GLDevice::PixelStorei(GLenum name, GLint value) { glPixelStorei(name, value); }
+
+GLuint GLDevice::GenFramebuffer() { GLuint framebuffer = 0; glGenFramebuffers(1, &framebuffer); return framebuffer; }
+void GLDevice::DeleteFramebuffer(GLuint framebuffer) { glDeleteFramebuffers(1, &framebuffer); }
+void GLDevice::BindFramebuffer(GLenum target, GLuint framebuffer) { glBindFramebuffer(target, framebuffer); }
+void GLDevice::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) { glFramebufferTexture2D(target, attachment, textureTarget, texture, level); }
+void GLDevice::FramebufferRenderbuffer(GLenum target, GLenum attachment, GLuint renderbuffer) { glFramebufferRenderbuffer(target, attachment, GL_RENDERBUFFER, renderbuffer); }
+GLenum GLDevice::CheckFramebufferStatus(GLenum target) { return glCheckFramebufferStatus(target); }
+void GLDevice::BlitFramebuffer(GLint sourceX0, GLint sourceY0, GLint sourceX1, GLint sourceY1, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask, GLenum filter) { glBlitFramebuffer(sourceX0, sourceY0, sourceX1, sourceY1, x0, y0, x1, y1, mask, filter); }
+GLuint GLDevice::GenRenderbuffer() { GLuint renderbuffer = 0; glGenRenderbuffers(1, &renderbuffer); return renderbuffer; }
+void GLDevice::DeleteRenderbuffer(GLuint renderbuffer) { glDeleteRenderbuffers(1, &renderbuffer); }
+void GLDevice::BindRenderbuffer(GLuint renderbuffer) { glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer); }
+void GLDevice::RenderbufferStorageMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height) { glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internalFormat, width, height); }
+
+GLuint GLDevice::CreateShader(GLenum type) { return glCreateShader(type); }
+void GLDevice::ShaderSource(GLuint shader, const char* source) { glShaderSource(shader, 1, &source, NULL); }
+void GLDevice::CompileShader(GLuint shader) { glCompileShader(shader); }
+void GLDevice::GetShaderiv(GLuint shader, GLenum name, GLint* value) { glGetShaderiv(shader, name, value); }
+void GLDevice::GetShaderInfoLog(GLuint shader, GLsizei bufferSize, char* log) { glGetShaderInfoLog(shader, bufferSize, NULL, log); }
+void GLDevice::DeleteShader(GLuint shader) { glDeleteShader(shader); }
+GLuint GLDevice::CreateProgram() { return glCreateProgram(); }
+void GLDevice::AttachShader(GLuint program, GLuint shader) { glAttachShader(program, shader); }
+void GLDevice::ProgramParameteri(GLuint program, GLenum name, GLint value) { glProgramParameteri(program, name, value); }
+void GLDevice::TransformFeedbackVaryings(GLuint program, GLsizei count, const char* const* varyings, GLenum bufferMode) { glTransformFeedbackVaryings(program, count, varyings, bufferMode); }
+void GLDevice::LinkProgram(GLuint program) { glLinkProgram(program); }
+void GLDevice::GetProgramiv(GLuint program, GLenum name, GLint* value) { glGetProgramiv(program, name, value); }
+void GLDevice::GetProgramInfoLog(GLuint program, GLsizei bufferSize, char* log) { glGetProgramInfoLog(program, bufferSize, NULL, log); }
+void GLDevice::DeleteProgram(GLuint program) { glDeleteProgram(program); }
+void GLDevice::UseProgram(GLuint program) { glUseProgram(program); }
+GLint GLDevice::GetUniformLocation(GLuint program, const char* name) { return glGetUniformLocation(program, name); }
+void GLDevice::Uniform1i(GLint location, GLint value) { glUniform1i(location, value); }
+void GLDevice::Uniform1f(GLint location, GLfloat value) { glUniform1f(location, value); }
+void GLDevice::Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) { glUniform3f(location, x, y, z); }
+void GLDevice::Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) { glUniform4f(location, x, y, z, w); }
+void GLDevice::UniformMatrix3fv(GLint location, const GLfloat* value) { glUniformMatrix3fv(location, 1, GL_FALSE, value); }
+void GLDevice::UniformMatrix4fv(GLint location, const GLfloat* value) { glUniformMatrix4fv(location, 1, GL_FALSE, value); }
+void GLDevice::ProgramUniform1i(GLuint program, GLint location, GLint value) { glProgramUniform1i(program, location, value); }
+void GLDevice::ProgramUniform1f(GLuint program, GLint location, GLfloat value) { glProgramUniform1f(program, location, value); }
+void GLDevice::ProgramUniform3fv(GLuint program, GLint location, const GLfloat* value) { glProgramUniform3fv(program, location, 1, value); }
+void GLDevice::ProgramUniform4fv(GLuint program, GLint location, const GLfloat* value) { glProgramUniform4fv(program, location, 1, value); }
+void GLDevice::ProgramUniformMatrix3fv(GLuint program, GLint location, const GLfloat* value) { glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, value); }
+void GLDevice::ProgramUniformMatrix4fv(GLuint program, GLint location, const GLfloat* value) { glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, value); }
+void GLDevice::UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) { glUniformBlockBinding(program, blockIndex, binding); }
+void GLDevice::GetActiveUniformBlockiv(GLuint program, GLuint blockIndex, GLenum name, GLint* value) { glGetActiveUniformBlockiv(program, blockIndex, name, value); }
+void GLDevice::GetActiveUniformBlockName(GLuint program, GLuint blockIndex, GLsizei bufferSize, char* name) { glGetActiveUniformBlockName(program, blockIndex, bufferSize, NULL, name); }
+
+void GLDevice::GetIntegerv(GLenum name, GLint* value) { glGetIntegerv(name, value); }
+void GLDevice::Enable(GLenum capability) { glEnable(capability); }
+void GLDevice::Disable(GLenum capability) { glDisable(capability); }
+void GLDevice::BlendFunc(GLenum source, GLenum destination) { glBlendFunc(source, destination); }
+void GLDevice::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) { glClearColor(r, g, b, a); }
+void GLDevice::Clear(GLbitfield mask) { glClear(mask); }
+void GLDevice::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) { glViewport(x, y, width, height); }
+void GLDevice::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instanceCount) { glDrawElementsInstanced(mode, count, type, (void*)offset, instanceCount); }
+void GLDevice::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) { glDrawArraysInstanced(mode, first, count, instanceCount); }
+void GLDevice::DrawArrays(GLenum mode, GLint first, GLsizei count) { glDrawArrays(mode, first, count); }
+void GLDevice::BeginTransformFeedback(GLenum primitiveMode) { glBeginTransformFeedback(primitiveMode); }
+void GLDevice::EndTransformFeedback() { glEndTransformFeedback(); }
+void GLDevice::Scissor(GLint x, GLint y, GLsizei width, GLsizei height) { glScissor(x, y, width, height); }
+void GLDevice::ClearBufferuiv(GLenum buffer, GLint drawBuffer, const GLuint* value) { glClearBufferuiv(buffer, drawBuffer, value); }
+
+void GLDevice::ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, size_t offset) { glReadPixels(x, y, width, height, format, type, (void*)offset); }
+void* GLDevice::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) { return glMapBufferRange(target, offset, length, access); }
+void GLDevice::UnmapBuffer(GLenum target) { glUnmapBuffer(target); }
+GLsync GLDevice::FenceSync() { return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+GLenum GLDevice::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) { return glClientWaitSync(sync, flags, timeout); }
+void GLDevice::DeleteSync(GLsync sync) { glDeleteSync(sync); }
+
+void GLDevice::ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) { glColorMask(r, g, b, a); }
+void GLDevice::DepthMask(GLboolean flag) { glDepthMask(flag); }
+GLuint GLDevice::GenQuery() { GLuint query; glGenQueries(1, &query); return query; }
+void GLDevice::DeleteQuery(GLuint query) { glDeleteQueries(1, &query); }
+void GLDevice::BeginQuery(GLenum target, GLuint query) { glBeginQuery(target, query); }
+void GLDevice::EndQuery(GLenum target) { glEndQuery(target); }
+void GLDevice::GetQueryObjectuiv(GLuint query, GLenum name, GLuint* value) { glGetQueryObjectuiv(query, name, value); }
+void GLDevice::BeginConditionalRender(GLuint query, GLenum mode) { glBeginConditionalRender(query, mode); }
+void GLDevice::EndConditionalRender() { glEndConditionalRender(); }
+
+void GLDevice::DrawBuffer(GLenum buffer) { glDrawBuffer(buffer); }
+void GLDevice::GetQueryObjectuivToBuffer(GLuint query, GLenum name, size_t offset) { glGetQueryObjectuiv(query, name, (GLuint*)offset); }
+// core in 4.0, the 3.3 context only has it through GLExtensions
+void GLDevice::DrawArraysIndirect(GLenum mode, size_t offset) { glExtensions.DrawArraysIndirect(mode, (const void*)offset); }
+
+// NullDevice
+
+static const char* renderCallNames[RenderCallCount] =
+{
+    "GenBuffer", "DeleteBuffer", "BindBuffer", "BindBufferBase", "BindBufferRange",
+    "BufferData", "BufferSubData",
+    "GenVertexArray", "DeleteVertexArray", "BindVertexArray", "VertexAttribPointer", "VertexAttribIPointer",
+    "EnableVertexAttribArray", "VertexAttribDivisor",
+    "GenTexture", "DeleteTexture", "BindTexture", "BindTextureUnit", "TexParameteri",
+    "TexParameteriv", "TexStorage2D", "TexSubImage2D", "CompressedTexSubImage2D",
+    "GenerateMipmap", "PixelStorei",
+    "GenFramebuffer", "DeleteFramebuffer", "BindFramebuffer", "FramebufferTexture2D",
+    "FramebufferRenderbuffer", "CheckFramebufferStatus", "BlitFramebuffer", "GenRenderbuffer",
+    "DeleteRenderbuffer", "BindRenderbuffer", "RenderbufferStorageMultisample",
+    "CreateShader", "ShaderSource", "CompileShader", "GetShaderiv", "GetShaderInfoLog",
+    "DeleteShader", "CreateProgram", "AttachShader", "ProgramParameteri", "TransformFeedbackVaryings",
+    "LinkProgram", "GetProgramiv", "GetProgramInfoLog", "DeleteProgram", "UseProgram", "GetUniformLocation",
+    "Uniform", "ProgramUniform", "UniformBlockBinding", "GetActiveUniformBlockiv",
+    "GetActiveUniformBlockName",
+    "GetIntegerv", "Enable", "Disable", "BlendFunc",
+    "ClearColor", "Clear", "Viewport", "DrawElementsInstanced", "DrawArraysInstanced",
+    "DrawArrays", "BeginTransformFeedback", "EndTransformFeedback", "Scissor", "ClearBufferuiv",
+    "ReadPixels", "MapBufferRange", "UnmapBuffer", "FenceSync", "ClientWaitSync", "DeleteSync",
+    "ColorMask", "DepthMask", "GenQuery", "DeleteQuery", "BeginQuery", "EndQuery",
+    "GetQueryObjectuiv", "BeginConditionalRender", "EndConditionalRender",
+    "DrawBuffer", "GetQueryObjectuivToBuffer", "DrawArraysIndirect",
+};
+
+const char* GetRenderCallName(RenderCall call)
+{
+    return call >= 0 && call < RenderCallCount ? renderCallNames[call] : "Unknown";
+}
+
+// binding slots, the kind in the top bits so targets and units can't collide
+enum BindingKind { BindingBuffer = 1, BindingBufferIndexed, BindingVertexArray, BindingTexture, BindingTextureUnit, BindingProgram, BindingFramebuffer, BindingRenderbuffer, BindingCapability, BindingBlendFunc, BindingWriteMask };
+
+static long long BindingSlot(BindingKind kind, long long target = 0, long long index = 0)
+{
+    return ((long long)kind << 56) | (target << 24) | index;
+}
+
+static long long TexelSize(GLenum format, GLenum type)
+{
+    long long channels = 4;
+    switch (format)
+    {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: channels = 1; break;
+    case GL_RG: case GL_RG_INTEGER: channels = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: channels = 3; break;
+    default: break;
+    }
+    switch (type)
+    {
+    case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return channels * 2;
+    case GL_INT: case GL_UNSIGNED_INT: case GL_FLOAT: return channels * 4;
+    default: return channels;
+    }
+}
+
+void NullDevice::Record(RenderCall call, std::initializer_list<long long> arguments)
+{
+    mStats.calls[call]++;
+    mStats.totalCalls++;
+    if (!mCommandStream)
+        return;
+
+    *mCommandStream << renderCallNames[call];
+    for (long long argument : arguments)
+        *mCommandStream << ' ' << argument;
+    *mCommandStream << '\n';
+}
+
+void NullDevice::TrackBinding(long long slot, long long value)
+{
+    auto found = mBindings.find(slot);
+    long long previous = found != mBindings.end() ? found->second : 0;
+    if (previous == value)
+    {
+        mStats.redundantBinds++;
+        return;
+    }
+    mBindings[slot] = value;
+    mStats.stateChanges++;
+}
+
+void NullDevice::Report() const
+{
+    std::cout << "Null device: " << mStats.totalCalls << " calls, " << mStats.draws << " draws, " << mStats.blits << " blits, "
+        << mStats.bytesUploaded << " bytes uploaded, " << mStats.bytesRead << " bytes read back, " << mStats.stateChanges << " state changes, "
+        << mStats.redundantBinds << " redundant binds" << std::endl;
+    for (int i = 0; i < RenderCallCount; i++)
+    {
+        if (mStats.calls[i])
+            std::cout << "  " << renderCallNames[i] << ": " << mStats.calls[i] << std::endl;
+    }
+}
+
+GLuint NullDevice::GenBuffer()
+{
+    GLuint buffer = mNextName++;
+    Record(RenderCallGenBuffer, { buffer });
+    return buffer;
+}
+
+void NullDevice::DeleteBuffer(GLuint buffer)
+{
+    Record(RenderCallDeleteBuffer, { buffer });
+    // like GL, deleting a bound object unbinds it
+    for (auto& binding : mBindings)
+    {
+        if ((GLuint)binding.second == buffer)
+            binding.second = 0;
+    }
+}
+
+void NullDevice::BindBuffer(GLenum target, GLuint buffer)
+{
+    Record(RenderCallBindBuffer, { target, buffer });
+    TrackBinding(BindingSlot(BindingBuffer, target), buffer);
+}
+
+void NullDevice::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    Record(RenderCallBindBufferBase, { target, index, buffer });
+    TrackBinding(BindingSlot(BindingBufferIndexed, target, index), buffer);
+}
+
+void NullDevice::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    Record(RenderCallBindBufferRange, { target, index, buffer, (long long)offset, (long long)size });
+    // the offset is part of the binding, the name stays in the low bits for DeleteBuffer
+    TrackBinding(BindingSlot(BindingBufferIndexed, target, index), ((long long)offset << 32) | buffer);
+}
+
+void NullDevice::BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    Record(RenderCallBufferData, { target, (long long)size, usage });
+    if (data)
+        mStats.bytesUploaded += size;
+}
+
+void NullDevice::BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    Record(RenderCallBufferSubData, { target, (long long)offset, (long long)size });
+    mStats.bytesUploaded += size;
+}
+
+GLuint NullDevice::GenVertexArray()
+{
+    GLuint vertexArray = mNextName++;
+    Record(RenderCallGenVertexArray, { vertexArray });
+    return vertexArray;
+}
+
+void NullDevice::DeleteVertexArray(GLuint vertexArray)
+{
+    Record(RenderCallDeleteVertexArray, { vertexArray });
+    long long& bound = mBindings[BindingSlot(BindingVertexArray)];
+    if (bound == vertexArray)
+        bound = 0;
+}
+
+void NullDevice::BindVertexArray(GLuint vertexArray)
+{
+    Record(RenderCallBindVertexArray, { vertexArray });
+    TrackBinding(BindingSlot(BindingVertexArray), vertexArray);
+}
+
+void NullDevice::VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset)
+{
+    Record(RenderCallVertexAttribPointer, { index, size, type, normalized, stride, (long long)offset });
+}
+
+void NullDevice::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset)
+{
+    Record(RenderCallVertexAttribIPointer, { index, size, type, stride, (long long)offset });
+}
+
+void NullDevice::EnableVertexAttribArray(GLuint index)
+{
+    Record(RenderCallEnableVertexAttribArray, { index });
+}
+
+void NullDevice::VertexAttribDivisor(GLuint index, GLuint divisor)
+{
+    Record(RenderCallVertexAttribDivisor, { index, divisor });
+}
+
+GLuint NullDevice::GenTexture()
+{
+    GLuint texture = mNextName++;
+    Record(RenderCallGenTexture, { texture });
+    return texture;
+}
+
+void NullDevice::DeleteTexture(GLuint texture)
+{
+    Record(RenderCallDeleteTexture, { texture });
+    for (auto& binding : mBindings)
+    {
+        if ((GLuint)binding.second == texture)
+            binding.second = 0;
+    }
+}
+
+void NullDevice::BindTexture(GLenum target, GLuint texture)
+{
+    Record(RenderCallBindTexture, { target, texture });
+    TrackBinding(BindingSlot(BindingTexture, target), texture);
+}
+
+void NullDevice::BindTextureUnit(GLuint unit, GLuint texture)
+{
+    Record(RenderCallBindTextureUnit, { unit, texture });
+    TrackBinding(BindingSlot(BindingTextureUnit, 0, unit), texture);
+}
+
+void NullDevice::TexParameteri(GLenum target, GLenum name, GLint value)
+{
+    Record(RenderCallTexParameteri, { target, name, value });
+}
+
+void NullDevice::TexParameteriv(GLenum target, GLenum name, const GLint* values)
+{
+    Record(RenderCallTexParameteriv, { target, name, values[0] });
+}
+
+void NullDevice::TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    Record(RenderCallTexStorage2D, { target, levels, internalFormat, width, height });
+}
+
+void NullDevice::TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels)
+{
+    Record(RenderCallTexSubImage2D, { target, level, x, y, width, height, format, type });
+    if (pixels)
+        mStats.bytesUploaded += (unsigned long long)width * height * TexelSize(format, type);
+}
+
+void NullDevice::CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data)
+{
+    Record(RenderCallCompressedTexSubImage2D, { target, level, x, y, width, height, format, imageSize });
+    if (data)
+        mStats.bytesUploaded += imageSize;
+}
+
+void NullDevice::GenerateMipmap(GLenum target)
+{
+    Record(RenderCallGenerateMipmap, { target });
+}
+
+void NullDevice::PixelStorei(GLenum name, GLint value)
+{
+    Record(RenderCallPixelStorei, { name, value });
+}
+
+GLuint NullDevice::GenFramebuffer()
+{
+    GLuint framebuffer = mNextName++;
+    Record(RenderCallGenFramebuffer, { framebuffer });
+    return framebuffer;
+}
+
+void NullDevice::DeleteFramebuffer(GLuint framebuffer)
+{
+    Record(RenderCallDeleteFramebuffer, { framebuffer });
+    for (auto& binding : mBindings)
+    {
+        if ((GLuint)binding.second == framebuffer)
+            binding.second = 0;
+    }
+}
+
+void NullDevice::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    Record(RenderCallBindFramebuffer, { target, framebuffer });
+    // GL_FRAMEBUFFER sets both the draw and the read binding
+    if (target == GL_FRAMEBUFFER)
+    {
+        long long drawBound = mBindings[BindingSlot(BindingFramebuffer, GL_DRAW_FRAMEBUFFER)];
+        long long readBound = mBindings[BindingSlot(BindingFramebuffer, GL_READ_FRAMEBUFFER)];
+        if (drawBound == framebuffer && readBound == framebuffer)
+        {
+            mStats.redundantBinds++;
+            return;
+        }
+        mBindings[BindingSlot(BindingFramebuffer, GL_DRAW_FRAMEBUFFER)] = framebuffer;
+        mBindings[BindingSlot(BindingFramebuffer, GL_READ_FRAMEBUFFER)] = framebuffer;
+        mStats.stateChanges++;
+        return;
+    }
+    TrackBinding(BindingSlot(BindingFramebuffer, target), framebuffer);
+}
+
+void NullDevice::FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level)
+{
+    Record(RenderCallFramebufferTexture2D, { target, attachment, textureTarget, texture, level });
+}
+
+void NullDevice::FramebufferRenderbuffer(GLenum target, GLenum attachment, GLuint renderbuffer)
+{
+    Record(RenderCallFramebufferRenderbuffer, { target, attachment, renderbuffer });
+}
+
+GLenum NullDevice::CheckFramebufferStatus(GLenum target)
+{
+    Record(RenderCallCheckFramebufferStatus, { target });
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void NullDevice::BlitFramebuffer(GLint sourceX0, GLint sourceY0, GLint sourceX1, GLint sourceY1, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask, GLenum filter)
+{
+    Record(RenderCallBlitFramebuffer, { sourceX0, sourceY0, sourceX1, sourceY1, x0, y0, x1, y1, mask, filter });
+    mStats.blits++;
+}
+
+GLuint NullDevice::GenRenderbuffer()
+{
+    GLuint renderbuffer = mNextName++;
+    Record(RenderCallGenRenderbuffer, { renderbuffer });
+    return renderbuffer;
+}
+
+void NullDevice::DeleteRenderbuffer(GLuint renderbuffer)
+{
+    Record(RenderCallDeleteRenderbuffer, { renderbuffer });
+    long long& bound = mBindings[BindingSlot(BindingRenderbuffer)];
+    if (bound == renderbuffer)
+        bound = 0;
+}
+
+void NullDevice::BindRenderbuffer(GLuint renderbuffer)
+{
+    Record(RenderCallBindRenderbuffer, { renderbuffer });
+    TrackBinding(BindingSlot(BindingRenderbuffer), renderbuffer);
+}
+
+void NullDevice::RenderbufferStorageMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height)
+{
+    Record(RenderCallRenderbufferStorageMultisample, { samples, internalFormat, width, height });
+}
+
+GLuint NullDevice::CreateShader(GLenum type)
+{
+    GLuint shader = mNextName++;
+    Record(RenderCallCreateShader, { type, shader });
+    return shader;
+}
+
+void NullDevice::ShaderSource(GLuint shader, const char* source)
+{
+    Record(RenderCallShaderSource, { shader, (long long)strlen(source) });
+}
+
+void NullDevice::CompileShader(GLuint shader)
+{
+    Record(RenderCallCompileShader, { shader });
+}
+
+void NullDevice::GetShaderiv(GLuint shader, GLenum name, GLint* value)
+{
+    Record(RenderCallGetShaderiv, { shader, name });
+    *value = name == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+void NullDevice::GetShaderInfoLog(GLuint shader, GLsizei bufferSize, char* log)
+{
+    Record(RenderCallGetShaderInfoLog, { shader });
+    if (bufferSize > 0)
+        log[0] = '\0';
+}
+
+void NullDevice::DeleteShader(GLuint shader)
+{
+    Record(RenderCallDeleteShader, { shader });
+}
+
+GLuint NullDevice::CreateProgram()
+{
+    GLuint program = mNextName++;
+    Record(RenderCallCreateProgram, { program });
+    return program;
+}
+
+void NullDevice::AttachShader(GLuint program, GLuint shader)
+{
+    Record(RenderCallAttachShader, { program, shader });
+}
+
+void NullDevice::ProgramParameteri(GLuint program, GLenum name, GLint value)
+{
+    Record(RenderCallProgramParameteri, { program, name, value });
+}
+
+void NullDevice::TransformFeedbackVaryings(GLuint program, GLsizei count, const char* const* varyings, GLenum bufferMode)
+{
+    Record(RenderCallTransformFeedbackVaryings, { program, count, bufferMode });
+}
+
+void NullDevice::LinkProgram(GLuint program)
+{
+    Record(RenderCallLinkProgram, { program });
+}
+
+void NullDevice::GetProgramiv(GLuint program, GLenum name, GLint* value)
+{
+    Record(RenderCallGetProgramiv, { program, name });
+    *value = name == GL_LINK_STATUS || name == GL_COMPLETION_STATUS_KHR ? GL_TRUE : 0;
+}
+
+void NullDevice::GetProgramInfoLog(GLuint program, GLsizei bufferSize, char* log)
+{
+    Record(RenderCallGetProgramInfoLog, { program });
+    if (bufferSize > 0)
+        log[0] = '\0';
+}
+
+void NullDevice::DeleteProgram(GLuint program)
+{
+    Record(RenderCallDeleteProgram, { program });
+    long long& bound = mBindings[BindingSlot(BindingProgram)];
+    if (bound == program)
+        bound = 0;
+}
+
+void NullDevice::UseProgram(GLuint program)
+{
+    Record(RenderCallUseProgram, { program });
+    TrackBinding(BindingSlot(BindingProgram), program);
+}
+
+GLint NullDevice::GetUniformLocation(GLuint program, const char* name)
+{
+    // stable per program and name, so a swapped in program gets its own locations
+    auto found = mUniformLocations.find(std::make_pair(program, std::string(name)));
+    GLint location;
+    if (found != mUniformLocations.end())
+        location = found->second;
+    else
+        location = mUniformLocations[std::make_pair(program, std::string(name))] = mNextUniformLocation++;
+    Record(RenderCallGetUniformLocation, { program, location });
+    return location;
+}
+
+void NullDevice::Uniform1i(GLint location, GLint value) { Record(RenderCallUniform, { location, 1 }); mStats.bytesUploaded += sizeof(GLint); }
+void NullDevice::Uniform1f(GLint location, GLfloat value) { Record(RenderCallUniform, { location, 1 }); mStats.bytesUploaded += sizeof(GLfloat); }
+void NullDevice::Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) { Record(RenderCallUniform, { location, 3 }); mStats.bytesUploaded += 3 * sizeof(GLfloat); }
+void NullDevice::Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) { Record(RenderCallUniform, { location, 4 }); mStats.bytesUploaded += 4 * sizeof(GLfloat); }
+void NullDevice::UniformMatrix3fv(GLint location, const GLfloat* value) { Record(RenderCallUniform, { location, 9 }); mStats.bytesUploaded += 9 * sizeof(GLfloat); }
+void NullDevice::UniformMatrix4fv(GLint location, const GLfloat* value) { Record(RenderCallUniform, { location, 16 }); mStats.bytesUploaded += 16 * sizeof(GLfloat); }
+void NullDevice::ProgramUniform1i(GLuint program, GLint location, GLint value) { Record(RenderCallProgramUniform, { program, location, 1 }); mStats.bytesUploaded += sizeof(GLint); }
+void NullDevice::ProgramUniform1f(GLuint program, GLint location, GLfloat value) { Record(RenderCallProgramUniform, { program, location, 1 }); mStats.bytesUploaded += sizeof(GLfloat); }
+void NullDevice::ProgramUniform3fv(GLuint program, GLint location, const GLfloat* value) { Record(RenderCallProgramUniform, { program, location, 3 }); mStats.bytesUploaded += 3 * sizeof(GLfloat); }
+void NullDevice::ProgramUniform4fv(GLuint program, GLint location, const GLfloat* value) { Record(RenderCallProgramUniform, { program, location, 4 }); mStats.bytesUploaded += 4 * sizeof(GLfloat); }
+void NullDevice::ProgramUniformMatrix3fv(GLuint program, GLint location, const GLfloat* value) { Record(RenderCallProgramUniform, { program, location, 9 }); mStats.bytesUploaded += 9 * sizeof(GLfloat); }
+void NullDevice::ProgramUniformMatrix4fv(GLuint program, GLint location, const GLfloat* value) { Record(RenderCallProgramUniform, { program, location, 16 }); mStats.bytesUploaded += 16 * sizeof(GLfloat); }
+
+void NullDevice::UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding)
+{
+    Record(RenderCallUniformBlockBinding, { program, blockIndex, binding });
+}
+
+void NullDevice::GetActiveUniformBlockiv(GLuint program, GLuint blockIndex, GLenum name, GLint* value)
+{
+    Record(RenderCallGetActiveUniformBlockiv, { program, blockIndex, name });
+    *value = 0;
+}
+
+void NullDevice::GetActiveUniformBlockName(GLuint program, GLuint blockIndex, GLsizei bufferSize, char* name)
+{
+    Record(RenderCallGetActiveUniformBlockName, { program, blockIndex });
+    if (bufferSize > 0)
+        name[0] = '\0';
+}
+
+void NullDevice::GetIntegerv(GLenum name, GLint* value)
+{
+    Record(RenderCallGetIntegerv, { name });
+    *value = name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0;
+}
+
+void NullDevice::Enable(GLenum capability)
+{
+    Record(RenderCallEnable, { capability });
+    TrackBinding(BindingSlot(BindingCapability, capability), 1);
+}
+
+void NullDevice::Disable(GLenum capability)
+{
+    Record(RenderCallDisable, { capability });
+    TrackBinding(BindingSlot(BindingCapability, capability), 0);
+}
+
+void NullDevice::BlendFunc(GLenum source, GLenum destination)
+{
+    Record(RenderCallBlendFunc, { source, destination });
+    // GL starts out with GL_ONE, GL_ZERO
+    long long function = ((long long)source << 32) | destination;
+    if (mBindings.find(BindingSlot(BindingBlendFunc)) == mBindings.end())
+        mBindings[BindingSlot(BindingBlendFunc)] = ((long long)GL_ONE << 32) | GL_ZERO;
+    TrackBinding(BindingSlot(BindingBlendFunc), function);
+}
+
+void NullDevice::ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a)
+{
+    Record(RenderCallClearColor);
+}
+
+void NullDevice::Clear(GLbitfield mask)
+{
+    Record(RenderCallClear, { mask });
+}
+
+void NullDevice::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    Record(RenderCallViewport, { x, y, width, height });
+}
+
+void NullDevice::DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instanceCount)
+{
+    Record(RenderCallDrawElementsInstanced, { mode, count, type, (long long)offset, instanceCount });
+    mStats.draws++;
+}
+
+void NullDevice::DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+{
+    Record(RenderCallDrawArraysInstanced, { mode, first, count, instanceCount });
+    mStats.draws++;
+}
+
+void NullDevice::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    Record(RenderCallDrawArrays, { mode, first, count });
+    mStats.draws++;
+}
+
+void NullDevice::BeginTransformFeedback(GLenum primitiveMode)
+{
+    Record(RenderCallBeginTransformFeedback, { primitiveMode });
+}
+
+void NullDevice::EndTransformFeedback()
+{
+    Record(RenderCallEndTransformFeedback, {});
+}
+
+void NullDevice::Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    Record(RenderCallScissor, { x, y, width, height });
+}
+
+void NullDevice::ClearBufferuiv(GLenum buffer, GLint drawBuffer, const GLuint* value)
+{
+    Record(RenderCallClearBufferuiv, { buffer, drawBuffer, value[0] });
+}
+
+void NullDevice::ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, size_t offset)
+{
+    Record(RenderCallReadPixels, { x, y, width, height, format, type, (long long)offset });
+    mStats.bytesRead += (unsigned long long)width * height * TexelSize(format, type);
+}
+
+void* NullDevice::MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+    Record(RenderCallMapBufferRange, { target, (long long)offset, (long long)length, access });
+    mMappedBuffer.assign((size_t)length, 0);
+    return mMappedBuffer.data();
+}
+
+void NullDevice::UnmapBuffer(GLenum target)
+{
+    Record(RenderCallUnmapBuffer, { target });
+}
+
+GLsync NullDevice::FenceSync()
+{
+    GLsync sync = (GLsync)mNextSync++;
+    Record(RenderCallFenceSync, { (long long)(uintptr_t)sync });
+    return sync;
+}
+
+GLenum NullDevice::ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+    Record(RenderCallClientWaitSync, { (long long)(uintptr_t)sync, flags });
+    return GL_ALREADY_SIGNALED;
+}
+
+void NullDevice::DeleteSync(GLsync sync)
+{
+    Record(RenderCallDeleteSync, { (long long)(uintptr_t)sync });
+}
+
+void NullDevice::ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a)
+{
+    Record(RenderCallColorMask, { r, g, b, a });
+    // tracked as the channels that are off, so the untracked default of 0 is GL's
+    TrackBinding(BindingSlot(BindingWriteMask, GL_COLOR), (r ? 0 : 1) | (g ? 0 : 2) | (b ? 0 : 4) | (a ? 0 : 8));
+}
+
+void NullDevice::DepthMask(GLboolean flag)
+{
+    Record(RenderCallDepthMask, { flag });
+    TrackBinding(BindingSlot(BindingWriteMask, GL_DEPTH), flag ? 0 : 1);
+}
+
+GLuint NullDevice::GenQuery()
+{
+    GLuint query = mNextName++;
+    Record(RenderCallGenQuery, { query });
+    return query;
+}
+
+void NullDevice::DeleteQuery(GLuint query)
+{
+    Record(RenderCallDeleteQuery, { query });
+}
+
+void NullDevice::BeginQuery(GLenum target, GLuint query)
+{
+    Record(RenderCallBeginQuery, { target, query });
+}
+
+void NullDevice::EndQuery(GLenum target)
+{
+    Record(RenderCallEndQuery, { target });
+}
+
+void NullDevice::GetQueryObjectuiv(GLuint query, GLenum name, GLuint* value)
+{
+    Record(RenderCallGetQueryObjectuiv, { query, name });
+    // available, and for occlusion queries passed
+    *value = 1;
+}
+
+void NullDevice::BeginConditionalRender(GLuint query, GLenum mode)
+{
+    Record(RenderCallBeginConditionalRender, { query, mode });
+}
+
+void NullDevice::EndConditionalRender()
+{
+    Record(RenderCallEndConditionalRender);
+}
+
+void NullDevice::DrawBuffer(GLenum buffer)
+{
+    Record(RenderCallDrawBuffer, { buffer });
+}
+
+void NullDevice::GetQueryObjectuivToBuffer(GLuint query, GLenum name, size_t offset)
+{
+    Record(RenderCallGetQueryObjectuivToBuffer, { query, name, (long long)offset });
+}
+
+void NullDevice::DrawArraysIndirect(GLenum mode, size_t offset)
+{
+    Record(RenderCallDrawArraysIndirect, { mode, (long long)offset });
+    mStats.draws++;
+}
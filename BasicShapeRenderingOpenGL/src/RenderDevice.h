@@ -0,0 +1,434 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The GL calls the wrappers (VertexArray, VertexBuffer, IndexBuffer, UniformBuffer, Shader,
+// Texture, RenderTarget) and the draw loop make, behind an interface so their CPU side cost can be measured
+// and tested without a context. Names and arguments follow the GL functions.
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// buffers
+	virtual GLuint GenBuffer() = 0;
+	virtual void DeleteBuffer(GLuint buffer) = 0;
+	virtual void BindBuffer(GLenum target, GLuint buffer) = 0;
+	virtual void BindBufferBase(GLenum target, GLuint index, GLuint buffer) = 0;
+	virtual void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) = 0;
+	virtual void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+	virtual void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+
+	// vertex arrays
+	virtual GLuint GenVertexArray() = 0;
+	virtual void DeleteVertexArray(GLuint vertexArray) = 0;
+	virtual void BindVertexArray(GLuint vertexArray) = 0;
+	virtual void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset) = 0;
+	virtual void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) = 0;
+	virtual void EnableVertexAttribArray(GLuint index) = 0;
+	virtual void VertexAttribDivisor(GLuint index, GLuint divisor) = 0;
+
+	// textures
+	virtual GLuint GenTexture() = 0;
+	virtual void DeleteTexture(GLuint texture) = 0;
+	virtual void BindTexture(GLenum target, GLuint texture) = 0;
+	virtual void BindTextureUnit(GLuint unit, GLuint texture) = 0;
+	virtual void TexParameteri(GLenum target, GLenum name, GLint value) = 0;
+	virtual void TexParameteriv(GLenum target, GLenum name, const GLint* values) = 0;
+	virtual void TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) = 0;
+	virtual void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) = 0;
+	virtual void CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) = 0;
+	virtual void GenerateMipmap(GLenum target) = 0;
+	virtual void PixelStorei(GLenum name, GLint value) = 0;
+
+	// framebuffers and renderbuffers
+	virtual GLuint GenFramebuffer() = 0;
+	virtual void DeleteFramebuffer(GLuint framebuffer) = 0;
+	virtual void BindFramebuffer(GLenum target, GLuint framebuffer) = 0;
+	virtual void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) = 0;
+	virtual void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLuint renderbuffer) = 0;
+	virtual GLenum CheckFramebufferStatus(GLenum target) = 0;
+	virtual void BlitFramebuffer(GLint sourceX0, GLint sourceY0, GLint sourceX1, GLint sourceY1, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask, GLenum filter) = 0;
+	virtual GLuint GenRenderbuffer() = 0;
+	virtual void DeleteRenderbuffer(GLuint renderbuffer) = 0;
+	virtual void BindRenderbuffer(GLuint renderbuffer) = 0;
+	virtual void RenderbufferStorageMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height) = 0;
+
+	// shaders and programs
+	virtual GLuint CreateShader(GLenum type) = 0;
+	virtual void ShaderSource(GLuint shader, const char* source) = 0;
+	virtual void CompileShader(GLuint shader) = 0;
+	virtual void GetShaderiv(GLuint shader, GLenum name, GLint* value) = 0;
+	virtual void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, char* log) = 0;
+	virtual void DeleteShader(GLuint shader) = 0;
+	virtual GLuint CreateProgram() = 0;
+	virtual void AttachShader(GLuint program, GLuint shader) = 0;
+	virtual void ProgramParameteri(GLuint program, GLenum name, GLint value) = 0;
+	virtual void TransformFeedbackVaryings(GLuint program, GLsizei count, const char* const* varyings, GLenum bufferMode) = 0;
+	virtual void LinkProgram(GLuint program) = 0;
+	virtual void GetProgramiv(GLuint program, GLenum name, GLint* value) = 0;
+	virtual void GetProgramInfoLog(GLuint program, GLsizei bufferSize, char* log) = 0;
+	virtual void DeleteProgram(GLuint program) = 0;
+	virtual void UseProgram(GLuint program) = 0;
+	virtual GLint GetUniformLocation(GLuint program, const char* name) = 0;
+	virtual void Uniform1i(GLint location, GLint value) = 0;
+	virtual void Uniform1f(GLint location, GLfloat value) = 0;
+	virtual void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) = 0;
+	virtual void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) = 0;
+	virtual void UniformMatrix3fv(GLint location, const GLfloat* value) = 0;
+	virtual void UniformMatrix4fv(GLint location, const GLfloat* value) = 0;
+	virtual void ProgramUniform1i(GLuint program, GLint location, GLint value) = 0;
+	virtual void ProgramUniform1f(GLuint program, GLint location, GLfloat value) = 0;
+	virtual void ProgramUniform3fv(GLuint program, GLint location, const GLfloat* value) = 0;
+	virtual void ProgramUniform4fv(GLuint program, GLint location, const GLfloat* value) = 0;
+	virtual void ProgramUniformMatrix3fv(GLuint program, GLint location, const GLfloat* value) = 0;
+	virtual void ProgramUniformMatrix4fv(GLuint program, GLint location, const GLfloat* value) = 0;
+	virtual void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) = 0;
+	virtual void GetActiveUniformBlockiv(GLuint program, GLuint blockIndex, GLenum name, GLint* value) = 0;
+	virtual void GetActiveUniformBlockName(GLuint program, GLuint blockIndex, GLsizei bufferSize, char* name) = 0;
+
+	// state and drawing
+	virtual void GetIntegerv(GLenum name, GLint* value) = 0;
+	virtual void Enable(GLenum capability) = 0;
+	virtual void Disable(GLenum capability) = 0;
+	virtual void BlendFunc(GLenum source, GLenum destination) = 0;
+	virtual void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) = 0;
+	virtual void Clear(GLbitfield mask) = 0;
+	virtual void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+	virtual void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instanceCount) = 0;
+	virtual void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) = 0;
+	virtual void DrawArrays(GLenum mode, GLint first, GLsizei count) = 0;
+	virtual void BeginTransformFeedback(GLenum primitiveMode) = 0;
+	virtual void EndTransformFeedback() = 0;
+	virtual void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) = 0;
+	virtual void ClearBufferuiv(GLenum buffer, GLint drawBuffer, const GLuint* value) = 0;
+
+	// readback, offset is into the bound pixel pack buffer
+	virtual void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, size_t offset) = 0;
+	virtual void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) = 0;
+	virtual void UnmapBuffer(GLenum target) = 0;
+	virtual GLsync FenceSync() = 0;
+	virtual GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) = 0;
+	virtual void DeleteSync(GLsync sync) = 0;
+
+	// occlusion queries
+	virtual void ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) = 0;
+	virtual void DepthMask(GLboolean flag) = 0;
+	virtual GLuint GenQuery() = 0;
+	virtual void DeleteQuery(GLuint query) = 0;
+	virtual void BeginQuery(GLenum target, GLuint query) = 0;
+	virtual void EndQuery(GLenum target) = 0;
+	virtual void GetQueryObjectuiv(GLuint query, GLenum name, GLuint* value) = 0;
+	virtual void BeginConditionalRender(GLuint query, GLenum mode) = 0;
+	virtual void EndConditionalRender() = 0;
+
+	// hierarchical Z culling
+	virtual void DrawBuffer(GLenum buffer) = 0;
+	// the result lands in the bound query buffer at offset instead of client memory
+	virtual void GetQueryObjectuivToBuffer(GLuint query, GLenum name, size_t offset) = 0;
+	// offset is into the bound draw indirect buffer
+	virtual void DrawArraysIndirect(GLenum mode, size_t offset) = 0;
+};
+
+// the device every wrapper goes through, the GL device unless another one was set
+RenderDevice& GetRenderDevice();
+// nullptr goes back to the GL device
+void SetRenderDevice(RenderDevice* device);
+
+// Forwards straight to glad
+class GLDevice : public RenderDevice
+{
+public:
+	GLuint GenBuffer() override;
+	void DeleteBuffer(GLuint buffer) override;
+	void BindBuffer(GLenum target, GLuint buffer) override;
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+	void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+	void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+	void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+
+	GLuint GenVertexArray() override;
+	void DeleteVertexArray(GLuint vertexArray) override;
+	void BindVertexArray(GLuint vertexArray) override;
+	void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset) override;
+	void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) override;
+	void EnableVertexAttribArray(GLuint index) override;
+	void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+	GLuint GenTexture() override;
+	void DeleteTexture(GLuint texture) override;
+	void BindTexture(GLenum target, GLuint texture) override;
+	void BindTextureUnit(GLuint unit, GLuint texture) override;
+	void TexParameteri(GLenum target, GLenum name, GLint value) override;
+	void TexParameteriv(GLenum target, GLenum name, const GLint* values) override;
+	void TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) override;
+	void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) override;
+	void GenerateMipmap(GLenum target) override;
+	void PixelStorei(GLenum name, GLint value) override;
+
+	GLuint GenFramebuffer() override;
+	void DeleteFramebuffer(GLuint framebuffer) override;
+	void BindFramebuffer(GLenum target, GLuint framebuffer) override;
+	void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) override;
+	void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLuint renderbuffer) override;
+	GLenum CheckFramebufferStatus(GLenum target) override;
+	void BlitFramebuffer(GLint sourceX0, GLint sourceY0, GLint sourceX1, GLint sourceY1, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask, GLenum filter) override;
+	GLuint GenRenderbuffer() override;
+	void DeleteRenderbuffer(GLuint renderbuffer) override;
+	void BindRenderbuffer(GLuint renderbuffer) override;
+	void RenderbufferStorageMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height) override;
+
+	GLuint CreateShader(GLenum type) override;
+	void ShaderSource(GLuint shader, const char* source) override;
+	void CompileShader(GLuint shader) override;
+	void GetShaderiv(GLuint shader, GLenum name, GLint* value) override;
+	void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, char* log) override;
+	void DeleteShader(GLuint shader) override;
+	GLuint CreateProgram() override;
+	void AttachShader(GLuint program, GLuint shader) override;
+	void ProgramParameteri(GLuint program, GLenum name, GLint value) override;
+	void TransformFeedbackVaryings(GLuint program, GLsizei count, const char* const* varyings, GLenum bufferMode) override;
+	void LinkProgram(GLuint program) override;
+	void GetProgramiv(GLuint program, GLenum name, GLint* value) override;
+	void GetProgramInfoLog(GLuint program, GLsizei bufferSize, char* log) override;
+	void DeleteProgram(GLuint program) override;
+	void UseProgram(GLuint program) override;
+	GLint GetUniformLocation(GLuint program, const char* name) override;
+	void Uniform1i(GLint location, GLint value) override;
+	void Uniform1f(GLint location, GLfloat value) override;
+	void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) override;
+	void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) override;
+	void UniformMatrix3fv(GLint location, const GLfloat* value) override;
+	void UniformMatrix4fv(GLint location, const GLfloat* value) override;
+	void ProgramUniform1i(GLuint program, GLint location, GLint value) override;
+	void ProgramUniform1f(GLuint program, GLint location, GLfloat value) override;
+	void ProgramUniform3fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniform4fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniformMatrix3fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniformMatrix4fv(GLuint program, GLint location, const GLfloat* value) override;
+	void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) override;
+	void GetActiveUniformBlockiv(GLuint program, GLuint blockIndex, GLenum name, GLint* value) override;
+	void GetActiveUniformBlockName(GLuint program, GLuint blockIndex, GLsizei bufferSize, char* name) override;
+
+	void GetIntegerv(GLenum name, GLint* value) override;
+	void Enable(GLenum capability) override;
+	void Disable(GLenum capability) override;
+	void BlendFunc(GLenum source, GLenum destination) override;
+	void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) override;
+	void Clear(GLbitfield mask) override;
+	void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+	void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instanceCount) override;
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) override;
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+	void BeginTransformFeedback(GLenum primitiveMode) override;
+	void EndTransformFeedback() override;
+	void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) override;
+	void ClearBufferuiv(GLenum buffer, GLint drawBuffer, const GLuint* value) override;
+
+	void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, size_t offset) override;
+	void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) override;
+	void UnmapBuffer(GLenum target) override;
+	GLsync FenceSync() override;
+	GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) override;
+	void DeleteSync(GLsync sync) override;
+
+	void ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) override;
+	void DepthMask(GLboolean flag) override;
+	GLuint GenQuery() override;
+	void DeleteQuery(GLuint query) override;
+	void BeginQuery(GLenum target, GLuint query) override;
+	void EndQuery(GLenum target) override;
+	void GetQueryObjectuiv(GLuint query, GLenum name, GLuint* value) override;
+	void BeginConditionalRender(GLuint query, GLenum mode) override;
+	void EndConditionalRender() override;
+
+	void DrawBuffer(GLenum buffer) override;
+	void GetQueryObjectuivToBuffer(GLuint query, GLenum name, size_t offset) override;
+	void DrawArraysIndirect(GLenum mode, size_t offset) override;
+};
+
+enum RenderCall
+{
+	RenderCallGenBuffer, RenderCallDeleteBuffer, RenderCallBindBuffer, RenderCallBindBufferBase, RenderCallBindBufferRange,
+	RenderCallBufferData, RenderCallBufferSubData,
+	RenderCallGenVertexArray, RenderCallDeleteVertexArray, RenderCallBindVertexArray, RenderCallVertexAttribPointer, RenderCallVertexAttribIPointer,
+	RenderCallEnableVertexAttribArray, RenderCallVertexAttribDivisor,
+	RenderCallGenTexture, RenderCallDeleteTexture, RenderCallBindTexture, RenderCallBindTextureUnit, RenderCallTexParameteri,
+	RenderCallTexParameteriv, RenderCallTexStorage2D, RenderCallTexSubImage2D, RenderCallCompressedTexSubImage2D,
+	RenderCallGenerateMipmap, RenderCallPixelStorei,
+	RenderCallGenFramebuffer, RenderCallDeleteFramebuffer, RenderCallBindFramebuffer, RenderCallFramebufferTexture2D,
+	RenderCallFramebufferRenderbuffer, RenderCallCheckFramebufferStatus, RenderCallBlitFramebuffer, RenderCallGenRenderbuffer,
+	RenderCallDeleteRenderbuffer, RenderCallBindRenderbuffer, RenderCallRenderbufferStorageMultisample,
+	RenderCallCreateShader, RenderCallShaderSource, RenderCallCompileShader, RenderCallGetShaderiv, RenderCallGetShaderInfoLog,
+	RenderCallDeleteShader, RenderCallCreateProgram, RenderCallAttachShader, RenderCallProgramParameteri, RenderCallTransformFeedbackVaryings,
+	RenderCallLinkProgram, RenderCallGetProgramiv, RenderCallGetProgramInfoLog, RenderCallDeleteProgram, RenderCallUseProgram, RenderCallGetUniformLocation,
+	RenderCallUniform, RenderCallProgramUniform, RenderCallUniformBlockBinding, RenderCallGetActiveUniformBlockiv,
+	RenderCallGetActiveUniformBlockName,
+	RenderCallGetIntegerv, RenderCallEnable, RenderCallDisable, RenderCallBlendFunc,
+	RenderCallClearColor, RenderCallClear, RenderCallViewport, RenderCallDrawElementsInstanced, RenderCallDrawArraysInstanced,
+	RenderCallDrawArrays, RenderCallBeginTransformFeedback, RenderCallEndTransformFeedback, RenderCallScissor, RenderCallClearBufferuiv,
+	RenderCallReadPixels, RenderCallMapBufferRange, RenderCallUnmapBuffer, RenderCallFenceSync, RenderCallClientWaitSync, RenderCallDeleteSync,
+	RenderCallColorMask, RenderCallDepthMask, RenderCallGenQuery, RenderCallDeleteQuery, RenderCallBeginQuery, RenderCallEndQuery,
+	RenderCallGetQueryObjectuiv, RenderCallBeginConditionalRender, RenderCallEndConditionalRender,
+	RenderCallDrawBuffer, RenderCallGetQueryObjectuivToBuffer, RenderCallDrawArraysIndirect,
+	RenderCallCount
+};
+
+const char* GetRenderCallName(RenderCall call);
+
+struct NullDeviceStats
+{
+	unsigned long long calls[RenderCallCount] = {};
+	unsigned long long totalCalls = 0;
+	unsigned long long bytesUploaded = 0;	// buffer, texture and uniform data
+	unsigned long long stateChanges = 0;	// binds and program switches that changed something
+	unsigned long long redundantBinds = 0;	// the same ones that didn't
+	unsigned long long draws = 0;
+	unsigned long long blits = 0;
+	unsigned long long bytesRead = 0;		// pixels read back
+};
+
+// Records instead of rendering. Objects get increasing names, every shader compiles and every
+// program links, every framebuffer is complete, and queries answer with defaults (no uniform
+// blocks, 256 byte UBO alignment), fences are always signalled and mapped buffers read as zeros, and every query is available
+// and passed (nothing is ever occluded).
+// Calls are counted, uploads measured, binds compared against the tracked state, and with a
+// command stream set every call is written to it as a line of text for diffing.
+class NullDevice : public RenderDevice
+{
+public:
+	void SetCommandStream(std::ostream* stream) { mCommandStream = stream; }
+	const NullDeviceStats& GetStats() const { return mStats; }
+	void ResetStats() { mStats = NullDeviceStats(); }
+	void Report() const;
+
+	GLuint GenBuffer() override;
+	void DeleteBuffer(GLuint buffer) override;
+	void BindBuffer(GLenum target, GLuint buffer) override;
+	void BindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+	void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+	void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) override;
+	void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) override;
+
+	GLuint GenVertexArray() override;
+	void DeleteVertexArray(GLuint vertexArray) override;
+	void BindVertexArray(GLuint vertexArray) override;
+	void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, size_t offset) override;
+	void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset) override;
+	void EnableVertexAttribArray(GLuint index) override;
+	void VertexAttribDivisor(GLuint index, GLuint divisor) override;
+
+	GLuint GenTexture() override;
+	void DeleteTexture(GLuint texture) override;
+	void BindTexture(GLenum target, GLuint texture) override;
+	void BindTextureUnit(GLuint unit, GLuint texture) override;
+	void TexParameteri(GLenum target, GLenum name, GLint value) override;
+	void TexParameteriv(GLenum target, GLenum name, const GLint* values) override;
+	void TexStorage2D(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) override;
+	void TexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, const void* pixels) override;
+	void CompressedTexSubImage2D(GLenum target, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void* data) override;
+	void GenerateMipmap(GLenum target) override;
+	void PixelStorei(GLenum name, GLint value) override;
+
+	GLuint GenFramebuffer() override;
+	void DeleteFramebuffer(GLuint framebuffer) override;
+	void BindFramebuffer(GLenum target, GLuint framebuffer) override;
+	void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textureTarget, GLuint texture, GLint level) override;
+	void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLuint renderbuffer) override;
+	GLenum CheckFramebufferStatus(GLenum target) override;
+	void BlitFramebuffer(GLint sourceX0, GLint sourceY0, GLint sourceX1, GLint sourceY1, GLint x0, GLint y0, GLint x1, GLint y1, GLbitfield mask, GLenum filter) override;
+	GLuint GenRenderbuffer() override;
+	void DeleteRenderbuffer(GLuint renderbuffer) override;
+	void BindRenderbuffer(GLuint renderbuffer) override;
+	void RenderbufferStorageMultisample(GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height) override;
+
+	GLuint CreateShader(GLenum type) override;
+	void ShaderSource(GLuint shader, const char* source) override;
+	void CompileShader(GLuint shader) override;
+	void GetShaderiv(GLuint shader, GLenum name, GLint* value) override;
+	void GetShaderInfoLog(GLuint shader, GLsizei bufferSize, char* log) override;
+	void DeleteShader(GLuint shader) override;
+	GLuint CreateProgram() override;
+	void AttachShader(GLuint program, GLuint shader) override;
+	void ProgramParameteri(GLuint program, GLenum name, GLint value) override;
+	void TransformFeedbackVaryings(GLuint program, GLsizei count, const char* const* varyings, GLenum bufferMode) override;
+	void LinkProgram(GLuint program) override;
+	void GetProgramiv(GLuint program, GLenum name, GLint* value) override;
+	void GetProgramInfoLog(GLuint program, GLsizei bufferSize, char* log) override;
+	void DeleteProgram(GLuint program) override;
+	void UseProgram(GLuint program) override;
+	GLint GetUniformLocation(GLuint program, const char* name) override;
+	void Uniform1i(GLint location, GLint value) override;
+	void Uniform1f(GLint location, GLfloat value) override;
+	void Uniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z) override;
+	void Uniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w) override;
+	void UniformMatrix3fv(GLint location, const GLfloat* value) override;
+	void UniformMatrix4fv(GLint location, const GLfloat* value) override;
+	void ProgramUniform1i(GLuint program, GLint location, GLint value) override;
+	void ProgramUniform1f(GLuint program, GLint location, GLfloat value) override;
+	void ProgramUniform3fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniform4fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniformMatrix3fv(GLuint program, GLint location, const GLfloat* value) override;
+	void ProgramUniformMatrix4fv(GLuint program, GLint location, const GLfloat* value) override;
+	void UniformBlockBinding(GLuint program, GLuint blockIndex, GLuint binding) override;
+	void GetActiveUniformBlockiv(GLuint program, GLuint blockIndex, GLenum name, GLint* value) override;
+	void GetActiveUniformBlockName(GLuint program, GLuint blockIndex, GLsizei bufferSize, char* name) override;
+
+	void GetIntegerv(GLenum name, GLint* value) override;
+	void Enable(GLenum capability) override;
+	void Disable(GLenum capability) override;
+	void BlendFunc(GLenum source, GLenum destination) override;
+	void ClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) override;
+	void Clear(GLbitfield mask) override;
+	void Viewport(GLint x, GLint y, GLsizei width, GLsizei height) override;
+	void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, size_t offset, GLsizei instanceCount) override;
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) override;
+	void DrawArrays(GLenum mode, GLint first, GLsizei count) override;
+	void BeginTransformFeedback(GLenum primitiveMode) override;
+	void EndTransformFeedback() override;
+	void Scissor(GLint x, GLint y, GLsizei width, GLsizei height) override;
+	void ClearBufferuiv(GLenum buffer, GLint drawBuffer, const GLuint* value) override;
+
+	void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, size_t offset) override;
+	void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) override;
+	void UnmapBuffer(GLenum target) override;
+	GLsync FenceSync() override;
+	GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) override;
+	void DeleteSync(GLsync sync) override;
+
+	void ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) override;
+	void DepthMask(GLboolean flag) override;
+	GLuint GenQuery() override;
+	void DeleteQuery(GLuint query) override;
+	void BeginQuery(GLenum target, GLuint query) override;
+	void EndQuery(GLenum target) override;
+	void GetQueryObjectuiv(GLuint query, GLenum name, GLuint* value) override;
+	void BeginConditionalRender(GLuint query, GLenum mode) override;
+	void EndConditionalRender() override;
+
+	void DrawBuffer(GLenum buffer) override;
+	void GetQueryObjectuivToBuffer(GLuint query, GLenum name, size_t offset) override;
+	void DrawArraysIndirect(GLenum mode, size_t offset) override;
+
+private:
+	void Record(RenderCall call, std::initializer_list<long long> arguments = {});
+	// counts a state change when the value differs, a redundant bind when it doesn't
+	void TrackBinding(long long slot, long long value);
+
+	NullDeviceStats mStats;
+	std::ostream* mCommandStream = nullptr;
+	GLuint mNextName = 1;
+	GLint mNextUniformLocation = 0;
+	std::map<long long, long long> mBindings;	// also holds enabled capabilities and the blend function
+	std::map<std::pair<GLuint, std::string>, GLint> mUniformLocations;
+	std::vector<unsigned char> mMappedBuffer;
+	uintptr_t mNextSync = 1;
+};
@@ -0,0 +1,245 @@
+#include "RenderTarget.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+#include <iostream>
+
+static size_t BytesPerSample(unsigned int format)
+{
+    switch (format)
+    {
+    case GL_R8: return 1;
+    case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+    case GL_RGB8: case GL_SRGB8: case GL_DEPTH_COMPONENT24: return 3;
+    case GL_RGBA16F: case GL_RG32F: case GL_RG32UI: return 8;
+    case GL_RGBA32F: case GL_RGBA32UI: return 16;
+    default: return 4;
+    }
+}
+
+RenderTarget::RenderTarget(const RenderTargetDesc& desc)
+    : mDesc(desc)
+{
+    Create();
+}
+
+RenderTarget::~RenderTarget()
+{
+    DeleteRenderTarget();
+}
+
+void RenderTarget::Create()
+{
+    RenderDevice& device = GetRenderDevice();
+    bool multisampled = mDesc.samples > 1;
+    mFramebuffer = device.GenFramebuffer();
+    device.BindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+
+    if (mDesc.colorFormat)
+    {
+        mColorTexture = device.GenTexture();
+        device.BindTexture(GL_TEXTURE_2D, mColorTexture);
+        device.TexStorage2D(GL_TEXTURE_2D, 1, mDesc.colorFormat, mDesc.width, mDesc.height);
+        // integer formats (ids, ...) can't be filtered
+        device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        device.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        mMemorySize += (size_t)mDesc.width * mDesc.height * BytesPerSample(mDesc.colorFormat);
+
+        if (multisampled)
+        {
+            mColorRenderbuffer = device.GenRenderbuffer();
+            device.BindRenderbuffer(mColorRenderbuffer);
+            device.RenderbufferStorageMultisample(mDesc.samples, mDesc.colorFormat, mDesc.width, mDesc.height);
+            device.FramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mColorRenderbuffer);
+            mMemorySize += (size_t)mDesc.width * mDesc.height * mDesc.samples * BytesPerSample(mDesc.colorFormat);
+        }
+        else
+        {
+            device.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexture, 0);
+        }
+    }
+
+    if (mDesc.depthFormat)
+    {
+        GLenum attachment = mDesc.depthFormat == GL_DEPTH24_STENCIL8 || mDesc.depthFormat == GL_DEPTH32F_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        mDepthRenderbuffer = device.GenRenderbuffer();
+        device.BindRenderbuffer(mDepthRenderbuffer);
+        device.RenderbufferStorageMultisample(multisampled ? mDesc.samples : 0, mDesc.depthFormat, mDesc.width, mDesc.height);
+        device.FramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, mDepthRenderbuffer);
+        mMemorySize += (size_t)mDesc.width * mDesc.height * (multisampled ? mDesc.samples : 1) * BytesPerSample(mDesc.depthFormat);
+    }
+    device.BindRenderbuffer(0);
+
+    if (device.CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Render target " << mDesc.width << "x" << mDesc.height << " is not complete" << std::endl;
+
+    if (multisampled && mColorTexture)
+    {
+        mResolveFramebuffer = device.GenFramebuffer();
+        device.BindFramebuffer(GL_FRAMEBUFFER, mResolveFramebuffer);
+        device.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexture, 0);
+        if (device.CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Resolve target " << mDesc.width << "x" << mDesc.height << " is not complete" << std::endl;
+    }
+    else
+    {
+        mResolveFramebuffer = mFramebuffer;
+    }
+    device.BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::Bind()
+{
+    GetRenderDevice().BindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    GetRenderDevice().Viewport(0, 0, mDesc.width, mDesc.height);
+}
+
+void RenderTarget::BindDefault(int width, int height)
+{
+    GetRenderDevice().BindFramebuffer(GL_FRAMEBUFFER, 0);
+    GetRenderDevice().Viewport(0, 0, width, height);
+}
+
+void RenderTarget::Resize(int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == mDesc.width && height == mDesc.height))
+        return;
+
+    DeleteRenderTarget();
+    mDesc.width = width;
+    mDesc.height = height;
+    Create();
+}
+
+void RenderTarget::Resolve()
+{
+    if (mResolveFramebuffer == mFramebuffer)
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    device.BindFramebuffer(GL_READ_FRAMEBUFFER, mFramebuffer);
+    device.BindFramebuffer(GL_DRAW_FRAMEBUFFER, mResolveFramebuffer);
+    device.BlitFramebuffer(0, 0, mDesc.width, mDesc.height, 0, 0, mDesc.width, mDesc.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void RenderTarget::BindRead()
+{
+    GetRenderDevice().BindFramebuffer(GL_READ_FRAMEBUFFER, mResolveFramebuffer);
+}
+
+void RenderTarget::BlitToDefault(int width, int height)
+{
+    RenderDevice& device = GetRenderDevice();
+    device.BindFramebuffer(GL_READ_FRAMEBUFFER, mResolveFramebuffer);
+    device.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    bool sameSize = width == mDesc.width && height == mDesc.height;
+    device.BlitFramebuffer(0, 0, mDesc.width, mDesc.height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, sameSize ? GL_NEAREST : GL_LINEAR);
+}
+
+void RenderTarget::BindColorTexture(unsigned int slot)
+{
+    GetRenderDevice().BindTextureUnit(slot, mColorTexture);
+}
+
+void RenderTarget::DeleteRenderTarget()
+{
+    RenderDevice& device = GetRenderDevice();
+    if (mResolveFramebuffer && mResolveFramebuffer != mFramebuffer)
+        device.DeleteFramebuffer(mResolveFramebuffer);
+    if (mFramebuffer)
+        device.DeleteFramebuffer(mFramebuffer);
+    if (mColorTexture)
+        device.DeleteTexture(mColorTexture);
+    if (mColorRenderbuffer)
+        device.DeleteRenderbuffer(mColorRenderbuffer);
+    if (mDepthRenderbuffer)
+        device.DeleteRenderbuffer(mDepthRenderbuffer);
+    mFramebuffer = mResolveFramebuffer = mColorTexture = mColorRenderbuffer = mDepthRenderbuffer = 0;
+    mMemorySize = 0;
+}
+
+// RenderTargetPool
+
+RenderTargetPool::RenderTargetPool(unsigned int maxUnusedFrames)
+    : mMaxUnusedFrames(maxUnusedFrames)
+{
+}
+
+RenderTarget& RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+    mAcquired++;
+    for (Entry& entry : mEntries)
+    {
+        if (!entry.inUse && entry.target->GetDesc() == desc)
+        {
+            entry.inUse = true;
+            entry.lastUsedFrame = mFrame;
+            return *entry.target;
+        }
+    }
+
+    mEntries.push_back({ std::unique_ptr<RenderTarget>(new RenderTarget(desc)), true, mFrame });
+    mCreated++;
+    size_t memorySize = GetMemorySize();
+    if (memorySize > mPeakMemorySize)
+        mPeakMemorySize = memorySize;
+    return *mEntries.back().target;
+}
+
+void RenderTargetPool::Release(RenderTarget& target)
+{
+    for (Entry& entry : mEntries)
+    {
+        if (entry.target.get() == &target)
+        {
+            entry.inUse = false;
+            entry.lastUsedFrame = mFrame;
+            return;
+        }
+    }
+}
+
+void RenderTargetPool::EndFrame()
+{
+    mFrame++;
+    for (size_t i = 0; i < mEntries.size(); )
+    {
+        // swap and pop, the order of the entries doesn't matter
+        if (!mEntries[i].inUse && mFrame - mEntries[i].lastUsedFrame > mMaxUnusedFrames)
+        {
+            std::swap(mEntries[i], mEntries.back());
+            mEntries.pop_back();
+            mDeleted++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void RenderTargetPool::Clear()
+{
+    mDeleted += mEntries.size();
+    mEntries.clear();
+}
+
+size_t RenderTargetPool::GetMemorySize() const
+{
+    size_t memorySize = 0;
+    for (const Entry& entry : mEntries)
+        memorySize += entry.target->GetMemorySize();
+    return memorySize;
+}
+
+void RenderTargetPool::Report() const
+{
+    if (mAcquired == 0)
+        return;
+
+    std::cout << "Render target pool: " << mAcquired << " acquired, " << mCreated << " created ("
+        << 100.0 * (mAcquired - mCreated) / mAcquired << "% reused), " << mDeleted << " deleted, peak "
+        << mPeakMemorySize / (1024.0 * 1024.0) << " MB" << std::endl;
+}
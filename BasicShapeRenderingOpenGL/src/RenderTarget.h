@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct RenderTargetDesc
+{
+	int width = 0;
+	int height = 0;
+	unsigned int colorFormat = 0;	// sized internal format (GL_SRGB8_ALPHA8, GL_R32UI, ...), 0 for none
+	unsigned int depthFormat = 0;	// GL_DEPTH_COMPONENT32F, GL_DEPTH24_STENCIL8, ... 0 for none
+	int samples = 1;
+
+	bool operator==(const RenderTargetDesc& other) const
+	{
+		return width == other.width && height == other.height && colorFormat == other.colorFormat
+			&& depthFormat == other.depthFormat && samples == other.samples;
+	}
+};
+
+// Offscreen framebuffer. Color ends up in a texture that later passes can sample or read back;
+// with MSAA, drawing goes to multisampled renderbuffers and Resolve blits color into that texture.
+// Depth is a renderbuffer, it's only ever tested against.
+class RenderTarget
+{
+public:
+	RenderTarget(const RenderTargetDesc& desc);
+	~RenderTarget();
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	// binds for drawing and sets the viewport to the whole target
+	void Bind();
+	static void BindDefault(int width, int height);
+	// recreates the attachments at the new size, nothing happens when it's the same or 0 (minimized)
+	void Resize(int width, int height);
+	// multisampled color into the texture, does nothing without MSAA
+	void Resolve();
+	// binds the resolved color as the read framebuffer, for glReadPixels and blits
+	void BindRead();
+	// resolved color to the default framebuffer, stretched when the sizes differ
+	void BlitToDefault(int width, int height);
+	void BindColorTexture(unsigned int slot);
+	void DeleteRenderTarget();
+
+	const RenderTargetDesc& GetDesc() const { return mDesc; }
+	int GetWidth() const { return mDesc.width; }
+	int GetHeight() const { return mDesc.height; }
+	unsigned int GetFramebuffer() const { return mFramebuffer; }
+	unsigned int GetColorTexture() const { return mColorTexture; }
+	// estimated VRAM of every attachment
+	size_t GetMemorySize() const { return mMemorySize; }
+
+private:
+	void Create();
+
+	RenderTargetDesc mDesc;
+	unsigned int mFramebuffer = 0;			// what Bind draws into
+	unsigned int mResolveFramebuffer = 0;	// the color texture, separate only with MSAA
+	unsigned int mColorTexture = 0;
+	unsigned int mColorRenderbuffer = 0;	// multisampled color
+	unsigned int mDepthRenderbuffer = 0;
+	size_t mMemorySize = 0;
+};
+
+// Transient targets for multi-pass effects. Acquire hands out a released target with the same
+// description when there is one, so passes and frames share attachments instead of allocating
+// them; targets nobody acquired for maxUnusedFrames are deleted in EndFrame.
+class RenderTargetPool
+{
+public:
+	RenderTargetPool(unsigned int maxUnusedFrames = 3);
+
+	RenderTarget& Acquire(const RenderTargetDesc& desc);
+	void Release(RenderTarget& target);
+	void EndFrame();
+	void Clear();
+
+	size_t GetMemorySize() const;
+	void Report() const;
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<RenderTarget> target;
+		bool inUse;
+		unsigned long long lastUsedFrame;
+	};
+
+	std::vector<Entry> mEntries;
+	unsigned int mMaxUnusedFrames;
+	unsigned long long mFrame = 0;
+
+	unsigned long long mAcquired = 0;
+	unsigned long long mCreated = 0;
+	unsigned long long mDeleted = 0;
+	size_t mPeakMemorySize = 0;
+};
@@ -1,109 +1,369 @@
 #include "Shader.h"
+#include "ProgramBinaryCache.h"
+#include "GLExtensions.h"
+#include "UniformBuffer.h"
+#include "RenderDevice.h"
 
 #include <glad/glad.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
 #include <iostream>
 
-Shader::Shader(const char* vertexShaderSource, const char* fragmentShaderSource)
+Shader::Shader(const char* vertexShaderSource, const char* fragmentShaderSource, ProgramBinaryCache* programCache)
+    : mVertexShader(0), mFragmentShader(0), mShaderProgram(0), mProgramCache(programCache)
 {
-    mVertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(mVertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(mVertexShader);
+    if (mProgramCache)
+    {
+        mProgramCacheKey = mProgramCache->GetKey(vertexShaderSource, fragmentShaderSource);
+        mShaderProgram = mProgramCache->Load(mProgramCacheKey);
+        if (mShaderProgram)
+        {
+            mFromProgramCache = true;
+            mLinked = true;
+            ReflectUniformBlocks();
+            return;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mVertexShader = GetRenderDevice().CreateShader(GL_VERTEX_SHADER);
+    GetRenderDevice().ShaderSource(mVertexShader, vertexShaderSource);
+    GetRenderDevice().CompileShader(mVertexShader);
 
-    mFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(mFragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(mFragmentShader);
+    mFragmentShader = GetRenderDevice().CreateShader(GL_FRAGMENT_SHADER);
+    GetRenderDevice().ShaderSource(mFragmentShader, fragmentShaderSource);
+    GetRenderDevice().CompileShader(mFragmentShader);
+    mBuildMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 Shader::~Shader()
 {
     DeleteProgram();
 }
 
+void Shader::SetGeometryShader(const char* geometryShaderSource)
+{
+    if (mFromProgramCache || mGeometryShader)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mGeometryShader = GetRenderDevice().CreateShader(GL_GEOMETRY_SHADER);
+    GetRenderDevice().ShaderSource(mGeometryShader, geometryShaderSource);
+    GetRenderDevice().CompileShader(mGeometryShader);
+    mBuildMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 void Shader::Compile()
 {
+    if (mFromProgramCache)
+        return;
+
     // check for shader compile errors
     int success;
     char infoLog[512];
-    glGetShaderiv(mVertexShader, GL_COMPILE_STATUS, &success);
+    GetRenderDevice().GetShaderiv(mVertexShader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(mVertexShader, 512, NULL, infoLog);
+        GetRenderDevice().GetShaderInfoLog(mVertexShader, 512, infoLog);
         std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
 
     // check for shader compile errors
-    glGetShaderiv(mFragmentShader, GL_COMPILE_STATUS, &success);
+    GetRenderDevice().GetShaderiv(mFragmentShader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
-        glGetShaderInfoLog(mFragmentShader, 512, NULL, infoLog);
+        GetRenderDevice().GetShaderInfoLog(mFragmentShader, 512, infoLog);
         std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
+
+    if (mGeometryShader)
+    {
+        GetRenderDevice().GetShaderiv(mGeometryShader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            GetRenderDevice().GetShaderInfoLog(mGeometryShader, 512, infoLog);
+            std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+    }
 }
 
 void Shader::Link()
 {
+    BeginLink();
+    FinishLink();
+}
+
+void Shader::BeginLink()
+{
+    if (mFromProgramCache || mLinkPending)
+        return;
+
+    // link shaders
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mShaderProgram = GetRenderDevice().CreateProgram();
+    GetRenderDevice().AttachShader(mShaderProgram, mVertexShader);
+    GetRenderDevice().AttachShader(mShaderProgram, mFragmentShader);
+    if (mGeometryShader)
+        GetRenderDevice().AttachShader(mShaderProgram, mGeometryShader);
+    if (mProgramCache)
+        GetRenderDevice().ProgramParameteri(mShaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!mTransformFeedbackVaryings.empty())
+    {
+        std::vector<const char*> varyings;
+        for (const std::string& varying : mTransformFeedbackVaryings)
+            varyings.push_back(varying.c_str());
+        GetRenderDevice().TransformFeedbackVaryings(mShaderProgram, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+    GetRenderDevice().LinkProgram(mShaderProgram);
+    mLinkPending = true;
+    mBuildMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Shader::FinishLink()
+{
+    if (!mLinkPending)
+        return;
+    mLinkPending = false;
+
     int success;
     char infoLog[512];
 
-    // link shaders
-    mShaderProgram = glCreateProgram();
-    glAttachShader(mShaderProgram, mVertexShader);
-    glAttachShader(mShaderProgram, mFragmentShader);
-    glLinkProgram(mShaderProgram);
-    // check for linking errors
-    glGetProgramiv(mShaderProgram, GL_LINK_STATUS, &success);
+    // check for linking errors, this is where the driver makes us wait for whatever it has left
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GetRenderDevice().GetProgramiv(mShaderProgram, GL_LINK_STATUS, &success);
+    mBuildMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     if (!success) {
-        glGetProgramInfoLog(mShaderProgram, 512, NULL, infoLog);
+        // the per stage logs explain most link failures
+        Compile();
+        GetRenderDevice().GetProgramInfoLog(mShaderProgram, 512, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
-    glDeleteShader(mVertexShader);
-    glDeleteShader(mFragmentShader);
+    else
+    {
+        mLinked = true;
+        ReflectUniformBlocks();
+        if (mProgramCache)
+            mProgramCache->Store(mProgramCacheKey, mShaderProgram, mBuildMilliseconds);
+    }
+    DeleteShaders();
+}
+
+bool Shader::IsLinkComplete() const
+{
+    if (!mLinkPending)
+        return true;
+    if (!glExtensions.KHR_parallel_shader_compile)
+        return false;
+
+    int complete = 0;
+    GetRenderDevice().GetProgramiv(mShaderProgram, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
 }
 
 void Shader::UseProgram()
 {
-    glUseProgram(mShaderProgram);
+    if (mLinkPending)
+        FinishLink();
+    GetRenderDevice().UseProgram(mShaderProgram);
 }
 
 void Shader::DeleteProgram()
 {
-    glDeleteProgram(mShaderProgram);
+    // a shader dropped before its link finished (e.g. a superseded hot reload) still owns its stages
+    DeleteShaders();
+    mLinkPending = false;
+    GetRenderDevice().DeleteProgram(mShaderProgram);
+    mShaderProgram = 0;
+}
+
+void Shader::DeleteShaders()
+{
+    if (mVertexShader)
+        GetRenderDevice().DeleteShader(mVertexShader);
+    if (mFragmentShader)
+        GetRenderDevice().DeleteShader(mFragmentShader);
+    if (mGeometryShader)
+        GetRenderDevice().DeleteShader(mGeometryShader);
+    mVertexShader = 0;
+    mFragmentShader = 0;
+    mGeometryShader = 0;
 }
 
 void Shader::SetUniformFloat4(std::string name, glm::vec4 value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniform4f(location, value.x, value.y, value.z, value.w);
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Float4;
+    memcpy(slot.value.floatValues, glm::value_ptr(value), sizeof(value));
+    GetRenderDevice().Uniform4f(slot.location, value.x, value.y, value.z, value.w);
 }
 
 void Shader::SetUniformFloat3(std::string name, glm::vec3 value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniform3f(location, value.x, value.y, value.z);
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Float3;
+    memcpy(slot.value.floatValues, glm::value_ptr(value), sizeof(value));
+    GetRenderDevice().Uniform3f(slot.location, value.x, value.y, value.z);
 }
 
 void Shader::SetUniformFloat(std::string name, float value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniform1f(location, value);
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Float;
+    slot.value.floatValues[0] = value;
+    GetRenderDevice().Uniform1f(slot.location, value);
 }
 
 void Shader::SetUniformInt(std::string name, int value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniform1i(location, value);
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Int;
+    slot.value.intValue = value;
+    GetRenderDevice().Uniform1i(slot.location, value);
 }
 
 void Shader::SetUniformMat4(std::string name, glm::mat4 value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Mat4;
+    memcpy(slot.value.floatValues, glm::value_ptr(value), sizeof(value));
+    GetRenderDevice().UniformMatrix4fv(slot.location, glm::value_ptr(value));
 }
 
 void Shader::SetUniformMat3(std::string name, glm::mat3 value)
 {
-    int location = glGetUniformLocation(mShaderProgram, name.c_str());
-    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Mat3;
+    memcpy(slot.value.floatValues, glm::value_ptr(value), sizeof(value));
+    GetRenderDevice().UniformMatrix3fv(slot.location, glm::value_ptr(value));
 }
 
+void Shader::SetUniformHandle(std::string name, unsigned long long value)
+{
+    if (!glExtensions.ARB_bindless_texture)
+        return;
 
+    UniformSlot& slot = GetUniformSlot(name);
+    slot.value.type = UniformValue::Handle;
+    slot.value.handleValue = value;
+    glExtensions.UniformHandleui64ARB(slot.location, value);
+}
+
+int Shader::GetUniformLocation(const std::string& name)
+{
+    return GetUniformSlot(name).location;
+}
+
+Shader::UniformSlot& Shader::GetUniformSlot(const std::string& name)
+{
+    auto found = mUniforms.find(name);
+    if (found != mUniforms.end())
+        return found->second;
+
+    UniformSlot& slot = mUniforms[name];
+    slot.location = GetRenderDevice().GetUniformLocation(mShaderProgram, name.c_str());
+    return slot;
+}
+
+void Shader::ApplyUniform(const UniformSlot& slot)
+{
+    // program uniforms where there are any, so the swapped in program doesn't have to be bound,
+    // otherwise SwapProgram binds it around the replay
+    const float* values = slot.value.floatValues;
+    if (!glExtensions.ARB_separate_shader_objects)
+    {
+        switch (slot.value.type)
+        {
+        case UniformValue::Int: GetRenderDevice().Uniform1i(slot.location, slot.value.intValue); break;
+        case UniformValue::Float: GetRenderDevice().Uniform1f(slot.location, values[0]); break;
+        case UniformValue::Float3: GetRenderDevice().Uniform3f(slot.location, values[0], values[1], values[2]); break;
+        case UniformValue::Float4: GetRenderDevice().Uniform4f(slot.location, values[0], values[1], values[2], values[3]); break;
+        case UniformValue::Mat3: GetRenderDevice().UniformMatrix3fv(slot.location, values); break;
+        case UniformValue::Mat4: GetRenderDevice().UniformMatrix4fv(slot.location, values); break;
+        case UniformValue::Handle:
+            if (glExtensions.ARB_bindless_texture)
+                glExtensions.UniformHandleui64ARB(slot.location, slot.value.handleValue);
+            break;
+        default: break;
+        }
+        return;
+    }
+
+    switch (slot.value.type)
+    {
+    case UniformValue::Int: GetRenderDevice().ProgramUniform1i(mShaderProgram, slot.location, slot.value.intValue); break;
+    case UniformValue::Float: GetRenderDevice().ProgramUniform1f(mShaderProgram, slot.location, values[0]); break;
+    case UniformValue::Float3: GetRenderDevice().ProgramUniform3fv(mShaderProgram, slot.location, values); break;
+    case UniformValue::Float4: GetRenderDevice().ProgramUniform4fv(mShaderProgram, slot.location, values); break;
+    case UniformValue::Mat3: GetRenderDevice().ProgramUniformMatrix3fv(mShaderProgram, slot.location, values); break;
+    case UniformValue::Mat4: GetRenderDevice().ProgramUniformMatrix4fv(mShaderProgram, slot.location, values); break;
+    case UniformValue::Handle:
+        if (glExtensions.ProgramUniformHandleui64ARB)
+            glExtensions.ProgramUniformHandleui64ARB(mShaderProgram, slot.location, slot.value.handleValue);
+        break;
+    default: break;
+    }
+}
+
+void Shader::SwapProgram(Shader& replacement)
+{
+    std::unordered_map<std::string, UniformBlockInfo> previousBlocks;
+    previousBlocks.swap(mUniformBlocks);
+
+    std::swap(mShaderProgram, replacement.mShaderProgram);
+    std::swap(mLinked, replacement.mLinked);
+    mUniformBlocks = replacement.mUniformBlocks;
+    replacement.mUniformBlocks = previousBlocks;
+
+    // blocks bound by hand keep their binding, the fixed ones were bound by reflection already
+    for (const auto& block : previousBlocks)
+    {
+        if (block.second.binding >= 0 && block.second.binding != GetUniformBlockBinding(block.first))
+            BindUniformBlock(block.first, block.second.binding);
+    }
+
+    GLint boundProgram = 0;
+    if (!glExtensions.ARB_separate_shader_objects)
+    {
+        GetRenderDevice().GetIntegerv(GL_CURRENT_PROGRAM, &boundProgram);
+        GetRenderDevice().UseProgram(mShaderProgram);
+    }
+    for (auto& uniform : mUniforms)
+    {
+        uniform.second.location = GetRenderDevice().GetUniformLocation(mShaderProgram, uniform.first.c_str());
+        ApplyUniform(uniform.second);
+    }
+    // when the old program was the bound one the new one stays bound in its place
+    if (!glExtensions.ARB_separate_shader_objects && (GLuint)boundProgram != replacement.mShaderProgram)
+        GetRenderDevice().UseProgram(boundProgram);
+}
+
+void Shader::BindUniformBlock(const std::string& blockName, unsigned int binding)
+{
+    auto found = mUniformBlocks.find(blockName);
+    if (found == mUniformBlocks.end())
+        return;
+
+    GetRenderDevice().UniformBlockBinding(mShaderProgram, found->second.index, binding);
+    found->second.binding = (int)binding;
+}
+
+void Shader::ReflectUniformBlocks()
+{
+    mUniformBlocks.clear();
+
+    int blockCount = 0;
+    GetRenderDevice().GetProgramiv(mShaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+    for (int i = 0; i < blockCount; i++)
+    {
+        char name[128];
+        GetRenderDevice().GetActiveUniformBlockName(mShaderProgram, i, sizeof(name), name);
+
+        UniformBlockInfo info;
+        info.index = (unsigned int)i;
+        GetRenderDevice().GetActiveUniformBlockiv(mShaderProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &info.size);
+        info.binding = GetUniformBlockBinding(name);
+        if (info.binding >= 0)
+            GetRenderDevice().UniformBlockBinding(mShaderProgram, info.index, info.binding);
+
+        mUniformBlocks[name] = info;
+    }
+}
@@ -1,17 +1,56 @@
 #pragma once
 #include <glm.hpp>
+#include <chrono>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+class ProgramBinaryCache;
+
+struct UniformBlockInfo
+{
+	unsigned int index;
+	int size;		// GL_UNIFORM_BLOCK_DATA_SIZE
+	int binding;	// -1 when the block has no fixed binding point
+};
+
+// Last value set through one of the SetUniform functions, replayed when the program is swapped
+struct UniformValue
+{
+	enum Type { None, Int, Float, Float3, Float4, Mat3, Mat4, Handle };
+	Type type = None;
+	int intValue = 0;
+	unsigned long long handleValue = 0;
+	float floatValues[16] = {};
+};
 
 class Shader
 {
 public:
-	Shader(const char* vertexShaderSource, const char* fragmentShaderSource);
+	// with a cache, a stored program binary replaces Compile/Link when the driver accepts it
+	Shader(const char* vertexShaderSource, const char* fragmentShaderSource, ProgramBinaryCache* programCache = nullptr);
 	~Shader();
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
 	void Compile();
 	void Link();
+	// vertex shader outputs captured by transform feedback, interleaved in this order into buffer 0;
+	// has to come before the link, so it's only for shaders built without a program cache
+	void SetTransformFeedbackVaryings(const std::vector<std::string>& varyings) { mTransformFeedbackVaryings = varyings; }
+	// a geometry shader between the two, compiled right away; the same goes as for the varyings
+	void SetGeometryShader(const char* geometryShaderSource);
+	// Link split in two so the driver can work in the background, FinishLink blocks until it's done
+	void BeginLink();
+	void FinishLink();
+	// never blocks when KHR_parallel_shader_compile is available, otherwise only true once finished
+	bool IsLinkComplete() const;
+	bool IsLinkPending() const { return mLinkPending; }
+	bool IsLinked() const { return mLinked; }
+	// finishes a pending link first, so the first use is the only point that may stall
 	void UseProgram();
 	void DeleteProgram();
 	unsigned int GetShaderProgram() const { return mShaderProgram; }
+	bool IsFromProgramCache() const { return mFromProgramCache; }
 
 	// Uniforms
 	void SetUniformFloat4(std::string name, glm::vec4 value);
@@ -20,8 +59,44 @@ public:
 	void SetUniformInt(std::string name, int value);
 	void SetUniformMat4(std::string name, glm::mat4 value);
 	void SetUniformMat3(std::string name, glm::mat3 value);
+	// ARB_bindless_texture sampler handle
+	void SetUniformHandle(std::string name, unsigned long long value);
+	// cached per name, the cache is rebuilt when the program is swapped
+	int GetUniformLocation(const std::string& name);
+
+	// Takes over the linked program of replacement (which gets the old one), used by hot reload.
+	// Uniform locations, values set through this shader and block bindings carry over.
+	void SwapProgram(Shader& replacement);
+
+	// Uniform blocks, filled in once the program is linked. Blocks with a fixed UniformBinding
+	// name are bound to it automatically.
+	const std::unordered_map<std::string, UniformBlockInfo>& GetUniformBlocks() const { return mUniformBlocks; }
+	void BindUniformBlock(const std::string& blockName, unsigned int binding);
 private:
+	struct UniformSlot
+	{
+		int location;
+		UniformValue value;
+	};
+
+	// the stage objects, once they're linked or no longer needed
+	void DeleteShaders();
+	void ReflectUniformBlocks();
+	UniformSlot& GetUniformSlot(const std::string& name);
+	void ApplyUniform(const UniformSlot& slot);
+
 	unsigned int mVertexShader, mFragmentShader;
+	unsigned int mGeometryShader = 0;	// optional
 	unsigned int mShaderProgram;
 
+	ProgramBinaryCache* mProgramCache;
+	std::string mProgramCacheKey;
+	bool mFromProgramCache = false;
+	bool mLinkPending = false;
+	bool mLinked = false;
+	std::unordered_map<std::string, UniformBlockInfo> mUniformBlocks;
+	std::unordered_map<std::string, UniformSlot> mUniforms;
+	std::vector<std::string> mTransformFeedbackVaryings;
+	double mBuildMilliseconds = 0.0;	// spent in the compile/link calls and the link status wait, not the time between them
+
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "ShaderCompiler.h"
+#include "Shader.h"
+#include "GLExtensions.h"
+
+#include <iostream>
+
+ShaderCompiler::ShaderCompiler()
+{
+    // let the driver pick how many compiler threads to use
+    if (glExtensions.KHR_parallel_shader_compile)
+        glExtensions.MaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+}
+
+void ShaderCompiler::Submit(Shader& shader)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (mSubmitted == 0)
+        mFirstSubmit = start;
+
+    shader.BeginLink();
+    if (shader.IsLinkPending())
+        mPending.push_back(&shader);
+    mSubmitted++;
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    mSubmitMilliseconds += elapsed.count();
+}
+
+void ShaderCompiler::Remove(Shader& shader)
+{
+    for (size_t i = 0; i < mPending.size(); i++)
+    {
+        if (mPending[i] == &shader)
+        {
+            mPending[i] = mPending.back();
+            mPending.pop_back();
+            return;
+        }
+    }
+}
+
+unsigned int ShaderCompiler::Poll()
+{
+    bool finishedOne = false;
+    for (size_t i = 0; i < mPending.size();)
+    {
+        Shader* shader = mPending[i];
+        bool complete = shader->IsLinkComplete();
+
+        // without the extension there's no way to ask, so take the stall for a single program
+        if (!complete && !glExtensions.KHR_parallel_shader_compile && !finishedOne && shader->IsLinkPending())
+            complete = true;
+
+        if (complete || !shader->IsLinkPending())
+        {
+            shader->FinishLink();
+            finishedOne = true;
+            mPending[i] = mPending.back();
+            mPending.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    if (mPending.empty() && mSubmitted > 0 && mCompleteMilliseconds == 0.0)
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mFirstSubmit;
+        mCompleteMilliseconds = elapsed.count();
+    }
+    return (unsigned int)mPending.size();
+}
+
+void ShaderCompiler::WaitAll()
+{
+    for (Shader* shader : mPending)
+        shader->FinishLink();
+    mPending.clear();
+    Poll();
+}
+
+void ShaderCompiler::Report() const
+{
+    std::cout << "Shader compiler: " << mSubmitted << " programs submitted in " << mSubmitMilliseconds << " ms";
+    if (mPending.empty())
+        std::cout << ", all ready after " << mCompleteMilliseconds << " ms";
+    else
+        std::cout << ", " << mPending.size() << " still pending";
+    std::cout << (glExtensions.KHR_parallel_shader_compile ? " (KHR_parallel_shader_compile)" : "") << std::endl;
+}
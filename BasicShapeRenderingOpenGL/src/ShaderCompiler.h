@@ -0,0 +1,32 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+class Shader;
+
+// Submits every program up front and finishes them as the driver reports completion, so the
+// frame loop (or a loading screen) keeps running while shaders build. With
+// KHR_parallel_shader_compile polling never blocks, without it Poll finishes one program per
+// call to keep each stall short. A program that's used before it is polled finishes on use.
+class ShaderCompiler
+{
+public:
+	ShaderCompiler();
+
+	void Submit(Shader& shader);
+	// stops tracking a shader that's about to be destroyed
+	void Remove(Shader& shader);
+	// returns how many programs are still pending
+	unsigned int Poll();
+	void WaitAll();
+
+	unsigned int GetPendingCount() const { return (unsigned int)mPending.size(); }
+	void Report() const;
+
+private:
+	std::vector<Shader*> mPending;
+	unsigned int mSubmitted = 0;
+	std::chrono::steady_clock::time_point mFirstSubmit;
+	double mSubmitMilliseconds = 0.0;
+	double mCompleteMilliseconds = 0.0;	// first submit until nothing was pending anymore
+};
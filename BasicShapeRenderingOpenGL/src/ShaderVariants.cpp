@@ -0,0 +1,132 @@
+#include "ShaderVariants.h"
+#include "ShaderCompiler.h"
+#include "GLExtensions.h"
+
+#include <iostream>
+
+static const char* FeatureDefines[ShaderFeatureCount] = {
+    "TEXTURED",
+    "VERTEX_COLOR",
+    "INSTANCED",
+    "ALPHA_TEST",
+    "SDF",
+    "PICKING",
+};
+
+ShaderVariants::ShaderVariants(const std::string& vertexTemplate, const std::string& fragmentTemplate,
+    ProgramBinaryCache* programCache, ShaderCompiler* compiler)
+    : mVertexTemplate(vertexTemplate), mFragmentTemplate(fragmentTemplate), mProgramCache(programCache), mCompiler(compiler)
+{
+}
+
+void ShaderVariants::Prepare(unsigned int features)
+{
+    if (mVariants.find(features) == mVariants.end())
+        Create(features);
+}
+
+Shader& ShaderVariants::Get(unsigned int features)
+{
+    mUsed.insert(features);
+
+    auto found = mVariants.find(features);
+    if (found != mVariants.end())
+        return *found->second;
+    return Create(features);
+}
+
+void ShaderVariants::Report() const
+{
+    std::cout << "Shader variants: " << GetCompiledCount() << " compiled, " << GetUsedCount() << " used" << std::endl;
+}
+
+std::string ShaderVariants::BuildSource(const std::string& source, unsigned int features)
+{
+    std::string defines;
+    for (unsigned int i = 0; i < ShaderFeatureCount; i++)
+    {
+        if (features & (1u << i))
+            defines += std::string("#define ") + FeatureDefines[i] + "\n";
+    }
+
+    // #version has to stay the first directive, the defines go right after it
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+        return defines + source;
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+        return source + "\n" + defines;
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+void ShaderVariants::Reload(const std::string& vertexTemplate, const std::string& fragmentTemplate)
+{
+    mVertexTemplate = vertexTemplate;
+    mFragmentTemplate = fragmentTemplate;
+
+    for (const auto& variant : mVariants)
+    {
+        // a reload that's still building is superseded by the newer sources, destroying it deletes its program and stages
+        auto pending = mReloads.find(variant.first);
+        if (pending != mReloads.end() && mCompiler)
+            mCompiler->Remove(*pending->second.shader);
+        mReloads[variant.first] = { Build(variant.first), 0 };
+    }
+}
+
+void ShaderVariants::Update()
+{
+    bool finishedOne = false;
+    for (auto reload = mReloads.begin(); reload != mReloads.end();)
+    {
+        Shader& replacement = *reload->second.shader;
+        reload->second.updates++;
+
+        // without the extension there's no way to ask, so give the driver a frame and take the stall for one program
+        bool complete = replacement.IsLinkComplete();
+        if (!complete && !glExtensions.KHR_parallel_shader_compile)
+            complete = reload->second.updates > 1 && !finishedOne;
+        if (!complete)
+        {
+            ++reload;
+            continue;
+        }
+
+        replacement.FinishLink();
+        finishedOne = true;
+        if (mCompiler)
+            mCompiler->Remove(replacement);
+
+        if (replacement.IsLinked())
+        {
+            mVariants[reload->first]->SwapProgram(replacement);
+            std::cout << "Shader variant " << reload->first << " reloaded" << std::endl;
+        }
+        else
+        {
+            std::cout << "Shader variant " << reload->first << " failed to reload, keeping the previous program" << std::endl;
+        }
+        reload = mReloads.erase(reload);
+    }
+}
+
+Shader& ShaderVariants::Create(unsigned int features)
+{
+    std::unique_ptr<Shader> shader = Build(features);
+    Shader& result = *shader;
+    mVariants[features] = std::move(shader);
+    return result;
+}
+
+std::unique_ptr<Shader> ShaderVariants::Build(unsigned int features)
+{
+    std::string vertexSource = BuildSource(mVertexTemplate, features);
+    std::string fragmentSource = BuildSource(mFragmentTemplate, features);
+
+    auto shader = std::make_unique<Shader>(vertexSource.c_str(), fragmentSource.c_str(), mProgramCache);
+    if (mCompiler)
+        mCompiler->Submit(*shader);
+    else
+        shader->BeginLink();
+    return shader;
+}
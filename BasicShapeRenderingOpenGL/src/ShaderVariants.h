@@ -0,0 +1,69 @@
+#pragma once
+#include "Shader.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class ProgramBinaryCache;
+class ShaderCompiler;
+
+// Feature bits of a variant, each one becomes a #define in the generated sources
+enum ShaderFeature : unsigned int
+{
+	ShaderFeatureTextured = 1 << 0,		// TEXTURED
+	ShaderFeatureVertexColor = 1 << 1,	// VERTEX_COLOR
+	ShaderFeatureInstanced = 1 << 2,	// INSTANCED
+	ShaderFeatureAlphaTest = 1 << 3,	// ALPHA_TEST
+	ShaderFeatureSdf = 1 << 4,			// SDF
+	ShaderFeaturePicking = 1 << 5,		// PICKING
+	ShaderFeatureCount = 6
+};
+
+// Builds programs from one vertex/fragment template pair. A variant is compiled the first time
+// it's asked for (or prepared) and cached by its feature mask afterwards.
+class ShaderVariants
+{
+public:
+	ShaderVariants(const std::string& vertexTemplate, const std::string& fragmentTemplate,
+		ProgramBinaryCache* programCache = nullptr, ShaderCompiler* compiler = nullptr);
+
+	// submits the variant for compilation without counting it as used
+	void Prepare(unsigned int features);
+	// compiles on demand, the returned shader finishes linking on its first UseProgram
+	Shader& Get(unsigned int features);
+
+	// Hot reload: every compiled variant is rebuilt from the new templates in the background and
+	// swapped in by Update once it linked, so references returned by Get stay valid. A variant that
+	// fails to build keeps its previous program.
+	void Reload(const std::string& vertexTemplate, const std::string& fragmentTemplate);
+	// call once per frame, never waits on the driver when KHR_parallel_shader_compile is available;
+	// without it a reload is left a frame to build and at most one is finished per call
+	void Update();
+
+	unsigned int GetCompiledCount() const { return (unsigned int)mVariants.size(); }
+	unsigned int GetUsedCount() const { return (unsigned int)mUsed.size(); }
+	void Report() const;
+
+	// template with the feature #defines inserted after its #version line
+	static std::string BuildSource(const std::string& source, unsigned int features);
+
+private:
+	struct PendingReload
+	{
+		std::unique_ptr<Shader> shader;
+		unsigned int updates = 0;	// Update calls since it was submitted
+	};
+
+	Shader& Create(unsigned int features);
+	std::unique_ptr<Shader> Build(unsigned int features);
+
+	std::string mVertexTemplate;
+	std::string mFragmentTemplate;
+	ProgramBinaryCache* mProgramCache;
+	ShaderCompiler* mCompiler;
+	std::unordered_map<unsigned int, std::unique_ptr<Shader>> mVariants;
+	std::unordered_set<unsigned int> mUsed;
+	std::unordered_map<unsigned int, PendingReload> mReloads;
+};
@@ -0,0 +1,208 @@
+#include "ShapeRenderer.h"
+#include "HiZ.h"
+#include "Shader.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+uint32_t PackColorSRGB(const glm::vec4& color)
+{
+    // sRGB encoding spends the 8 bits where they're visible
+    glm::vec3 encoded = glm::convertLinearToSRGB(glm::clamp(glm::vec3(color), 0.0f, 1.0f));
+    return glm::packUnorm4x8(glm::vec4(encoded, color.a));
+}
+
+// ShapeBatch
+
+void ShapeBatch::Add(ShapeType type, const glm::vec3& center, const glm::vec2& halfSize, const glm::vec2& params, float rotation, const ShapeStyle& style)
+{
+    ShapeInstance shape;
+    shape.center = center;
+    shape.halfSize[0] = glm::packHalf1x16(halfSize.x);
+    shape.halfSize[1] = glm::packHalf1x16(halfSize.y);
+    shape.params[0] = glm::packHalf1x16(params.x);
+    shape.params[1] = glm::packHalf1x16(style.stroke.a > 0.0f ? style.strokeWidth : 0.0f);
+    // wraps to a fraction of a turn, negative angles included
+    float turns = rotation / 6.2831853f;
+    shape.rotation = (uint16_t)(int)std::floor((turns - std::floor(turns)) * 65536.0f + 0.5f);
+    shape.type = type;
+    shape.fillColor = PackColorSRGB(style.fill);
+    shape.strokeColor = PackColorSRGB(style.stroke);
+    mShapes.push_back(shape);
+}
+
+void ShapeBatch::AddCircle(const glm::vec3& center, float radius, const ShapeStyle& style)
+{
+    Add(ShapeCircle, center, glm::vec2(radius), glm::vec2(0.0f), 0.0f, style);
+}
+
+void ShapeBatch::AddEllipse(const glm::vec3& center, const glm::vec2& radii, float rotation, const ShapeStyle& style)
+{
+    Add(ShapeEllipse, center, radii, glm::vec2(0.0f), rotation, style);
+}
+
+void ShapeBatch::AddRoundedRect(const glm::vec3& center, const glm::vec2& halfExtents, float cornerRadius, float rotation, const ShapeStyle& style)
+{
+    float maxRadius = std::min(halfExtents.x, halfExtents.y);
+    Add(ShapeRoundedRect, center, halfExtents, glm::vec2(std::min(std::max(cornerRadius, 0.0f), maxRadius), 0.0f), rotation, style);
+}
+
+void ShapeBatch::AddLine(const glm::vec3& from, const glm::vec3& to, float thickness, const ShapeStyle& style)
+{
+    // the shape plane is z = center.z, lines are drawn at the average depth of their ends
+    glm::vec2 direction = glm::vec2(to - from);
+    float rotation = std::atan2(direction.y, direction.x);
+    Add(ShapeLine, (from + to) * 0.5f, glm::vec2(glm::length(direction) * 0.5f, thickness * 0.5f), glm::vec2(0.0f), rotation, style);
+}
+
+void ShapeBatch::AddRing(const glm::vec3& center, float radius, float thickness, const ShapeStyle& style)
+{
+    Add(ShapeRing, center, glm::vec2(radius), glm::vec2(thickness, 0.0f), 0.0f, style);
+}
+
+// ShapeRenderer
+
+ShapeRenderer::ShapeRenderer(size_t capacity)
+    : mCapacity(capacity < 1 ? 1 : capacity)
+{
+    RenderDevice& device = GetRenderDevice();
+    mVertexArray = device.GenVertexArray();
+    device.BindVertexArray(mVertexArray);
+    mInstanceBuffer = device.GenBuffer();
+    device.BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+    device.BufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(ShapeInstance), NULL, GL_STREAM_DRAW);
+    SetInstanceAttributes();
+    device.BindVertexArray(0);
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+ShapeRenderer::~ShapeRenderer()
+{
+    DeleteShapeRenderer();
+}
+
+void ShapeRenderer::SetInstanceAttributes()
+{
+    // no per vertex attributes, the quad corners come from gl_VertexID
+    RenderDevice& device = GetRenderDevice();
+    GLsizei stride = sizeof(ShapeInstance);
+    device.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, center));
+    device.VertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, halfSize));
+    device.VertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(ShapeInstance, params));
+    device.VertexAttribIPointer(3, 2, GL_UNSIGNED_SHORT, stride, offsetof(ShapeInstance, rotation));
+    device.VertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offsetof(ShapeInstance, fillColor));
+    device.VertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offsetof(ShapeInstance, strokeColor));
+    for (GLuint attribute = 0; attribute <= 5; attribute++)
+    {
+        device.EnableVertexAttribArray(attribute);
+        device.VertexAttribDivisor(attribute, 1);
+    }
+}
+
+bool ShapeRenderer::Upload(const ShapeBatch& batch)
+{
+    const std::vector<ShapeInstance>& shapes = batch.GetShapes();
+    mUploaded = 0;
+    if (shapes.empty() || !mVertexArray)
+        return false;
+
+    RenderDevice& device = GetRenderDevice();
+    device.BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+    while (mCapacity < shapes.size())
+        mCapacity *= 2;
+    // orphan the storage, the driver hands out fresh memory instead of waiting for last frame's draw
+    device.BufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(ShapeInstance), NULL, GL_STREAM_DRAW);
+    device.BufferSubData(GL_ARRAY_BUFFER, 0, shapes.size() * sizeof(ShapeInstance), shapes.data());
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+    mUploaded = shapes.size();
+
+    mFrames++;
+    mShapes += shapes.size();
+    mMaxShapes = std::max(mMaxShapes, shapes.size());
+    return true;
+}
+
+void ShapeRenderer::Draw(const ShapeBatch& batch, Shader& shader)
+{
+    if (!Upload(batch))
+        return;
+
+    // Shape.frag writes premultiplied alpha
+    RenderDevice& device = GetRenderDevice();
+    device.Enable(GL_BLEND);
+    device.BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    shader.UseProgram();
+    device.BindVertexArray(mVertexArray);
+    device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)mUploaded);
+    device.Disable(GL_BLEND);
+}
+
+void ShapeRenderer::Draw(const ShapeBatch& batch, Shader& shader, HiZCuller& culler)
+{
+    if (!Upload(batch))
+        return;
+
+    culler.Cull(mInstanceBuffer, mUploaded);
+    RenderDevice& device = GetRenderDevice();
+    if (mCulledBuffer != culler.GetVisibleBuffer())
+    {
+        if (!mCulledVertexArray)
+            mCulledVertexArray = device.GenVertexArray();
+        mCulledBuffer = culler.GetVisibleBuffer();
+        device.BindVertexArray(mCulledVertexArray);
+        device.BindBuffer(GL_ARRAY_BUFFER, mCulledBuffer);
+        SetInstanceAttributes();
+        device.BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    device.Enable(GL_BLEND);
+    device.BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    shader.UseProgram();
+    device.BindVertexArray(mCulledVertexArray);
+    // no count the culler can draw with is in yet, all of them then
+    if (!culler.DrawVisible(GL_TRIANGLE_STRIP, 4))
+    {
+        device.BindVertexArray(mVertexArray);
+        device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)mUploaded);
+    }
+    device.Disable(GL_BLEND);
+}
+
+void ShapeRenderer::Redraw(Shader& shader)
+{
+    if (mUploaded == 0)
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    shader.UseProgram();
+    device.BindVertexArray(mVertexArray);
+    device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)mUploaded);
+}
+
+void ShapeRenderer::DeleteShapeRenderer()
+{
+    RenderDevice& device = GetRenderDevice();
+    if (mInstanceBuffer)
+        device.DeleteBuffer(mInstanceBuffer);
+    if (mVertexArray)
+        device.DeleteVertexArray(mVertexArray);
+    if (mCulledVertexArray)
+        device.DeleteVertexArray(mCulledVertexArray);
+    mInstanceBuffer = mVertexArray = mCulledVertexArray = mCulledBuffer = 0;
+    mUploaded = 0;
+}
+
+void ShapeRenderer::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    std::cout << "Shapes: " << (double)mShapes / mFrames << " per frame (max " << mMaxShapes << "), " << sizeof(ShapeInstance)
+        << " bytes and 4 vertices each" << std::endl;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class HiZCuller;
+class Shader;
+
+// matches the SHAPE_* constants in Shape.frag
+enum ShapeType : uint16_t
+{
+	ShapeCircle = 0,
+	ShapeEllipse = 1,
+	ShapeRoundedRect = 2,
+	ShapeLine = 3,		// segment with round caps
+	ShapeRing = 4,
+	ShapeTypeCount = 5
+};
+
+// One shape, exactly the per instance vertex attributes of Shape.vert. Sizes are half floats in
+// world units on the shape's plane (z = center.z, facing +z), colors are sRGB encoded RGBA8.
+struct ShapeInstance
+{
+	glm::vec3 center;
+	uint16_t halfSize[2];	// radii, half extents, or half length and half thickness for lines
+	uint16_t params[2];		// corner radius or ring thickness, then stroke width (0 for none)
+	uint16_t rotation;		// a full turn is 65536
+	uint16_t type;			// ShapeType
+	uint32_t fillColor;
+	uint32_t strokeColor;
+};
+static_assert(sizeof(ShapeInstance) == 32, "ShapeInstance has to match the instance layout of Shape.vert");
+
+// linear color to sRGB encoded RGBA8, the vertex shaders decode it back to linear
+uint32_t PackColorSRGB(const glm::vec4& color);
+
+// colors are linear, like the other uniforms; alpha 0 skips the fill or the stroke
+struct ShapeStyle
+{
+	glm::vec4 fill = glm::vec4(1.0f);
+	glm::vec4 stroke = glm::vec4(0.0f);
+	float strokeWidth = 0.0f;	// centered on the outline
+};
+
+// Shapes collected for a frame, packs them without any GL calls so it can be filled on the
+// frame pipeline worker.
+class ShapeBatch
+{
+public:
+	void Clear() { mShapes.clear(); }
+
+	void AddCircle(const glm::vec3& center, float radius, const ShapeStyle& style);
+	void AddEllipse(const glm::vec3& center, const glm::vec2& radii, float rotation, const ShapeStyle& style);
+	void AddRoundedRect(const glm::vec3& center, const glm::vec2& halfExtents, float cornerRadius, float rotation, const ShapeStyle& style);
+	void AddLine(const glm::vec3& from, const glm::vec3& to, float thickness, const ShapeStyle& style);
+	void AddRing(const glm::vec3& center, float radius, float thickness, const ShapeStyle& style);
+
+	const std::vector<ShapeInstance>& GetShapes() const { return mShapes; }
+	size_t GetShapeCount() const { return mShapes.size(); }
+
+private:
+	void Add(ShapeType type, const glm::vec3& center, const glm::vec2& halfSize, const glm::vec2& params, float rotation, const ShapeStyle& style);
+
+	std::vector<ShapeInstance> mShapes;
+};
+
+// Draws a ShapeBatch as one instanced triangle strip: every shape is a quad built from
+// gl_VertexID around its instance, and Shape.frag shades it from the shape's analytic distance
+// function, antialiased over about a pixel. The instances are streamed into an orphaned buffer
+// every frame, 32 bytes and 4 vertices per shape however large it is on screen.
+class ShapeRenderer
+{
+public:
+	ShapeRenderer(size_t capacity = 4096);
+	~ShapeRenderer();
+	ShapeRenderer(const ShapeRenderer&) = delete;
+	ShapeRenderer& operator=(const ShapeRenderer&) = delete;
+
+	// blends over what's drawn so far, leaves blending off again
+	void Draw(const ShapeBatch& batch, Shader& shader);
+	// the same, but only the shapes culler finds visible, drawn from its buffer
+	void Draw(const ShapeBatch& batch, Shader& shader, HiZCuller& culler);
+	// the shapes the last Draw uploaded again, without blending, for passes like picking
+	void Redraw(Shader& shader);
+	void DeleteShapeRenderer();
+
+	void Report() const;
+
+private:
+	// streams the shapes into the instance buffer, false when there's nothing to draw
+	bool Upload(const ShapeBatch& batch);
+	// the instance attributes of Shape.vert from the buffer bound to GL_ARRAY_BUFFER
+	void SetInstanceAttributes();
+
+	unsigned int mVertexArray = 0;
+	unsigned int mInstanceBuffer = 0;
+	unsigned int mCulledVertexArray = 0;	// over the culler's visible buffer
+	unsigned int mCulledBuffer = 0;
+	size_t mCapacity;	// shapes the buffer has room for
+	size_t mUploaded = 0;	// shapes in it
+
+	unsigned long long mFrames = 0;
+	unsigned long long mShapes = 0;
+	size_t mMaxShapes = 0;
+};
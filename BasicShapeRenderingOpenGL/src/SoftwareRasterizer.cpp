@@ -0,0 +1,949 @@
+#include "SoftwareRasterizer.h"
+#include "ShapeRenderer.h"
+
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/packing.hpp>
+#include <stb_image/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_RASTERIZER_SSE2
+#endif
+
+namespace
+{
+    const int TileSize = 64;
+    // closer than this to the eye plane triangles are clipped, so the divide by w stays finite
+    const float MinClipW = 1e-4f;
+
+    // four horizontally adjacent pixels
+    struct Float4
+    {
+#ifdef SOFTWARE_RASTERIZER_SSE2
+        __m128 v;
+
+        static Float4 Set(float x) { return { _mm_set1_ps(x) }; }
+        static Float4 Ramp(float x) { return { _mm_setr_ps(x, x + 1.0f, x + 2.0f, x + 3.0f) }; }
+        Float4 operator+(const Float4& o) const { return { _mm_add_ps(v, o.v) }; }
+        Float4 operator*(const Float4& o) const { return { _mm_mul_ps(v, o.v) }; }
+        // one bit per lane, inclusive lets edge values of exactly 0 count as inside
+        int Inside(bool inclusive) const
+        {
+            __m128 zero = _mm_setzero_ps();
+            return _mm_movemask_ps(inclusive ? _mm_cmpge_ps(v, zero) : _mm_cmpgt_ps(v, zero));
+        }
+        void Store(float* out) const { _mm_storeu_ps(out, v); }
+#else
+        float v[4];
+
+        static Float4 Set(float x) { return { { x, x, x, x } }; }
+        static Float4 Ramp(float x) { return { { x, x + 1.0f, x + 2.0f, x + 3.0f } }; }
+        Float4 operator+(const Float4& o) const { return { { v[0] + o.v[0], v[1] + o.v[1], v[2] + o.v[2], v[3] + o.v[3] } }; }
+        Float4 operator*(const Float4& o) const { return { { v[0] * o.v[0], v[1] * o.v[1], v[2] * o.v[2], v[3] * o.v[3] } }; }
+        int Inside(bool inclusive) const
+        {
+            int mask = 0;
+            for (int i = 0; i < 4; i++)
+                mask |= (inclusive ? v[i] >= 0.0f : v[i] > 0.0f) ? 1 << i : 0;
+            return mask;
+        }
+        void Store(float* out) const { memcpy(out, v, sizeof(v)); }
+#endif
+    };
+
+    const int LinearToSrgbSize = 4096;
+
+    struct SrgbTables
+    {
+        float toLinear[256];
+        unsigned char fromLinear[LinearToSrgbSize];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                float c = i / 255.0f;
+                toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < LinearToSrgbSize; i++)
+            {
+                float c = i / (float)(LinearToSrgbSize - 1);
+                float s = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = (unsigned char)(s * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    // built on first use, function statics are initialized once even with several tile threads
+    const SrgbTables& GetSrgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    const float* GetSrgbToLinearTable()
+    {
+        return GetSrgbTables().toLinear;
+    }
+
+    unsigned char LinearToSrgb(float c)
+    {
+        c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+        return GetSrgbTables().fromLinear[(int)(c * (LinearToSrgbSize - 1) + 0.5f)];
+    }
+
+    uint32_t PackColor(const glm::vec4& linearColor)
+    {
+        unsigned char a = (unsigned char)(std::min(std::max(linearColor.a, 0.0f), 1.0f) * 255.0f + 0.5f);
+        return LinearToSrgb(linearColor.r) | (LinearToSrgb(linearColor.g) << 8) | (LinearToSrgb(linearColor.b) << 16) | ((uint32_t)a << 24);
+    }
+
+    glm::vec4 SampleBilinear(const SoftwareImage& image, float u, float v)
+    {
+        const float* toLinear = GetSrgbToLinearTable();
+        float x = u * image.width - 0.5f;
+        float y = v * image.height - 0.5f;
+        float fx = floorf(x);
+        float fy = floorf(y);
+        float tx = x - fx;
+        float ty = y - fy;
+        // GL_REPEAT, a mask for power of two sizes since the divides dominate otherwise
+        int x0, y0, x1, y1;
+        if ((image.width & (image.width - 1)) == 0 && (image.height & (image.height - 1)) == 0)
+        {
+            x0 = (int)fx & (image.width - 1);
+            y0 = (int)fy & (image.height - 1);
+            x1 = (x0 + 1) & (image.width - 1);
+            y1 = (y0 + 1) & (image.height - 1);
+        }
+        else
+        {
+            x0 = ((int)fx % image.width + image.width) % image.width;
+            y0 = ((int)fy % image.height + image.height) % image.height;
+            x1 = (x0 + 1) % image.width;
+            y1 = (y0 + 1) % image.height;
+        }
+
+        const unsigned char* p00 = &image.pixels[((size_t)y0 * image.width + x0) * 4];
+        const unsigned char* p10 = &image.pixels[((size_t)y0 * image.width + x1) * 4];
+        const unsigned char* p01 = &image.pixels[((size_t)y1 * image.width + x0) * 4];
+        const unsigned char* p11 = &image.pixels[((size_t)y1 * image.width + x1) * 4];
+
+        glm::vec4 result;
+        for (int c = 0; c < 3; c++)
+        {
+            float top = toLinear[p00[c]] + (toLinear[p10[c]] - toLinear[p00[c]]) * tx;
+            float bottom = toLinear[p01[c]] + (toLinear[p11[c]] - toLinear[p01[c]]) * tx;
+            result[c] = top + (bottom - top) * ty;
+        }
+        float top = p00[3] + (p10[3] - p00[3]) * tx;
+        float bottom = p01[3] + (p11[3] - p01[3]) * tx;
+        result.a = (top + (bottom - top) * ty) / 255.0f;
+        return result;
+    }
+
+    // mip level from the screen space derivatives of the texture coordinates, log2 of the longer footprint axis
+    float ComputeLod(const SoftwareTexture& texture, float dudx, float dvdx, float dudy, float dvdy)
+    {
+        const SoftwareImage& base = texture.mips[0];
+        float dx = (dudx * base.width) * (dudx * base.width) + (dvdx * base.height) * (dvdx * base.height);
+        float dy = (dudy * base.width) * (dudy * base.width) + (dvdy * base.height) * (dvdy * base.height);
+        return 0.5f * log2f(std::max(dx, dy));
+    }
+
+    // GL_LINEAR_MIPMAP_LINEAR
+    glm::vec4 SampleTrilinear(const SoftwareTexture& texture, float u, float v, float lod)
+    {
+        if (!(lod > 0.0f))
+            return SampleBilinear(texture.mips[0], u, v);
+
+        int lastLevel = (int)texture.mips.size() - 1;
+        int level = (int)lod;
+        if (level >= lastLevel)
+            return SampleBilinear(texture.mips[lastLevel], u, v);
+        float t = lod - level;
+        glm::vec4 a = SampleBilinear(texture.mips[level], u, v);
+        glm::vec4 b = SampleBilinear(texture.mips[level + 1], u, v);
+        return a + (b - a) * t;
+    }
+}
+
+struct SoftwareRasterizer::Vertex
+{
+    glm::vec4 position;	// clip space
+    glm::vec2 texCoord;
+};
+
+struct SoftwareRasterizer::Triangle
+{
+    // edge functions a * x + b * y + c, positive inside, edge i is opposite vertex i
+    float a[3], b[3], c[3];
+    // pixels exactly on an edge belong to the triangle where it's a top or left edge, so shared edges are drawn once
+    bool topLeft[3];
+    // u / w, v / w and 1 / w as planes over the screen, they interpolate linearly
+    float u[3], v[3], q[3];
+    int minX, minY, maxX, maxY;
+    glm::vec2 layers;
+    int shape;	// index into mShapes, -1 for a quad of the Basic shader; u and v are then LocalPos / w
+};
+
+// the flat outputs of Shape.vert, colors linear and premultiplied
+struct SoftwareRasterizer::Shape
+{
+    glm::vec2 halfSize;
+    glm::vec2 params;
+    unsigned int type;
+    glm::vec4 fill;
+    glm::vec4 stroke;
+};
+
+namespace
+{
+    // signed distance to the outline in world units, negative inside, as in Shape.frag
+    float ShapeDistance(const SoftwareRasterizer::Shape& shape, glm::vec2 p)
+    {
+        switch (shape.type)
+        {
+        case ShapeCircle:
+            return glm::length(p) - shape.halfSize.x;
+        case ShapeEllipse:
+        {
+            float k0 = glm::length(p / shape.halfSize);
+            float k1 = glm::length(p / (shape.halfSize * shape.halfSize));
+            return k0 * (k0 - 1.0f) / std::max(k1, 1e-6f);
+        }
+        case ShapeRoundedRect:
+        {
+            glm::vec2 q = glm::abs(p) - shape.halfSize + shape.params.x;
+            return glm::length(glm::max(q, 0.0f)) + std::min(std::max(q.x, q.y), 0.0f) - shape.params.x;
+        }
+        case ShapeLine:
+            return glm::length(glm::vec2(std::max(fabsf(p.x) - shape.halfSize.x, 0.0f), p.y)) - shape.halfSize.y;
+        default:
+            return fabsf(glm::length(p) - shape.halfSize.x) - 0.5f * shape.params.x;
+        }
+    }
+
+    glm::vec4 UnpackColorSRGB(uint32_t color)
+    {
+        glm::vec4 encoded = glm::unpackUnorm4x8(color);
+        return glm::vec4(glm::convertSRGBToLinear(glm::vec3(encoded)), encoded.a);
+    }
+
+    // Shape.frag for the covered lanes of a group of four, blended over destination with GL_ONE, GL_ONE_MINUS_SRC_ALPHA
+    unsigned int ShadeShape(const SoftwareRasterizer::Triangle& triangle, const SoftwareRasterizer::Shape& shape, int mask,
+        const float* u, const float* v, const float* q, uint32_t* destination)
+    {
+        const float* toLinear = GetSrgbToLinearTable();
+        unsigned int shaded = 0;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!(mask & (1 << lane)))
+                continue;
+
+            // dFdx and dFdy as the change to the next pixel over and up
+            float distance = ShapeDistance(shape, glm::vec2(u[lane], v[lane]) / q[lane]);
+            float dx = ShapeDistance(shape, glm::vec2(u[lane] + triangle.u[0], v[lane] + triangle.v[0]) / (q[lane] + triangle.q[0])) - distance;
+            float dy = ShapeDistance(shape, glm::vec2(u[lane] + triangle.u[1], v[lane] + triangle.v[1]) / (q[lane] + triangle.q[1])) - distance;
+            float pixel = std::max(sqrtf(dx * dx + dy * dy), 1e-6f);
+            float fillCoverage = glm::clamp(0.5f - distance / pixel, 0.0f, 1.0f);
+            float strokeCoverage = shape.params.y > 0.0f ? glm::clamp(0.5f - (fabsf(distance) - 0.5f * shape.params.y) / pixel, 0.0f, 1.0f) : 0.0f;
+
+            glm::vec4 fill = shape.fill * fillCoverage;
+            glm::vec4 stroke = shape.stroke * strokeCoverage;
+            glm::vec4 color = stroke + fill * (1.0f - stroke.a);
+            if (color.a <= 0.0f)
+                continue;
+
+            // the framebuffer is sRGB, blending happens on its linear values
+            uint32_t packed = destination[lane];
+            glm::vec4 background = glm::vec4(toLinear[packed & 0xFF], toLinear[(packed >> 8) & 0xFF], toLinear[(packed >> 16) & 0xFF], (packed >> 24) / 255.0f);
+            destination[lane] = PackColor(color + background * (1.0f - color.a));
+            shaded++;
+        }
+        return shaded;
+    }
+}
+
+bool SoftwareImage::Load(const std::string& path)
+{
+    int channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!data)
+    {
+        std::cout << "Failed to load texture " << path << std::endl;
+        width = height = 0;
+        return false;
+    }
+    pixels.assign(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+bool SoftwareImage::WritePPM(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        const unsigned char* source = &pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++)
+            memcpy(&row[(size_t)x * 3], &source[(size_t)x * 4], 3);
+        file.write((const char*)row.data(), row.size());
+    }
+    return (bool)file;
+}
+
+namespace
+{
+    uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+    {
+        static const struct CrcTable
+        {
+            uint32_t values[256];
+            CrcTable()
+            {
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    uint32_t value = i;
+                    for (int bit = 0; bit < 8; bit++)
+                        value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                    values[i] = value;
+                }
+            }
+        } table;
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    void AppendBigEndian(std::vector<unsigned char>& out, uint32_t value)
+    {
+        out.push_back((unsigned char)(value >> 24));
+        out.push_back((unsigned char)(value >> 16));
+        out.push_back((unsigned char)(value >> 8));
+        out.push_back((unsigned char)value);
+    }
+
+    void WritePNGChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+    {
+        std::vector<unsigned char> header;
+        AppendBigEndian(header, (uint32_t)data.size());
+        header.insert(header.end(), type, type + 4);
+        std::vector<unsigned char> crc;
+        AppendBigEndian(crc, Crc32(data.data(), data.size(), Crc32((const unsigned char*)type, 4)));
+        file.write((const char*)header.data(), header.size());
+        file.write((const char*)data.data(), data.size());
+        file.write((const char*)crc.data(), crc.size());
+    }
+}
+
+bool SoftwareImage::WritePNG(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    // scanlines top to bottom, each with filter type 0
+    size_t rowSize = (size_t)width * 3 + 1;
+    std::vector<unsigned char> scanlines(rowSize * height);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char* row = &scanlines[(size_t)y * rowSize];
+        const unsigned char* source = &pixels[(size_t)(height - 1 - y) * width * 4];
+        row[0] = 0;
+        for (int x = 0; x < width; x++)
+            memcpy(&row[1 + (size_t)x * 3], &source[(size_t)x * 4], 3);
+    }
+
+    // zlib stream of uncompressed deflate blocks
+    std::vector<unsigned char> data = { 0x78, 0x01 };
+    data.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t offset = 0;
+    while (true)
+    {
+        size_t size = std::min<size_t>(65535, scanlines.size() - offset);
+        bool last = offset + size == scanlines.size();
+        data.push_back(last ? 1 : 0);
+        data.push_back((unsigned char)size);
+        data.push_back((unsigned char)(size >> 8));
+        data.push_back((unsigned char)~size);
+        data.push_back((unsigned char)(~size >> 8));
+        data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+        // 5552 bytes is the most that can be summed before the 32 bit sums could overflow
+        for (size_t i = offset; i < offset + size; )
+        {
+            size_t end = std::min(offset + size, i + 5552);
+            for (; i < end; i++)
+            {
+                adlerA += scanlines[i];
+                adlerB += adlerA;
+            }
+            adlerA %= 65521;
+            adlerB %= 65521;
+        }
+        offset += size;
+        if (last)
+            break;
+    }
+    AppendBigEndian(data, (adlerB << 16) | adlerA);
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write((const char*)signature, sizeof(signature));
+    std::vector<unsigned char> header;
+    AppendBigEndian(header, (uint32_t)width);
+    AppendBigEndian(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 });	// 8 bit RGB, deflate, no interlace
+    WritePNGChunk(file, "IHDR", header);
+    WritePNGChunk(file, "IDAT", data);
+    WritePNGChunk(file, "IEND", {});
+    return (bool)file;
+}
+
+bool SoftwareImage::ReadPPM(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int maxValue = 0;
+    file >> magic >> width >> height >> maxValue;
+    file.get();
+    if (!file || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0)
+        return false;
+
+    pixels.assign((size_t)width * height * 4, 255);
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        if (!file.read((char*)row.data(), row.size()))
+            return false;
+        unsigned char* destination = &pixels[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++)
+            memcpy(&destination[(size_t)x * 4], &row[(size_t)x * 3], 3);
+    }
+    return true;
+}
+
+ImageDifference CompareImages(const SoftwareImage& a, const SoftwareImage& b, int tolerance)
+{
+    ImageDifference difference;
+    if (a.width != b.width || a.height != b.height || a.pixels.size() != b.pixels.size())
+    {
+        difference.sizeMismatch = true;
+        return difference;
+    }
+
+    unsigned long long errorSum = 0;
+    size_t pixelCount = (size_t)a.width * a.height;
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        int pixelError = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            int error = abs((int)a.pixels[i * 4 + c] - (int)b.pixels[i * 4 + c]);
+            errorSum += error;
+            pixelError = std::max(pixelError, error);
+        }
+        difference.maxChannelError = std::max(difference.maxChannelError, pixelError);
+        if (pixelError > tolerance)
+            difference.differentPixels++;
+    }
+    difference.meanChannelError = pixelCount ? (double)errorSum / (pixelCount * 3) : 0.0;
+    return difference;
+}
+
+bool SoftwareTexture::Load(const std::string& path)
+{
+    mips.resize(1);
+    if (!mips[0].Load(path))
+        return false;
+    BuildMips();
+    return true;
+}
+
+void SoftwareTexture::BuildMips()
+{
+    const float* toLinear = GetSrgbToLinearTable();
+    mips.resize(1);
+    while (mips.back().width > 1 || mips.back().height > 1)
+    {
+        const SoftwareImage& source = mips.back();
+        SoftwareImage mip;
+        mip.width = std::max(source.width / 2, 1);
+        mip.height = std::max(source.height / 2, 1);
+        mip.pixels.resize((size_t)mip.width * mip.height * 4);
+        for (int y = 0; y < mip.height; y++)
+        {
+            for (int x = 0; x < mip.width; x++)
+            {
+                int x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+                int y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+                const unsigned char* p[4] = {
+                    &source.pixels[((size_t)y0 * source.width + x0) * 4], &source.pixels[((size_t)y0 * source.width + x1) * 4],
+                    &source.pixels[((size_t)y1 * source.width + x0) * 4], &source.pixels[((size_t)y1 * source.width + x1) * 4] };
+                unsigned char* destination = &mip.pixels[((size_t)y * mip.width + x) * 4];
+                for (int c = 0; c < 3; c++)
+                    destination[c] = LinearToSrgb((toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]]) * 0.25f);
+                destination[3] = (unsigned char)((p[0][3] + p[1][3] + p[2][3] + p[3][3] + 2) / 4);
+            }
+        }
+        mips.push_back(std::move(mip));
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, unsigned int threads)
+    : mWidth(width), mHeight(height), mNextTile(0), mShadedPixels(0)
+{
+    mTilesX = (width + TileSize - 1) / TileSize;
+    mTilesY = (height + TileSize - 1) / TileSize;
+    mColor.resize((size_t)width * height);
+    mDepth.resize((size_t)width * height);
+    mBins.resize((size_t)mTilesX * mTilesY);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // the thread calling Finish rasterizes tiles too
+    for (unsigned int i = 1; i < threads; i++)
+        mThreads.emplace_back(&SoftwareRasterizer::Run, this);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+    }
+    mCondition.notify_all();
+    for (std::thread& thread : mThreads)
+        thread.join();
+}
+
+void SoftwareRasterizer::Clear(const glm::vec4& linearColor)
+{
+    mClearPending = true;
+    mClearColor = PackColor(linearColor);
+    mTriangles.clear();
+    mShapes.clear();
+    for (std::vector<unsigned int>& bin : mBins)
+        bin.clear();
+}
+
+void SoftwareRasterizer::BindVertexData(const std::vector<float>* vertices, unsigned int stride)
+{
+    mVertices = vertices;
+    mStride = stride;
+}
+
+void SoftwareRasterizer::BindIndexData(const std::vector<unsigned int>* indices)
+{
+    mIndices = indices;
+}
+
+void SoftwareRasterizer::BindTextureLayers(const std::vector<SoftwareTexture>* layers)
+{
+    mLayers = layers;
+}
+
+void SoftwareRasterizer::SetFrameUniforms(const FrameUniforms& frameUniforms)
+{
+    mFrameUniforms = frameUniforms;
+}
+
+void SoftwareRasterizer::SetDrawUniforms(const DrawUniforms& drawUniforms)
+{
+    mDrawUniforms = drawUniforms;
+}
+
+void SoftwareRasterizer::DrawElements(unsigned int indexCount)
+{
+    if (!mVertices || !mIndices)
+        return;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    glm::mat4 transform = mFrameUniforms.viewProjection * mDrawUniforms.model;
+    indexCount = std::min(indexCount, (unsigned int)mIndices->size());
+    for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+    {
+        Vertex vertices[3];
+        for (int j = 0; j < 3; j++)
+        {
+            const float* source = &(*mVertices)[(size_t)(*mIndices)[i + j] * mStride];
+            vertices[j].position = transform * glm::vec4(source[0], source[1], source[2], 1.0f);
+            vertices[j].texCoord = glm::vec2(source[3], source[4]);
+        }
+        mStats.triangles++;
+        ClipTriangle(vertices, -1);
+    }
+    mStats.setupMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftwareRasterizer::DrawShapes(const std::vector<ShapeInstance>& shapes)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const glm::mat4& viewProjection = mFrameUniforms.viewProjection;
+    glm::vec2 halfViewport = mFrameUniforms.viewportSize * 0.5f;
+    auto projectToPixels = [&](const glm::vec3& position)
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        return glm::vec2(clip) / std::max(clip.w, 1e-5f) * halfViewport;
+    };
+
+    for (const ShapeInstance& instance : shapes)
+    {
+        Shape shape;
+        shape.halfSize = glm::vec2(glm::unpackHalf1x16(instance.halfSize[0]), glm::unpackHalf1x16(instance.halfSize[1]));
+        shape.params = glm::vec2(glm::unpackHalf1x16(instance.params[0]), glm::unpackHalf1x16(instance.params[1]));
+        shape.type = instance.type;
+        glm::vec4 fill = UnpackColorSRGB(instance.fillColor);
+        glm::vec4 stroke = UnpackColorSRGB(instance.strokeColor);
+        shape.fill = glm::vec4(glm::vec3(fill) * fill.a, fill.a);
+        shape.stroke = glm::vec4(glm::vec3(stroke) * stroke.a, stroke.a);
+
+        // the quad of Shape.vert: the outline's extent, grown by half the stroke and 1.5 pixels
+        float angle = instance.rotation * (6.28318530718f / 65536.0f);
+        glm::vec3 axisX = glm::vec3(cosf(angle), sinf(angle), 0.0f);
+        glm::vec3 axisY = glm::vec3(-axisX.y, axisX.x, 0.0f);
+        glm::vec2 extent = shape.halfSize;
+        if (shape.type == ShapeLine)
+            extent.x += shape.halfSize.y;
+        else if (shape.type == ShapeRing)
+            extent += 0.5f * shape.params.x;
+        glm::vec2 centerPixels = projectToPixels(instance.center);
+        float pixelsPerUnit = std::min(glm::length(projectToPixels(instance.center + axisX) - centerPixels),
+            glm::length(projectToPixels(instance.center + axisY) - centerPixels));
+        extent += 0.5f * shape.params.y + 1.5f / std::max(pixelsPerUnit, 1e-4f);
+
+        int index = (int)mShapes.size();
+        mShapes.push_back(shape);
+        Vertex corners[4];
+        for (int i = 0; i < 4; i++)
+        {
+            glm::vec2 localPos = (glm::vec2((float)(i & 1), (float)(i >> 1)) * 2.0f - 1.0f) * extent;
+            corners[i].position = viewProjection * glm::vec4(instance.center + axisX * localPos.x + axisY * localPos.y, 1.0f);
+            corners[i].texCoord = localPos;
+        }
+        // the 4 vertex triangle strip
+        const Vertex first[3] = { corners[0], corners[1], corners[2] };
+        const Vertex second[3] = { corners[1], corners[3], corners[2] };
+        mStats.triangles += 2;
+        ClipTriangle(first, index);
+        ClipTriangle(second, index);
+    }
+    mStats.setupMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftwareRasterizer::ClipTriangle(const Vertex (&vertices)[3], int shape)
+{
+    // against w = MinClipW, a triangle becomes at most a quad
+    Vertex clipped[4];
+    int count = 0;
+    for (int j = 0; j < 3; j++)
+    {
+        const Vertex& current = vertices[j];
+        const Vertex& next = vertices[(j + 1) % 3];
+        bool currentInside = current.position.w >= MinClipW;
+        bool nextInside = next.position.w >= MinClipW;
+        if (currentInside)
+            clipped[count++] = current;
+        if (currentInside != nextInside)
+        {
+            float t = (MinClipW - current.position.w) / (next.position.w - current.position.w);
+            clipped[count].position = current.position + (next.position - current.position) * t;
+            clipped[count].texCoord = current.texCoord + (next.texCoord - current.texCoord) * t;
+            count++;
+        }
+    }
+    for (int j = 1; j + 1 < count; j++)
+        SetupTriangle(clipped[0], clipped[j], clipped[j + 1], shape);
+}
+
+void SoftwareRasterizer::SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, int shape)
+{
+    const Vertex* vertices[3] = { &v0, &v1, &v2 };
+    float x[3], y[3], inverseW[3];
+    for (int i = 0; i < 3; i++)
+    {
+        inverseW[i] = 1.0f / vertices[i]->position.w;
+        x[i] = (vertices[i]->position.x * inverseW[i] * 0.5f + 0.5f) * mWidth;
+        y[i] = (vertices[i]->position.y * inverseW[i] * 0.5f + 0.5f) * mHeight;
+    }
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0f || !std::isfinite(area))
+        return;
+    // culling is off in the GL path, turn clockwise triangles around so the inside is positive
+    if (area < 0.0f)
+    {
+        std::swap(vertices[1], vertices[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(inverseW[1], inverseW[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+    float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+    float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+    // pixels whose centers can be inside
+    triangle.minX = std::max(0, (int)ceilf(minX - 0.5f));
+    triangle.minY = std::max(0, (int)ceilf(minY - 0.5f));
+    triangle.maxX = std::min(mWidth - 1, (int)floorf(maxX - 0.5f));
+    triangle.maxY = std::min(mHeight - 1, (int)floorf(maxY - 0.5f));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    float inverseArea = 1.0f / area;
+    for (int i = 0; i < 3; i++)
+    {
+        int from = (i + 1) % 3, to = (i + 2) % 3;
+        float dx = x[to] - x[from];
+        float dy = y[to] - y[from];
+        triangle.a[i] = y[from] - y[to];
+        triangle.b[i] = dx;
+        triangle.c[i] = x[from] * y[to] - x[to] * y[from];
+        // counter clockwise with y up: left edges run down, top edges run left
+        triangle.topLeft[i] = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+    }
+
+    // attribute planes from the barycentric weights edge / area
+    float u[3], v[3];
+    for (int i = 0; i < 3; i++)
+    {
+        u[i] = vertices[i]->texCoord.x * inverseW[i];
+        v[i] = vertices[i]->texCoord.y * inverseW[i];
+    }
+    const float* attributes[3] = { u, v, inverseW };
+    float* planes[3] = { triangle.u, triangle.v, triangle.q };
+    for (int p = 0; p < 3; p++)
+    {
+        planes[p][0] = (triangle.a[0] * attributes[p][0] + triangle.a[1] * attributes[p][1] + triangle.a[2] * attributes[p][2]) * inverseArea;
+        planes[p][1] = (triangle.b[0] * attributes[p][0] + triangle.b[1] * attributes[p][1] + triangle.b[2] * attributes[p][2]) * inverseArea;
+        planes[p][2] = (triangle.c[0] * attributes[p][0] + triangle.c[1] * attributes[p][1] + triangle.c[2] * attributes[p][2]) * inverseArea;
+    }
+    triangle.layers = mDrawUniforms.layers;
+    triangle.shape = shape;
+
+    unsigned int index = (unsigned int)mTriangles.size();
+    mTriangles.push_back(triangle);
+    for (int tileY = triangle.minY / TileSize; tileY <= triangle.maxY / TileSize; tileY++)
+    {
+        for (int tileX = triangle.minX / TileSize; tileX <= triangle.maxX / TileSize; tileX++)
+        {
+            mBins[(size_t)tileY * mTilesX + tileX].push_back(index);
+            mStats.binned++;
+        }
+    }
+}
+
+void SoftwareRasterizer::Finish()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    mNextTile = 0;
+    mShadedPixels = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGeneration++;
+        mBusy = (unsigned int)mThreads.size();
+    }
+    mCondition.notify_all();
+
+    RasterizeTiles();
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mBusy == 0; });
+    }
+
+    mClearPending = false;
+    mTriangles.clear();
+    mShapes.clear();
+    for (std::vector<unsigned int>& bin : mBins)
+        bin.clear();
+    mStats.pixels += mShadedPixels;
+    mStats.rasterMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftwareRasterizer::Run()
+{
+    unsigned long long generation = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true)
+    {
+        mCondition.wait(lock, [&] { return mGeneration != generation || !mRunning; });
+        if (!mRunning)
+            return;
+        generation = mGeneration;
+
+        lock.unlock();
+        RasterizeTiles();
+        lock.lock();
+
+        if (--mBusy == 0)
+            mCondition.notify_all();
+    }
+}
+
+void SoftwareRasterizer::RasterizeTiles()
+{
+    unsigned int tileCount = (unsigned int)mBins.size();
+    unsigned int tile;
+    while ((tile = mNextTile++) < tileCount)
+        RasterizeTile(tile);
+}
+
+void SoftwareRasterizer::RasterizeTile(unsigned int tile)
+{
+    int tileMinX = (int)(tile % mTilesX) * TileSize;
+    int tileMinY = (int)(tile / mTilesX) * TileSize;
+    int tileMaxX = std::min(tileMinX + TileSize, mWidth) - 1;
+    int tileMaxY = std::min(tileMinY + TileSize, mHeight) - 1;
+
+    if (mClearPending)
+    {
+        for (int y = tileMinY; y <= tileMaxY; y++)
+        {
+            std::fill(&mColor[(size_t)y * mWidth + tileMinX], &mColor[(size_t)y * mWidth + tileMaxX] + 1, mClearColor);
+            std::fill(&mDepth[(size_t)y * mWidth + tileMinX], &mDepth[(size_t)y * mWidth + tileMaxX] + 1, 0.0f);
+        }
+    }
+
+    unsigned long long shaded = 0;
+    bool textured = mLayers && !mLayers->empty();
+    for (unsigned int index : mBins[tile])
+    {
+        const Triangle& triangle = mTriangles[index];
+        int minX = std::max(triangle.minX, tileMinX);
+        int maxX = std::min(triangle.maxX, tileMaxX);
+        int minY = std::max(triangle.minY, tileMinY);
+        int maxY = std::min(triangle.maxY, tileMaxY);
+
+        Float4 a[3];
+        for (int i = 0; i < 3; i++)
+            a[i] = Float4::Set(triangle.a[i]);
+        Float4 uA = Float4::Set(triangle.u[0]), vA = Float4::Set(triangle.v[0]), qA = Float4::Set(triangle.q[0]);
+
+        const Shape* shape = triangle.shape >= 0 ? &mShapes[triangle.shape] : nullptr;
+        const SoftwareTexture* layer0 = nullptr;
+        const SoftwareTexture* layer1 = nullptr;
+        if (textured && !shape)
+        {
+            int layerCount = (int)mLayers->size();
+            layer0 = &(*mLayers)[std::min(std::max((int)(triangle.layers.x + 0.5f), 0), layerCount - 1)];
+            layer1 = &(*mLayers)[std::min(std::max((int)(triangle.layers.y + 0.5f), 0), layerCount - 1)];
+        }
+
+        for (int y = minY; y <= maxY; y++)
+        {
+            float pixelY = y + 0.5f;
+            Float4 row[3];
+            for (int i = 0; i < 3; i++)
+                row[i] = Float4::Set(triangle.b[i] * pixelY + triangle.c[i]);
+            Float4 uRow = Float4::Set(triangle.u[1] * pixelY + triangle.u[2]);
+            Float4 vRow = Float4::Set(triangle.v[1] * pixelY + triangle.v[2]);
+            Float4 qRow = Float4::Set(triangle.q[1] * pixelY + triangle.q[2]);
+            uint32_t* destination = &mColor[(size_t)y * mWidth];
+            float* depth = &mDepth[(size_t)y * mWidth];
+
+            for (int x = minX; x <= maxX; x += 4)
+            {
+                Float4 pixelX = Float4::Ramp(x + 0.5f);
+                int mask = (a[0] * pixelX + row[0]).Inside(triangle.topLeft[0])
+                    & (a[1] * pixelX + row[1]).Inside(triangle.topLeft[1])
+                    & (a[2] * pixelX + row[2]).Inside(triangle.topLeft[2]);
+                // lanes past the right edge of the bounding box
+                if (maxX - x < 3)
+                    mask &= (1 << (maxX - x + 1)) - 1;
+                if (mask == 0)
+                    continue;
+
+                float u[4], v[4], q[4];
+                (uA * pixelX + uRow).Store(u);
+                (vA * pixelX + vRow).Store(v);
+                (qA * pixelX + qRow).Store(q);
+
+                // the nearer fragment wins like in the GL path, 1 / w orders them the same with or without reversed Z
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if ((mask & (1 << lane)) && !(q[lane] > depth[x + lane]))
+                        mask &= ~(1 << lane);
+                }
+                if (mask == 0)
+                    continue;
+
+                // shapes are tested against the quads without writing depth, like the GL path's shape pass
+                if (shape)
+                {
+                    shaded += ShadeShape(triangle, *shape, mask, u, v, q, destination + x);
+                    continue;
+                }
+
+                // like GL's 2x2 quads, the group shares one mip level, taken at its first covered pixel
+                float lod0 = 0.0f, lod1 = 0.0f;
+                if (textured)
+                {
+                    int lane = 0;
+                    while (!(mask & (1 << lane)))
+                        lane++;
+                    float w = 1.0f / q[lane];
+                    float s = u[lane] * w;
+                    float t = v[lane] * w;
+                    // derivatives of a ratio of planes: (dU - s * dQ) / Q
+                    float dsdx = (triangle.u[0] - s * triangle.q[0]) * w;
+                    float dsdy = (triangle.u[1] - s * triangle.q[1]) * w;
+                    float dtdx = (triangle.v[0] - t * triangle.q[0]) * w;
+                    float dtdy = (triangle.v[1] - t * triangle.q[1]) * w;
+                    lod0 = ComputeLod(*layer0, dsdx, dtdx, dsdy, dtdy);
+                    lod1 = layer1->mips[0].width == layer0->mips[0].width && layer1->mips[0].height == layer0->mips[0].height
+                        ? lod0 : ComputeLod(*layer1, dsdx, dtdx, dsdy, dtdy);
+                }
+
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    if (!(mask & (1 << lane)))
+                        continue;
+
+                    glm::vec4 color;
+                    if (textured)
+                    {
+                        // perspective correct texture coordinates
+                        float w = 1.0f / q[lane];
+                        glm::vec4 first = SampleTrilinear(*layer0, u[lane] * w, v[lane] * w, lod0);
+                        glm::vec4 second = SampleTrilinear(*layer1, u[lane] * w, v[lane] * w, lod1);
+                        color = first + (second - first) * 0.2f;
+                    }
+                    else
+                    {
+                        color = mDrawUniforms.color;
+                    }
+                    destination[x + lane] = PackColor(color);
+                    depth[x + lane] = q[lane];
+                    shaded++;
+                }
+            }
+        }
+    }
+    mShadedPixels += shaded;
+}
+
+SoftwareImage SoftwareRasterizer::GetColorBuffer() const
+{
+    SoftwareImage image;
+    image.width = mWidth;
+    image.height = mHeight;
+    image.pixels.resize(mColor.size() * 4);
+    memcpy(image.pixels.data(), mColor.data(), image.pixels.size());
+    return image;
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "UniformBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ShapeInstance;
+
+// RGBA8 image, rows bottom to top like GL textures and glReadPixels
+struct SoftwareImage
+{
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> pixels;
+
+	// flipped on load like Texture, so texture coordinates match the GL path
+	bool Load(const std::string& path);
+	// binary PPM, alpha is dropped
+	bool WritePPM(const std::string& path) const;
+	// RGB, stored deflate blocks so writing costs little more than the PPM
+	bool WritePNG(const std::string& path) const;
+	bool ReadPPM(const std::string& path);
+};
+
+struct ImageDifference
+{
+	unsigned long long differentPixels = 0;	// pixels with a channel more than the tolerance off
+	int maxChannelError = 0;
+	double meanChannelError = 0.0;
+	bool sizeMismatch = false;
+};
+
+// compares rgb only, for checking a frame against a reference image
+ImageDifference CompareImages(const SoftwareImage& a, const SoftwareImage& b, int tolerance);
+
+// sRGB image with a mip chain, box filtered in linear space like glGenerateMipmap
+struct SoftwareTexture
+{
+	std::vector<SoftwareImage> mips;
+
+	bool Load(const std::string& path);
+	void BuildMips();
+};
+
+struct SoftwareRasterizerStats
+{
+	unsigned long long triangles = 0;	// submitted
+	unsigned long long binned = 0;		// survived clipping and culling, counted once per tile they touch
+	unsigned long long pixels = 0;		// shaded
+	double setupMilliseconds = 0.0;
+	double rasterMilliseconds = 0.0;
+};
+
+// CPU reference for the GL path, it draws what the Basic shader does with the TEXTURED feature and
+// what Shape.vert/.frag do for a ShapeBatch. Draws are transformed and binned into 64x64 tiles as
+// they come in, Finish then rasterizes the tiles in parallel, each tile going through its triangles
+// in submission order. Edge functions are evaluated four pixels at a time (SSE2 where available)
+// and attributes are interpolated perspective correct, with trilinear filtering from the analytic
+// texture coordinate derivatives. Output is sRGB encoded like a GL_FRAMEBUFFER_SRGB default
+// framebuffer. Depth is 1 / w, which orders fragments the same with or without reversed Z: quads
+// are depth tested and written like the GL path's scene pass, shapes are tested without writing
+// and blended premultiplied in linear space. Triangles are only clipped at w = 1e-4, not at the
+// near plane.
+class SoftwareRasterizer
+{
+public:
+	// threads = 0 uses every hardware thread
+	SoftwareRasterizer(int width, int height, unsigned int threads = 0);
+	~SoftwareRasterizer();
+
+	// clears happen tile by tile in Finish, draws before a clear are dropped
+	void Clear(const glm::vec4& linearColor);
+
+	// the same state the GL path binds: position (xyz) and texture coordinates (uv) per vertex,
+	// indices, the texture array layers and the FrameData/DrawData blocks
+	void BindVertexData(const std::vector<float>* vertices, unsigned int stride = 5);
+	void BindIndexData(const std::vector<unsigned int>* indices);
+	void BindTextureLayers(const std::vector<SoftwareTexture>* layers);
+	void SetFrameUniforms(const FrameUniforms& frameUniforms);
+	void SetDrawUniforms(const DrawUniforms& drawUniforms);
+	void DrawElements(unsigned int indexCount);
+	// an instanced draw of Shape.vert/.frag, with the frame uniforms set last
+	void DrawShapes(const std::vector<ShapeInstance>& shapes);
+
+	void Finish();
+
+	// rows bottom to top
+	SoftwareImage GetColorBuffer() const;
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	unsigned int GetThreadCount() const { return (unsigned int)mThreads.size() + 1; }
+
+	const SoftwareRasterizerStats& GetStats() const { return mStats; }
+	void ResetStats() { mStats = SoftwareRasterizerStats(); }
+
+	struct Triangle;
+	struct Vertex;
+	struct Shape;
+
+private:
+	// clips against w = 1e-4 and sets up what's left, shape is an index into mShapes or -1 for a quad
+	void ClipTriangle(const Vertex (&vertices)[3], int shape);
+	void SetupTriangle(const Vertex& v0, const Vertex& v1, const Vertex& v2, int shape);
+	void RasterizeTiles();
+	void RasterizeTile(unsigned int tile);
+	void Run();
+
+	int mWidth;
+	int mHeight;
+	int mTilesX;
+	int mTilesY;
+	std::vector<uint32_t> mColor;
+	std::vector<float> mDepth;	// 1 / w, larger is closer, cleared to 0
+
+	const std::vector<float>* mVertices = nullptr;
+	unsigned int mStride = 5;
+	const std::vector<unsigned int>* mIndices = nullptr;
+	const std::vector<SoftwareTexture>* mLayers = nullptr;
+	FrameUniforms mFrameUniforms = {};
+	DrawUniforms mDrawUniforms = {};
+
+	bool mClearPending = false;
+	uint32_t mClearColor = 0;
+	std::vector<Triangle> mTriangles;
+	std::vector<Shape> mShapes;
+	std::vector<std::vector<unsigned int>> mBins;
+
+	// workers sleep until Finish bumps the generation, then take tiles off a shared counter
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	unsigned long long mGeneration = 0;
+	unsigned int mBusy = 0;
+	bool mRunning = true;
+	std::atomic<unsigned int> mNextTile;
+	std::atomic<unsigned long long> mShadedPixels;
+
+	SoftwareRasterizerStats mStats;
+};
@@ -0,0 +1,211 @@
+#include "TextRenderer.h"
+#include "FontAtlas.h"
+#include "ShapeRenderer.h"
+#include "Shader.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+uint32_t DecodeUTF8(const std::string& utf8, size_t& index)
+{
+    unsigned char lead = (unsigned char)utf8[index++];
+    if (lead < 0x80)
+        return lead;
+
+    int continuation;
+    uint32_t codepoint;
+    if ((lead & 0xE0) == 0xC0)
+    {
+        continuation = 1;
+        codepoint = lead & 0x1F;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        continuation = 2;
+        codepoint = lead & 0x0F;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        continuation = 3;
+        codepoint = lead & 0x07;
+    }
+    else
+    {
+        return 0xFFFD;
+    }
+
+    for (int i = 0; i < continuation; i++)
+    {
+        if (index >= utf8.size() || ((unsigned char)utf8[index] & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = (codepoint << 6) | ((unsigned char)utf8[index++] & 0x3F);
+    }
+    // overlong encodings, surrogates and code points past Unicode's range
+    const uint32_t smallest[4] = { 0, 0x80, 0x800, 0x10000 };
+    if (codepoint < smallest[continuation] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+        return 0xFFFD;
+    return codepoint;
+}
+
+// TextBatch
+
+void TextBatch::Clear()
+{
+    for (std::vector<GlyphInstance>& glyphs : mGlyphs)
+        glyphs.clear();
+}
+
+float TextBatch::MeasureLine(const std::string& utf8, size_t begin, size_t end) const
+{
+    float advance = 0.0f;
+    for (size_t i = begin; i < end; )
+        advance += mFont->GetGlyph(DecodeUTF8(utf8, i)).advance;
+    return advance;
+}
+
+void TextBatch::AddText(const std::string& utf8, TextSpace space, const glm::vec3& anchor, float size, const glm::vec4& color, TextAlign align)
+{
+    std::vector<GlyphInstance>& glyphs = mGlyphs[space];
+    glyphs.reserve(glyphs.size() + utf8.size());
+
+    GlyphInstance glyph;
+    glyph.anchor = anchor;
+    // screen text starts on a whole pixel, the glyphs stay as sharp as the field allows
+    if (space == TextSpaceScreen)
+        glyph.anchor = glm::vec3(std::floor(anchor.x + 0.5f), std::floor(anchor.y + 0.5f), 0.0f);
+    glyph.color = PackColorSRGB(color);
+
+    // pixels from the anchor, y up, so the first baseline is an ascent below it
+    float baseline = -mFont->GetAscent() * size;
+    size_t lineBegin = 0;
+    while (lineBegin <= utf8.size())
+    {
+        size_t lineEnd = utf8.find('\n', lineBegin);
+        if (lineEnd == std::string::npos)
+            lineEnd = utf8.size();
+
+        float pen = 0.0f;
+        if (align != TextAlignLeft)
+            pen = -MeasureLine(utf8, lineBegin, lineEnd) * size * (align == TextAlignCenter ? 0.5f : 1.0f);
+        for (size_t i = lineBegin; i < lineEnd; )
+        {
+            const GlyphMetrics& metrics = mFont->GetGlyph(DecodeUTF8(utf8, i));
+            if (metrics.size.x > 0.0f)
+            {
+                glm::vec2 offset = glm::vec2(pen, baseline) + metrics.offset * size;
+                glyph.offset[0] = glm::packHalf1x16(offset.x);
+                glyph.offset[1] = glm::packHalf1x16(offset.y);
+                glyph.size[0] = glm::packHalf1x16(metrics.size.x * size);
+                glyph.size[1] = glm::packHalf1x16(metrics.size.y * size);
+                glyph.uvRect[0] = glm::packUnorm1x16(metrics.uvMin.x);
+                glyph.uvRect[1] = glm::packUnorm1x16(metrics.uvMin.y);
+                glyph.uvRect[2] = glm::packUnorm1x16(metrics.uvMax.x);
+                glyph.uvRect[3] = glm::packUnorm1x16(metrics.uvMax.y);
+                glyphs.push_back(glyph);
+            }
+            pen += metrics.advance * size;
+        }
+        baseline -= mFont->GetLineHeight() * size;
+        lineBegin = lineEnd + 1;
+    }
+}
+
+// TextRenderer
+
+TextRenderer::TextRenderer(size_t capacity)
+{
+    RenderDevice& device = GetRenderDevice();
+    for (int space = 0; space < TextSpaceCount; space++)
+    {
+        mCapacity[space] = capacity < 1 ? 1 : capacity;
+        mVertexArrays[space] = device.GenVertexArray();
+        device.BindVertexArray(mVertexArrays[space]);
+        mInstanceBuffers[space] = device.GenBuffer();
+        device.BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffers[space]);
+        device.BufferData(GL_ARRAY_BUFFER, mCapacity[space] * sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+
+        // no per vertex attributes, the quad corners come from gl_VertexID
+        GLsizei stride = sizeof(GlyphInstance);
+        device.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, offsetof(GlyphInstance, anchor));
+        device.VertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(GlyphInstance, offset));
+        device.VertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, offsetof(GlyphInstance, size));
+        device.VertexAttribPointer(3, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, offsetof(GlyphInstance, uvRect));
+        device.VertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offsetof(GlyphInstance, color));
+        for (GLuint attribute = 0; attribute <= 4; attribute++)
+        {
+            device.EnableVertexAttribArray(attribute);
+            device.VertexAttribDivisor(attribute, 1);
+        }
+    }
+    device.BindVertexArray(0);
+    device.BindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+TextRenderer::~TextRenderer()
+{
+    DeleteTextRenderer();
+}
+
+void TextRenderer::Draw(const TextBatch& batch, FontAtlas& font, Shader& shader, unsigned int slot)
+{
+    if (batch.GetGlyphCount() == 0 || !mVertexArrays[0])
+        return;
+
+    RenderDevice& device = GetRenderDevice();
+    // Text.frag writes premultiplied alpha, like the shapes
+    device.Enable(GL_BLEND);
+    device.BlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    font.Bind(slot);
+    shader.UseProgram();
+    shader.SetUniformInt("glyphs", (int)slot);
+    for (int space = 0; space < TextSpaceCount; space++)
+    {
+        const std::vector<GlyphInstance>& glyphs = batch.GetGlyphs((TextSpace)space);
+        if (glyphs.empty())
+            continue;
+
+        device.BindBuffer(GL_ARRAY_BUFFER, mInstanceBuffers[space]);
+        while (mCapacity[space] < glyphs.size())
+            mCapacity[space] *= 2;
+        // orphan the storage, the driver hands out fresh memory instead of waiting for last frame's draw
+        device.BufferData(GL_ARRAY_BUFFER, mCapacity[space] * sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+        device.BufferSubData(GL_ARRAY_BUFFER, 0, glyphs.size() * sizeof(GlyphInstance), glyphs.data());
+        device.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+        shader.SetUniformInt("screenSpace", space == TextSpaceScreen);
+        device.BindVertexArray(mVertexArrays[space]);
+        device.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)glyphs.size());
+        mDraws++;
+    }
+    device.Disable(GL_BLEND);
+
+    mFrames++;
+    mGlyphs += batch.GetGlyphCount();
+}
+
+void TextRenderer::DeleteTextRenderer()
+{
+    RenderDevice& device = GetRenderDevice();
+    for (int space = 0; space < TextSpaceCount; space++)
+    {
+        if (mInstanceBuffers[space])
+            device.DeleteBuffer(mInstanceBuffers[space]);
+        if (mVertexArrays[space])
+            device.DeleteVertexArray(mVertexArrays[space]);
+        mInstanceBuffers[space] = mVertexArrays[space] = 0;
+    }
+}
+
+void TextRenderer::Report() const
+{
+    if (mFrames == 0)
+        return;
+
+    std::cout << "Text: " << (double)mGlyphs / mFrames << " glyphs in " << (double)mDraws / mFrames << " draws per frame, "
+        << sizeof(GlyphInstance) << " bytes each" << std::endl;
+}
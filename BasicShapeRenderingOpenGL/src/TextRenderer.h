@@ -0,0 +1,91 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FontAtlas;
+class Shader;
+
+// One glyph, exactly the per instance vertex attributes of Text.vert. Offsets and sizes are half
+// floats in pixels from the anchor, y up; the atlas rectangle is normalized 16 bit.
+struct GlyphInstance
+{
+	glm::vec3 anchor;		// world position of a label, or pixels from the top left for screen text
+	uint16_t offset[2];		// lower left corner of the glyph's quad
+	uint16_t size[2];
+	uint16_t uvRect[4];		// uv min, uv max
+	uint32_t color;			// sRGB encoded RGBA8
+};
+static_assert(sizeof(GlyphInstance) == 32, "GlyphInstance has to match the instance layout of Text.vert");
+
+enum TextSpace
+{
+	TextSpaceWorld,		// labels that follow a point in the scene and keep their pixel size
+	TextSpaceScreen,	// overlays like stats, anchored in pixels
+	TextSpaceCount
+};
+
+enum TextAlign
+{
+	TextAlignLeft,
+	TextAlignCenter,
+	TextAlignRight
+};
+
+// the next code point of utf8 starting at index, which moves past it; malformed bytes give U+FFFD
+uint32_t DecodeUTF8(const std::string& utf8, size_t& index);
+
+// Text collected for a frame. Strings are laid out into glyph instances when they're added,
+// without any GL calls, so it can be filled on the frame pipeline worker. The anchor is the top
+// of the first line, lines break at '\n' and each is aligned on its own.
+class TextBatch
+{
+public:
+	TextBatch(const FontAtlas& font) : mFont(&font) {}
+
+	void Clear();
+
+	// size is the font size in pixels, color is linear
+	void AddText(const std::string& utf8, TextSpace space, const glm::vec3& anchor, float size, const glm::vec4& color,
+		TextAlign align = TextAlignLeft);
+
+	const std::vector<GlyphInstance>& GetGlyphs(TextSpace space) const { return mGlyphs[space]; }
+	size_t GetGlyphCount() const { return mGlyphs[TextSpaceWorld].size() + mGlyphs[TextSpaceScreen].size(); }
+
+private:
+	// the advance of a line, in ems
+	float MeasureLine(const std::string& utf8, size_t begin, size_t end) const;
+
+	const FontAtlas* mFont;
+	std::vector<GlyphInstance> mGlyphs[TextSpaceCount];
+};
+
+// Draws a TextBatch with Text.vert/.frag as at most two instanced triangle strips, the labels and
+// then the screen text, every glyph a quad built from gl_VertexID. Text.frag antialiases the
+// distance field over a pixel at any size and adds an outline so it reads on any background.
+class TextRenderer
+{
+public:
+	TextRenderer(size_t capacity = 4096);
+	~TextRenderer();
+	TextRenderer(const TextRenderer&) = delete;
+	TextRenderer& operator=(const TextRenderer&) = delete;
+
+	// the atlas is bound at slot, blends over what's drawn so far and leaves blending off again
+	void Draw(const TextBatch& batch, FontAtlas& font, Shader& shader, unsigned int slot = 1);
+	void DeleteTextRenderer();
+
+	void Report() const;
+
+private:
+	// one buffer per space: GL 3.3 has no base instance, so both draws start at instance 0
+	unsigned int mVertexArrays[TextSpaceCount] = { 0, 0 };
+	unsigned int mInstanceBuffers[TextSpaceCount] = { 0, 0 };
+	size_t mCapacity[TextSpaceCount];	// glyphs each buffer has room for
+
+	unsigned long long mFrames = 0;
+	unsigned long long mGlyphs = 0;
+	unsigned long long mDraws = 0;
+};
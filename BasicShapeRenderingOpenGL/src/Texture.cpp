@@ -1,44 +1,240 @@
 #include "Texture.h"
+#include "TextureCompression.h"
+#include "GLExtensions.h"
+#include "RenderDevice.h"
 
 #include <glad/glad.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image/stb_image.h>
 #include <iostream>
+#include <vector>
 
-Texture::Texture(const std::string& texturePath)
+TextureFormat ChooseTextureFormat(int channels, bool srgb)
 {
-    glGenTextures(1, &mTextureID);
-    glBindTexture(GL_TEXTURE_2D, mTextureID);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    switch (channels)
+    {
+    // there are no single/dual channel sRGB formats in core GL, gray images are treated as linear
+    case 1: return { GL_R8, GL_RED, 1 };
+    case 2: return { GL_RG8, GL_RG, 2 };
+    // drivers store RGB8 as RGBA8 anyway, so pad on load instead of on upload
+    default: return { srgb ? (unsigned int)GL_SRGB8_ALPHA8 : (unsigned int)GL_RGBA8, GL_RGBA, 4 };
+    }
+}
+
+unsigned int ChooseCompressedFormat(unsigned int format, bool srgb)
+{
+    if (!srgb)
+        return format;
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+        return GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+    if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    return format;
+}
+
+int GetMipLevelCount(int width, int height)
+{
+    int levels = 1;
+    int size = width > height ? width : height;
+    while (size > 1)
+    {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+// 2x2 box filter, halves the image once per skipped mip level
+static void DownsampleImage(std::vector<unsigned char>& pixels, int& width, int& height, int channels)
+{
+    int nw = width > 1 ? width / 2 : 1, nh = height > 1 ? height / 2 : 1;
+    std::vector<unsigned char> next((size_t)nw * nh * channels);
+    for (int y = 0; y < nh; y++)
+    {
+        for (int x = 0; x < nw; x++)
+        {
+            int x0 = x * 2, x1 = x * 2 + 1 < width ? x * 2 + 1 : x * 2;
+            int y0 = y * 2, y1 = y * 2 + 1 < height ? y * 2 + 1 : y * 2;
+            for (int c = 0; c < channels; c++)
+            {
+                int sum = pixels[(y0 * width + x0) * channels + c] + pixels[(y0 * width + x1) * channels + c]
+                    + pixels[(y1 * width + x0) * channels + c] + pixels[(y1 * width + x1) * channels + c];
+                next[(y * nw + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    pixels.swap(next);
+    width = nw;
+    height = nh;
+}
+
+Texture::Texture(const std::string& texturePath, bool srgb, int skipMips)
+{
+    CreateTexture();
+
+    // cooked block compressed container, uploaded with its prebuilt mip chain
+    CompressedImage compressed;
+    if (IsCookedTexturePath(texturePath) && ReadCompressedImage(texturePath, compressed))
+    {
+        int firstLevel = skipMips < (int)compressed.mips.size() ? skipMips : (int)compressed.mips.size() - 1;
+        int levels = (int)compressed.mips.size() - firstLevel;
+        unsigned int format = ChooseCompressedFormat(compressed.format, srgb);
+
+        int width = compressed.width, height = compressed.height;
+        for (int level = 0; level < firstLevel; level++)
+        {
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        mWidth = width;
+        mHeight = height;
+
+        GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        GetRenderDevice().TexStorage2D(GL_TEXTURE_2D, levels, format, width, height);
+        for (int level = 0; level < levels; level++)
+        {
+            const std::vector<unsigned char>& mip = compressed.mips[firstLevel + level];
+            GetRenderDevice().CompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, width, height, format, (int)mip.size(), mip.data());
+            mMemorySize += mip.size();
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+        return;
+    }
 
     // load image, create texture and generate mipmaps
     int width, height, nrChannels;
+    if (!stbi_info(texturePath.c_str(), &width, &height, &nrChannels))
+    {
+        std::cout << "Failed to load texture " << texturePath << std::endl;
+        return;
+    }
+
+    TextureFormat format = ChooseTextureFormat(nrChannels, srgb);
     stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &nrChannels, format.channels);
+    if (!data)
+    {
+        std::cout << "Failed to load texture " << texturePath << std::endl;
+        return;
+    }
 
-    unsigned char* data = stbi_load(texturePath.c_str(), &width, &height, &nrChannels, 0);
-    if (data)
+    if (skipMips > 0)
     {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        std::vector<unsigned char> pixels(data, data + (size_t)width * height * format.channels);
+        for (int level = 0; level < skipMips && (width > 1 || height > 1); level++)
+            DownsampleImage(pixels, width, height, format.channels);
+        Upload(pixels.data(), width, height, format);
     }
     else
     {
-        std::cout << "Failed to load texture" << std::endl;
+        Upload(data, width, height, format);
     }
     stbi_image_free(data);
 }
 
+Texture::Texture(const unsigned char* encodedData, int size, bool srgb)
+{
+    CreateTexture();
+
+    int width, height, nrChannels;
+    if (!stbi_info_from_memory(encodedData, size, &width, &height, &nrChannels))
+    {
+        std::cout << "Failed to load texture from memory" << std::endl;
+        return;
+    }
+
+    TextureFormat format = ChooseTextureFormat(nrChannels, srgb);
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load_from_memory(encodedData, size, &width, &height, &nrChannels, format.channels);
+    if (data)
+        Upload(data, width, height, format);
+    else
+        std::cout << "Failed to load texture from memory" << std::endl;
+    stbi_image_free(data);
+}
+
+Texture::Texture(const unsigned char* pixels, int width, int height, int channels, bool srgb)
+{
+    CreateTexture();
+    TextureFormat format = ChooseTextureFormat(channels, srgb);
+    if (format.channels != channels)
+    {
+        std::cout << "Failed to create texture, " << channels << " channel pixels aren't supported" << std::endl;
+        return;
+    }
+    Upload(pixels, width, height, format);
+}
 
 Texture::~Texture()
 {
+    DeleteTexture();
 }
 
 void Texture::Bind(unsigned int slot)
 {
-    glBindTextureUnit(slot, mTextureID);
+    GetRenderDevice().BindTextureUnit(slot, mTextureID);
+}
+
+void Texture::SetWrap(int wrap)
+{
+    GetRenderDevice().BindTexture(GL_TEXTURE_2D, mTextureID);
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+}
+
+void Texture::DeleteTexture()
+{
+    GetRenderDevice().DeleteTexture(mTextureID);
+    mTextureID = 0;
+    mMemorySize = 0;
+}
+
+void Texture::CreateTexture()
+{
+    mTextureID = GetRenderDevice().GenTexture();
+    GetRenderDevice().BindTexture(GL_TEXTURE_2D, mTextureID);
+    // set the texture wrapping parameters
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // set texture filtering parameters
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    GetRenderDevice().TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void Texture::Upload(const unsigned char* data, int width, int height, const TextureFormat& format)
+{
+    // immutable storage for the whole mip chain, the driver can lay it out once
+    int levels = GetMipLevelCount(width, height);
+    GetRenderDevice().TexStorage2D(GL_TEXTURE_2D, levels, format.internalFormat, width, height);
+
+    mWidth = width;
+    mHeight = height;
+    for (int level = 0; level < levels; level++)
+    {
+        mMemorySize += (size_t)width * height * format.channels;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    width = mWidth;
+    height = mHeight;
+
+    // rows of 1/2 channel images aren't necessarily 4 byte aligned
+    GetRenderDevice().PixelStorei(GL_UNPACK_ALIGNMENT, (width * format.channels) % 4 == 0 ? 4 : 1);
+    GetRenderDevice().TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format.format, GL_UNSIGNED_BYTE, data);
+    GetRenderDevice().PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    // sample gray images as gray instead of red
+    if (format.channels == 1)
+    {
+        int swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        GetRenderDevice().TexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    else if (format.channels == 2)
+    {
+        int swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        GetRenderDevice().TexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    GetRenderDevice().GenerateMipmap(GL_TEXTURE_2D);
 }
@@ -1,16 +1,50 @@
 #pragma once
 #include <string>
 
+// GL formats matching a decoded image so uploads never need a driver side conversion
+struct TextureFormat
+{
+	unsigned int internalFormat;
+	unsigned int format;
+	int channels;	// channels to ask stbi for, 3 channel images are expanded to 4
+};
+
+TextureFormat ChooseTextureFormat(int channels, bool srgb);
+unsigned int ChooseCompressedFormat(unsigned int format, bool srgb);
+int GetMipLevelCount(int width, int height);
+
 class Texture
 {
 public:
-	Texture(const std::string& texturePath);
+	// srgb should be false for data textures (normal maps, masks, ...)
+	// skipMips drops that many of the largest levels, used to fit a memory budget
+	Texture(const std::string& texturePath, bool srgb = true, int skipMips = 0);
+	// encoded image (jpg, png, ...) that is already in memory
+	Texture(const unsigned char* encodedData, int size, bool srgb = true);
+	// raw 8 bit pixels with the first row at the bottom, e.g. a generated atlas
+	Texture(const unsigned char* pixels, int width, int height, int channels, bool srgb);
 	~Texture();
+	// the destructor deletes the GL texture
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
 
 	void Bind(unsigned int slot);
+	// GL_REPEAT by default, atlases want GL_CLAMP_TO_EDGE
+	void SetWrap(int wrap);
+	void DeleteTexture();
 
 	unsigned int GetTextureID() const { return mTextureID; }
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	// estimated VRAM of the whole mip chain
+	size_t GetMemorySize() const { return mMemorySize; }
 
 private:
+	void CreateTexture();
+	void Upload(const unsigned char* data, int width, int height, const TextureFormat& format);
+
 	unsigned int mTextureID;
-};
\ No newline at end of file
+	int mWidth = 0;
+	int mHeight = 0;
+	size_t mMemorySize = 0;
+};
@@ -0,0 +1,254 @@
+#include "TextureArray.h"
+#include "GLExtensions.h"
+
+#include <glad/glad.h>
+#include <stb_image/stb_image.h>
+#include <algorithm>
+#include <iostream>
+
+static const unsigned int noGroup = ~0u;
+
+TextureArray::TextureArray(int width, int height, const TextureFormat& format, int layers)
+    : mWidth(width), mHeight(height), mLayers(layers), mMipLevels(GetMipLevelCount(width, height)), mFormat(format)
+{
+    CreateTextureArray();
+
+    // immutable storage for every layer and mip, the contents are filled in by SetLayer
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mMipLevels, format.internalFormat, width, height, layers);
+
+    // sample gray images as gray instead of red
+    if (format.channels == 1)
+    {
+        int swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    else if (format.channels == 2)
+    {
+        int swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_GREEN };
+        glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+}
+
+TextureArray::TextureArray(int width, int height, unsigned int compressedFormat, int layers, int mipLevels)
+    : mWidth(width), mHeight(height), mLayers(layers), mMipLevels(mipLevels), mFormat({ compressedFormat, compressedFormat, 0 })
+{
+    CreateTextureArray();
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevels, compressedFormat, width, height, layers);
+}
+
+TextureArray::~TextureArray()
+{
+    DeleteTextureArray();
+}
+
+void TextureArray::SetLayer(int layer, const unsigned char* data)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    // rows of 1/2 channel images aren't necessarily 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (mWidth * mFormat.channels) % 4 == 0 ? 4 : 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, mWidth, mHeight, 1,
+        mFormat.format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void TextureArray::SetCompressedLayer(int layer, const CompressedImage& image)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    int w = mWidth, h = mHeight;
+    int levels = std::min((int)image.mips.size(), mMipLevels);
+    for (int level = 0; level < levels; level++)
+    {
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, w, h, 1, mFormat.internalFormat,
+            (int)image.mips[level].size(), image.mips[level].data());
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+}
+
+void TextureArray::GenerateMipmaps()
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+}
+
+void TextureArray::Bind(unsigned int slot)
+{
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+}
+
+void TextureArray::CreateTextureArray()
+{
+    glGenTextures(1, &mTextureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureArray::DeleteTextureArray()
+{
+    MakeNonResident();
+    glDeleteTextures(1, &mTextureID);
+}
+
+unsigned long long TextureArray::MakeResident()
+{
+    if (!glExtensions.ARB_bindless_texture)
+        return 0;
+
+    if (mBindlessHandle == 0)
+    {
+        // the texture becomes immutable once a handle exists, so mips must already be built
+        mBindlessHandle = glExtensions.GetTextureHandleARB(mTextureID);
+        glExtensions.MakeTextureHandleResidentARB(mBindlessHandle);
+    }
+    return mBindlessHandle;
+}
+
+void TextureArray::MakeNonResident()
+{
+    if (mBindlessHandle != 0)
+    {
+        glExtensions.MakeTextureHandleNonResidentARB(mBindlessHandle);
+        mBindlessHandle = 0;
+    }
+}
+
+TextureLibrary::TextureLibrary(bool srgb, unsigned int maxArrays)
+    : mSrgb(srgb), mMaxArrays(maxArrays)
+{
+}
+
+TextureLibrary::~TextureLibrary()
+{
+    for (Group& group : mGroups)
+    {
+        for (unsigned char* data : group.images)
+            stbi_image_free(data);
+    }
+}
+
+TextureLayer TextureLibrary::Add(const std::string& texturePath)
+{
+    if (IsCookedTexturePath(texturePath))
+    {
+        CompressedImage compressed;
+        if (!ReadCompressedImage(texturePath, compressed))
+        {
+            std::cout << "Failed to load cooked texture " << texturePath << std::endl;
+            return TextureLayer();
+        }
+        return Add(texturePath, std::move(compressed));
+    }
+
+    int width, height, nrChannels;
+    TextureFormat format = {};
+    unsigned char* data = NULL;
+    if (stbi_info(texturePath.c_str(), &width, &height, &nrChannels))
+    {
+        format = ChooseTextureFormat(nrChannels, mSrgb);
+        stbi_set_flip_vertically_on_load(true);
+        data = stbi_load(texturePath.c_str(), &width, &height, &nrChannels, format.channels);
+    }
+    if (!data)
+    {
+        std::cout << "Failed to load texture " << texturePath << std::endl;
+        return TextureLayer();
+    }
+
+    TextureLayer layer;
+    layer.array = FindGroup(width, height, format, false);
+    if (layer.array == noGroup)
+    {
+        std::cout << "Texture " << texturePath << " (" << width << "x" << height << ", " << nrChannels
+            << " channels) needs a texture array beyond the " << mMaxArrays << " the shaders sample" << std::endl;
+        stbi_image_free(data);
+        return TextureLayer();
+    }
+    Group& group = mGroups[layer.array];
+    group.images.push_back(data);
+    layer.layer = (unsigned int)group.images.size() - 1;
+    return layer;
+}
+
+TextureLayer TextureLibrary::Add(const std::string& name, CompressedImage compressed)
+{
+    ReportCompressedImage(name, compressed);
+
+    unsigned int compressedFormat = ChooseCompressedFormat(compressed.format, mSrgb);
+    TextureLayer layer;
+    layer.array = FindGroup(compressed.width, compressed.height, { compressedFormat, compressedFormat, 0 }, true);
+    if (layer.array == noGroup)
+    {
+        std::cout << "Texture " << name << " (" << compressed.width << "x" << compressed.height
+            << ", block compressed) needs a texture array beyond the " << mMaxArrays << " the shaders sample" << std::endl;
+        return TextureLayer();
+    }
+    Group& group = mGroups[layer.array];
+    group.compressed.push_back(std::move(compressed));
+    layer.layer = (unsigned int)group.compressed.size() - 1;
+    return layer;
+}
+
+unsigned int TextureLibrary::FindGroup(int width, int height, const TextureFormat& format, bool isCompressed)
+{
+    // groups that were already built have immutable layer counts, so only look at pending ones
+    unsigned int index = (unsigned int)mArrays.size();
+    while (index < mGroups.size())
+    {
+        const Group& group = mGroups[index];
+        if (group.width == width && group.height == height && group.format.internalFormat == format.internalFormat)
+            return index;
+        index++;
+    }
+    if (mMaxArrays && index >= mMaxArrays)
+        return noGroup;
+    mGroups.push_back({ width, height, format, isCompressed, {}, {} });
+    return index;
+}
+
+void TextureLibrary::Build()
+{
+    for (unsigned int i = 0; i < mGroups.size(); i++)
+    {
+        Group& group = mGroups[i];
+        if (i < mArrays.size())
+            continue;
+
+        if (group.isCompressed)
+        {
+            // a layer cooked with a shorter chain limits the whole array, levels past it would stay undefined
+            size_t mipLevels = group.compressed[0].mips.size();
+            for (const CompressedImage& image : group.compressed)
+                mipLevels = std::min(mipLevels, image.mips.size());
+            auto textureArray = std::make_unique<TextureArray>(group.width, group.height, group.format.internalFormat,
+                (int)group.compressed.size(), (int)mipLevels);
+            for (unsigned int layer = 0; layer < group.compressed.size(); layer++)
+                textureArray->SetCompressedLayer(layer, group.compressed[layer]);
+            group.compressed.clear();
+
+            mArrays.push_back(std::move(textureArray));
+            continue;
+        }
+
+        auto textureArray = std::make_unique<TextureArray>(group.width, group.height, group.format, (int)group.images.size());
+        for (unsigned int layer = 0; layer < group.images.size(); layer++)
+        {
+            textureArray->SetLayer(layer, group.images[layer]);
+            stbi_image_free(group.images[layer]);
+        }
+        group.images.clear();
+        textureArray->GenerateMipmaps();
+
+        mArrays.push_back(std::move(textureArray));
+    }
+}
+
+void TextureLibrary::Bind(unsigned int firstSlot)
+{
+    for (unsigned int i = 0; i < mArrays.size(); i++)
+        mArrays[i]->Bind(firstSlot + i);
+}
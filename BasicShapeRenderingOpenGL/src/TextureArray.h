@@ -0,0 +1,95 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Texture.h"
+#include "TextureCompression.h"
+
+// Layer inside one of the arrays owned by a TextureLibrary
+struct TextureLayer
+{
+	unsigned int array = 0;
+	unsigned int layer = 0;
+};
+
+class TextureArray
+{
+public:
+	TextureArray(int width, int height, const TextureFormat& format, int layers);
+	// block compressed array, every layer provides its own mip chain, levels past mipLevels are ignored
+	TextureArray(int width, int height, unsigned int compressedFormat, int layers, int mipLevels);
+	~TextureArray();
+	TextureArray(const TextureArray&) = delete;
+	TextureArray& operator=(const TextureArray&) = delete;
+
+	void SetLayer(int layer, const unsigned char* data);
+	void SetCompressedLayer(int layer, const CompressedImage& image);
+	void GenerateMipmaps();
+	void Bind(unsigned int slot);
+	void DeleteTextureArray();
+
+	// ARB_bindless_texture: returns 0 when the extension isn't available
+	unsigned long long MakeResident();
+	void MakeNonResident();
+
+	unsigned int GetTextureID() const { return mTextureID; }
+	unsigned long long GetBindlessHandle() const { return mBindlessHandle; }
+	int GetWidth() const { return mWidth; }
+	int GetHeight() const { return mHeight; }
+	int GetLayerCount() const { return mLayers; }
+	const TextureFormat& GetFormat() const { return mFormat; }
+
+private:
+	void CreateTextureArray();
+
+	unsigned int mTextureID;
+	unsigned long long mBindlessHandle = 0;
+	int mWidth, mHeight, mLayers;
+	int mMipLevels;
+	TextureFormat mFormat;	// channels is 0 for block compressed arrays
+};
+
+// Groups images by size/format into GL_TEXTURE_2D_ARRAYs so that everything sharing
+// a group can be sampled from one binding and selected per instance by layer.
+class TextureLibrary
+{
+public:
+	// maxArrays is how many arrays the shaders can sample (0 for no limit), images that would
+	// need another group are rejected by Add instead of sampling the wrong array
+	TextureLibrary(bool srgb = true, unsigned int maxArrays = 0);
+	~TextureLibrary();
+	TextureLibrary(const TextureLibrary&) = delete;
+	TextureLibrary& operator=(const TextureLibrary&) = delete;
+
+	// decodes the image (or reads a cooked .btex) and reserves a layer for it, layers are uploaded by Build();
+	// returns layer 0 of array 0 when the image can't be loaded or doesn't fit the arrays
+	TextureLayer Add(const std::string& texturePath);
+	// already cooked image, e.g. served by the AssetCache
+	TextureLayer Add(const std::string& name, CompressedImage compressed);
+	void Build();
+
+	// binds array i to texture unit firstSlot + i
+	void Bind(unsigned int firstSlot);
+
+	TextureArray& GetArray(unsigned int index) { return *mArrays[index]; }
+	unsigned int GetArrayCount() const { return (unsigned int)mArrays.size(); }
+
+private:
+	struct Group
+	{
+		int width, height;
+		TextureFormat format;
+		bool isCompressed;
+		std::vector<unsigned char*> images;
+		std::vector<CompressedImage> compressed;
+	};
+
+	bool mSrgb;
+	unsigned int mMaxArrays;
+	// noGroup when a new group would go past mMaxArrays
+	unsigned int FindGroup(int width, int height, const TextureFormat& format, bool isCompressed);
+
+	std::vector<Group> mGroups;
+	std::vector<std::unique_ptr<TextureArray>> mArrays;
+};
@@ -0,0 +1,371 @@
+#include "TextureCompression.h"
+#include "GLExtensions.h"
+#include "AssetCache.h"
+#include "Texture.h"
+
+#include <stb_image/stb_image.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+static const unsigned int CookedMagic = 0x58455442;	// "BTEX"
+static const unsigned int CookedVersion = 1;
+
+size_t CompressedImage::GetCompressedSize() const
+{
+    size_t size = 0;
+    for (const std::vector<unsigned char>& mip : mips)
+        size += mip.size();
+    return size;
+}
+
+size_t CompressedImage::GetUncompressedSize() const
+{
+    size_t size = 0;
+    int w = width, h = height;
+    for (size_t level = 0; level < mips.size(); level++)
+    {
+        size += (size_t)w * h * 4;
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+    return size;
+}
+
+static unsigned short PackRGB565(const unsigned char* color)
+{
+    return (unsigned short)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+static void UnpackRGB565(unsigned short value, int* color)
+{
+    int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// 4x4 block of RGBA8 pixels -> 8 byte BC1 color block, always in 4 color mode
+static void EncodeColorBlock(const unsigned char* block, unsigned char* out)
+{
+    unsigned char minColor[3] = { 255, 255, 255 }, maxColor[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+
+    // inset the bounding box a little, the endpoints themselves are rarely hit exactly
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] = (unsigned char)std::min(minColor[c] + inset, 255);
+        maxColor[c] = (unsigned char)std::max(maxColor[c] - inset, 0);
+    }
+
+    // channel wise max >= min, so color0 >= color1 and the block stays in 4 color mode
+    unsigned short color0 = PackRGB565(maxColor);
+    unsigned short color1 = PackRGB565(minColor);
+
+    unsigned int indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = INT_MAX;
+            for (int p = 0; p < 4; p++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = block[i * 4 + c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (unsigned int)best << (i * 2);
+        }
+    }
+
+    out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// 4x4 block of RGBA8 pixels -> 8 byte BC3 alpha block in 8 value mode
+static void EncodeAlphaBlock(const unsigned char* block, unsigned char* out)
+{
+    int alpha0 = 0, alpha1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        alpha0 = std::max(alpha0, (int)block[i * 4 + 3]);
+        alpha1 = std::min(alpha1, (int)block[i * 4 + 3]);
+    }
+
+    unsigned long long indices = 0;
+    if (alpha0 != alpha1)
+    {
+        int palette[8] = { alpha0, alpha1 };
+        for (int p = 1; p < 7; p++)
+            palette[p + 1] = ((7 - p) * alpha0 + p * alpha1) / 7;
+
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestError = INT_MAX;
+            for (int p = 0; p < 8; p++)
+            {
+                int error = std::abs(block[i * 4 + 3] - palette[p]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (unsigned long long)best << (i * 3);
+        }
+    }
+
+    out[0] = (unsigned char)alpha0;
+    out[1] = (unsigned char)alpha1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+static void CompressLevel(const unsigned char* rgba, int width, int height, bool alpha, std::vector<unsigned char>& out)
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t blockSize = alpha ? 16 : 8;
+    out.resize(blocksX * blocksY * blockSize);
+
+    auto encodeRows = [&](int firstRow, int lastRow)
+    {
+        unsigned char block[64];
+        for (int by = firstRow; by < lastRow; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                // clamp so the last blocks of levels smaller than 4x4 repeat their edge pixels
+                for (int y = 0; y < 4; y++)
+                {
+                    for (int x = 0; x < 4; x++)
+                    {
+                        int sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+                        std::copy_n(&rgba[(sy * width + sx) * 4], 4, &block[(y * 4 + x) * 4]);
+                    }
+                }
+
+                unsigned char* dst = &out[(by * blocksX + bx) * blockSize];
+                if (alpha)
+                {
+                    EncodeAlphaBlock(block, dst);
+                    dst += 8;
+                }
+                EncodeColorBlock(block, dst);
+            }
+        }
+    };
+
+    int threadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, blocksY);
+    std::vector<std::thread> workers;
+    int rowsPerThread = (blocksY + threadCount - 1) / threadCount;
+    for (int t = 0; t < threadCount; t++)
+    {
+        int firstRow = t * rowsPerThread;
+        int lastRow = std::min(firstRow + rowsPerThread, blocksY);
+        if (firstRow < lastRow)
+            workers.emplace_back(encodeRows, firstRow, lastRow);
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+CompressedImage CompressImage(const unsigned char* pixels, int width, int height, int channels, bool alpha)
+{
+    CompressedImage image;
+    image.format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    image.width = width;
+    image.height = height;
+
+    // expand to RGBA8 so the encoder and mip filter only deal with one layout
+    std::vector<unsigned char> level((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const unsigned char* src = &pixels[i * channels];
+        unsigned char* dst = &level[i * 4];
+        dst[0] = src[0];
+        dst[1] = channels >= 3 ? src[1] : src[0];
+        dst[2] = channels >= 3 ? src[2] : src[0];
+        dst[3] = channels == 4 ? src[3] : (channels == 2 ? src[1] : 255);
+    }
+
+    int w = width, h = height;
+    while (true)
+    {
+        image.mips.emplace_back();
+        CompressLevel(level.data(), w, h, alpha, image.mips.back());
+        if (w == 1 && h == 1)
+            break;
+
+        // 2x2 box filter down to the next level
+        int nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+        std::vector<unsigned char> next((size_t)nw * nh * 4);
+        for (int y = 0; y < nh; y++)
+        {
+            for (int x = 0; x < nw; x++)
+            {
+                int x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+                int y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+                for (int c = 0; c < 4; c++)
+                {
+                    int sum = level[(y0 * w + x0) * 4 + c] + level[(y0 * w + x1) * 4 + c]
+                        + level[(y1 * w + x0) * 4 + c] + level[(y1 * w + x1) * 4 + c];
+                    next[(y * nw + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+        w = nw;
+        h = nh;
+    }
+    return image;
+}
+
+bool IsCookedTexturePath(const std::string& path)
+{
+    return std::filesystem::path(path).extension() == ".btex";
+}
+
+std::vector<unsigned char> SerializeCompressedImage(const CompressedImage& image)
+{
+    unsigned int header[6] = { CookedMagic, CookedVersion, image.format, (unsigned int)image.width,
+        (unsigned int)image.height, (unsigned int)image.mips.size() };
+
+    std::vector<unsigned char> data((const unsigned char*)header, (const unsigned char*)header + sizeof(header));
+    for (const std::vector<unsigned char>& mip : image.mips)
+    {
+        unsigned int size = (unsigned int)mip.size();
+        data.insert(data.end(), (const unsigned char*)&size, (const unsigned char*)&size + sizeof(size));
+        data.insert(data.end(), mip.begin(), mip.end());
+    }
+    return data;
+}
+
+bool ParseCompressedImage(const unsigned char* data, size_t size, CompressedImage& image)
+{
+    unsigned int header[6];
+    if (size < sizeof(header))
+        return false;
+    memcpy(header, data, sizeof(header));
+    if (header[0] != CookedMagic || header[1] != CookedVersion)
+        return false;
+
+    // the header comes from a file, so nothing is allocated before it's checked against the image and the bytes left
+    size_t blockBytes = header[2] == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : header[2] == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT ? 16 : 0;
+    if (blockBytes == 0 || header[3] == 0 || header[4] == 0 || header[3] > INT_MAX || header[4] > INT_MAX)
+        return false;
+    int width = (int)header[3], height = (int)header[4];
+    if (header[5] == 0 || header[5] > (unsigned int)GetMipLevelCount(width, height))
+        return false;
+
+    std::vector<std::vector<unsigned char>> mips(header[5]);
+    size_t offset = sizeof(header);
+    int w = width, h = height;
+    for (std::vector<unsigned char>& mip : mips)
+    {
+        unsigned int mipSize = 0;
+        if (size - offset < sizeof(mipSize))
+            return false;
+        memcpy(&mipSize, data + offset, sizeof(mipSize));
+        offset += sizeof(mipSize);
+        // every level is exactly its 4x4 blocks
+        if (mipSize != (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes || size - offset < mipSize)
+            return false;
+        mip.assign(data + offset, data + offset + mipSize);
+        offset += mipSize;
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+
+    image.format = header[2];
+    image.width = width;
+    image.height = height;
+    image.mips = std::move(mips);
+    return true;
+}
+
+bool WriteCompressedImage(const std::string& path, const CompressedImage& image)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> data = SerializeCompressedImage(image);
+    file.write((const char*)data.data(), data.size());
+    return (bool)file;
+}
+
+bool ReadCompressedImage(const std::string& path, CompressedImage& image)
+{
+    MappedFile file;
+    return file.Open(path) && ParseCompressedImage(file.GetData(), file.GetSize(), image);
+}
+
+bool CookTexture(const std::string& sourcePath, AssetCache& cache, CompressedImage& image)
+{
+    std::string key = cache.GetKey(sourcePath, "bc-v" + std::to_string(CookedVersion));
+
+    // warm start, the cooked image is read straight out of the mapped cache entry
+    MappedFile cached;
+    if (cache.Load(key, cached) && ParseCompressedImage(cached.GetData(), cached.GetSize(), image))
+        return true;
+
+    int width, height, nrChannels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load(sourcePath.c_str(), &width, &height, &nrChannels, 0);
+    if (!data)
+    {
+        std::cout << "Failed to load texture " << sourcePath << std::endl;
+        return false;
+    }
+
+    // grayscale+alpha and RGBA need the BC3 alpha block, everything else fits BC1
+    image = CompressImage(data, width, height, nrChannels, nrChannels == 2 || nrChannels == 4);
+    stbi_image_free(data);
+
+    std::vector<unsigned char> serialized = SerializeCompressedImage(image);
+    if (!cache.Store(key, serialized.data(), serialized.size()))
+        std::cout << "Failed to cache cooked texture " << sourcePath << std::endl;
+    return true;
+}
+
+void ReportCompressedImage(const std::string& name, const CompressedImage& image)
+{
+    size_t compressed = image.GetCompressedSize();
+    size_t uncompressed = image.GetUncompressedSize();
+    std::cout << name << ": " << (image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? "BC1 " : "BC3 ")
+        << compressed / 1024 << " KB, " << uncompressed / 1024 << " KB uncompressed, saved "
+        << (uncompressed - compressed) / 1024 << " KB" << std::endl;
+}
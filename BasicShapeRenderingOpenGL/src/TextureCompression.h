@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class AssetCache;
+
+// Block compressed image with its full mip chain, as stored in a cooked .btex file
+struct CompressedImage
+{
+	unsigned int format = 0;	// GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+	int width = 0;
+	int height = 0;
+	std::vector<std::vector<unsigned char>> mips;
+
+	size_t GetCompressedSize() const;
+	// size the same chain takes as uncompressed RGBA8, which is what drivers store RGB8 as
+	size_t GetUncompressedSize() const;
+};
+
+// Encodes RGBA8 pixels into BC1 (no alpha) or BC3 and builds the mip chain on the way.
+// Blocks of every level are split across worker threads.
+CompressedImage CompressImage(const unsigned char* pixels, int width, int height, int channels, bool alpha);
+
+// .btex container, SerializeCompressedImage gives the exact file contents
+bool IsCookedTexturePath(const std::string& path);
+std::vector<unsigned char> SerializeCompressedImage(const CompressedImage& image);
+bool ParseCompressedImage(const unsigned char* data, size_t size, CompressedImage& image);
+bool WriteCompressedImage(const std::string& path, const CompressedImage& image);
+bool ReadCompressedImage(const std::string& path, CompressedImage& image);
+
+// Cook step: decodes the source image and compresses it, unless the asset cache already
+// holds the result for the same source contents. Returns false on failure.
+bool CookTexture(const std::string& sourcePath, AssetCache& cache, CompressedImage& image);
+
+void ReportCompressedImage(const std::string& name, const CompressedImage& image);
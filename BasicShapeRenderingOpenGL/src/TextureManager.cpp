@@ -0,0 +1,170 @@
+#include "TextureManager.h"
+
+#include <iostream>
+
+TextureManager::TextureManager(size_t budgetBytes)
+    : mBudget(budgetBytes)
+{
+}
+
+TextureManager::~TextureManager()
+{
+    for (Entry& entry : mEntries)
+        Unload(entry);
+}
+
+TextureHandle TextureManager::Acquire(const std::string& texturePath, bool srgb)
+{
+    std::string key = texturePath + (srgb ? "|srgb" : "|linear");
+    auto found = mHandlesByKey.find(key);
+    if (found != mHandlesByKey.end())
+    {
+        mEntries[found->second - 1].refCount++;
+        return found->second;
+    }
+
+    TextureHandle handle;
+    if (!mFreeHandles.empty())
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else
+    {
+        mEntries.emplace_back();
+        handle = (TextureHandle)mEntries.size();
+    }
+
+    Entry& entry = mEntries[handle - 1];
+    entry.path = texturePath;
+    entry.srgb = srgb;
+    entry.refCount = 1;
+    entry.mipBias = 0;
+    mHandlesByKey[key] = handle;
+    return handle;
+}
+
+void TextureManager::Release(TextureHandle handle)
+{
+    Entry& entry = mEntries[handle - 1];
+    if (entry.refCount == 0 || --entry.refCount > 0)
+        return;
+
+    Unload(entry);
+    mHandlesByKey.erase(entry.path + (entry.srgb ? "|srgb" : "|linear"));
+    entry.path.clear();
+    mFreeHandles.push_back(handle);
+}
+
+Texture* TextureManager::Get(TextureHandle handle)
+{
+    Entry& entry = mEntries[handle - 1];
+    entry.lastUsedFrame = mFrame;
+
+    if (entry.texture)
+    {
+        mStats.hits++;
+        mLru.splice(mLru.begin(), mLru, entry.lruPosition);
+        return entry.texture.get();
+    }
+
+    mStats.misses++;
+    Load(entry);
+    mLru.push_front(handle);
+    entry.lruPosition = mLru.begin();
+    // only textures nobody can be holding this frame are freed here, anything else waits for BeginFrame
+    EnforceBudget(false);
+    return entry.texture.get();
+}
+
+void TextureManager::Bind(TextureHandle handle, unsigned int slot)
+{
+    Get(handle)->Bind(slot);
+}
+
+void TextureManager::BeginFrame()
+{
+    // the pointers handed out last frame are dead, so its textures can be replaced now
+    unsigned int mipDrops = mStats.mipDrops;
+    EnforceBudget(true);
+    if (mStats.mipDrops == mipDrops)
+        RestoreMip();
+    mFrame++;
+}
+
+void TextureManager::SetBudget(size_t budgetBytes)
+{
+    mBudget = budgetBytes;
+    EnforceBudget(false);
+}
+
+void TextureManager::Load(Entry& entry)
+{
+    entry.texture = std::make_unique<Texture>(entry.path, entry.srgb, entry.mipBias);
+    mResidentBytes += entry.texture->GetMemorySize();
+}
+
+void TextureManager::Unload(Entry& entry)
+{
+    if (!entry.texture)
+        return;
+
+    mResidentBytes -= entry.texture->GetMemorySize();
+    entry.texture.reset();
+    mLru.erase(entry.lruPosition);
+}
+
+void TextureManager::EnforceBudget(bool dropMips)
+{
+    while (mResidentBytes > mBudget)
+    {
+        // least recently used texture that wasn't touched this frame
+        if (!mLru.empty() && mEntries[mLru.back() - 1].lastUsedFrame < mFrame)
+        {
+            Unload(mEntries[mLru.back() - 1]);
+            mStats.evictions++;
+            continue;
+        }
+        if (!dropMips)
+            return;
+
+        // everything resident is needed, shrink the largest one by a mip instead
+        Entry* largest = NULL;
+        for (TextureHandle handle : mLru)
+        {
+            Entry& entry = mEntries[handle - 1];
+            if (entry.texture->GetWidth() <= 1 && entry.texture->GetHeight() <= 1)
+                continue;
+            if (!largest || entry.texture->GetMemorySize() > largest->texture->GetMemorySize())
+                largest = &entry;
+        }
+        if (!largest)
+        {
+            std::cout << "TextureManager: budget of " << mBudget << " bytes can't be met" << std::endl;
+            return;
+        }
+
+        mResidentBytes -= largest->texture->GetMemorySize();
+        largest->mipBias++;
+        Load(*largest);
+        mStats.mipDrops++;
+    }
+}
+
+void TextureManager::RestoreMip()
+{
+    // the most recently used downsized texture whose next level up fits, which is about 4x its size
+    for (TextureHandle handle : mLru)
+    {
+        Entry& entry = mEntries[handle - 1];
+        size_t size = entry.texture->GetMemorySize();
+        if (entry.mipBias == 0 || mResidentBytes - size + size * 4 > mBudget)
+            continue;
+
+        mResidentBytes -= size;
+        entry.mipBias--;
+        Load(entry);
+        mStats.mipRestores++;
+        return;
+    }
+}
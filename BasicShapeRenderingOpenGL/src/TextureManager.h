@@ -0,0 +1,78 @@
+#pragma once
+#include "Texture.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef unsigned int TextureHandle;
+
+struct TextureManagerStats
+{
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+	unsigned int evictions = 0;
+	unsigned int mipDrops = 0;
+	unsigned int mipRestores = 0;
+};
+
+// Reference counted texture cache that keeps the estimated VRAM of resident textures under
+// a budget. Least recently used textures are evicted first, when everything left is in use
+// this frame the budget is overrun until BeginFrame, which drops the top mip of the largest
+// texture of the frame that ended. Dropped mips come back one texture per frame once they fit
+// again. Evicted textures reload on next use.
+class TextureManager
+{
+public:
+	TextureManager(size_t budgetBytes);
+	~TextureManager();
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// the same path/srgb pair shares one handle, every Acquire needs a matching Release
+	TextureHandle Acquire(const std::string& texturePath, bool srgb = true);
+	void Release(TextureHandle handle);
+
+	// marks the texture as used, loading it when it isn't resident; the pointer stays valid until the next BeginFrame
+	Texture* Get(TextureHandle handle);
+	void Bind(TextureHandle handle, unsigned int slot);
+
+	// textures used since the last BeginFrame are never evicted, they're only downsized or restored here
+	void BeginFrame();
+
+	void SetBudget(size_t budgetBytes);
+	size_t GetBudget() const { return mBudget; }
+	size_t GetResidentBytes() const { return mResidentBytes; }
+	const TextureManagerStats& GetStats() const { return mStats; }
+	void ResetStats() { mStats = TextureManagerStats(); }
+
+private:
+	struct Entry
+	{
+		std::string path;
+		bool srgb = true;
+		unsigned int refCount = 0;
+		int mipBias = 0;
+		unsigned long long lastUsedFrame = 0;
+		std::unique_ptr<Texture> texture;
+		std::list<TextureHandle>::iterator lruPosition;
+	};
+
+	void Load(Entry& entry);
+	void Unload(Entry& entry);
+	// evicts textures not used this frame, dropMips then shrinks the ones that were
+	void EnforceBudget(bool dropMips);
+	void RestoreMip();
+
+	size_t mBudget;
+	size_t mResidentBytes = 0;
+	unsigned long long mFrame = 1;
+	TextureManagerStats mStats;
+
+	std::vector<Entry> mEntries;	// indexed by handle - 1, slots are reused after release
+	std::vector<TextureHandle> mFreeHandles;
+	std::unordered_map<std::string, TextureHandle> mHandlesByKey;
+	std::list<TextureHandle> mLru;	// resident textures, most recently used at the front
+};
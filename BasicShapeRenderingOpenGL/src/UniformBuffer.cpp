@@ -0,0 +1,92 @@
+#include "UniformBuffer.h"
+#include "RenderDevice.h"
+
+#include <glad/glad.h>
+#include <cstring>
+
+int GetUniformBlockBinding(const std::string& blockName)
+{
+    if (blockName == "FrameData")
+        return UniformBindingFrame;
+    if (blockName == "DrawData")
+        return UniformBindingDraw;
+    return -1;
+}
+
+UniformBuffer::UniformBuffer(size_t size)
+    : mSize(size)
+{
+    mUniformBuffer = GetRenderDevice().GenBuffer();
+    GetRenderDevice().BindBuffer(GL_UNIFORM_BUFFER, mUniformBuffer);
+    GetRenderDevice().BufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    GetRenderDevice().BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    DeleteUniformBuffer();
+}
+
+void UniformBuffer::Update(const void* data, size_t size, size_t offset)
+{
+    GetRenderDevice().BindBuffer(GL_UNIFORM_BUFFER, mUniformBuffer);
+    GetRenderDevice().BufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
+
+void UniformBuffer::BindBase(unsigned int binding)
+{
+    GetRenderDevice().BindBufferBase(GL_UNIFORM_BUFFER, binding, mUniformBuffer);
+}
+
+void UniformBuffer::BindRange(unsigned int binding, size_t offset, size_t size)
+{
+    GetRenderDevice().BindBufferRange(GL_UNIFORM_BUFFER, binding, mUniformBuffer, offset, size);
+}
+
+void UniformBuffer::DeleteUniformBuffer()
+{
+    GetRenderDevice().DeleteBuffer(mUniformBuffer);
+}
+
+UniformRingBuffer::UniformRingBuffer(size_t bytesPerFrame, unsigned int framesInFlight)
+    : mBuffer(bytesPerFrame * framesInFlight), mStaging(bytesPerFrame), mBytesPerFrame(bytesPerFrame), mFramesInFlight(framesInFlight)
+{
+    int alignment = 0;
+    GetRenderDevice().GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0)
+        mAlignment = (size_t)alignment;
+}
+
+void UniformRingBuffer::BeginFrame()
+{
+    mFrame = (mFrame + 1) % mFramesInFlight;
+    mUsed = 0;
+    mFlushed = 0;
+}
+
+long long UniformRingBuffer::Allocate(const void* data, size_t size)
+{
+    size_t offset = (mUsed + mAlignment - 1) / mAlignment * mAlignment;
+    if (offset + size > mBytesPerFrame)
+        return -1;
+
+    memcpy(&mStaging[offset], data, size);
+    mUsed = offset + size;
+    return (long long)(mFrame * mBytesPerFrame + offset);
+}
+
+void UniformRingBuffer::Flush()
+{
+    if (mUsed == mFlushed)
+        return;
+
+    // only the part written since the last flush goes up
+    mBuffer.Update(&mStaging[mFlushed], mUsed - mFlushed, mFrame * mBytesPerFrame + mFlushed);
+    mFlushed = mUsed;
+    mUploadCount++;
+}
+
+void UniformRingBuffer::Bind(unsigned int binding, long long offset, size_t size)
+{
+    mBuffer.BindRange(binding, (size_t)offset, size);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// Fixed binding points, Shader binds blocks with these names when it reflects a program
+enum UniformBinding : unsigned int
+{
+	UniformBindingFrame = 0,	// FrameData
+	UniformBindingDraw = 1,		// DrawData
+};
+
+// returns -1 for block names without a fixed binding
+int GetUniformBlockBinding(const std::string& blockName);
+
+// std140 mirror of the FrameData block
+struct FrameUniforms
+{
+	glm::mat4 viewProjection;
+	float time;
+	float padding;
+	glm::vec2 viewportSize;	// std140 aligns the vec2 to 8 bytes, so it follows a padding float
+};
+
+// std140 mirror of the DrawData block
+struct DrawUniforms
+{
+	glm::mat4 model;
+	glm::vec4 color;
+	glm::vec2 layers;
+	float alphaCutoff;
+	float padding;
+};
+
+class UniformBuffer
+{
+public:
+	UniformBuffer(size_t size);
+	~UniformBuffer();
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	void Update(const void* data, size_t size, size_t offset = 0);
+	void BindBase(unsigned int binding);
+	void BindRange(unsigned int binding, size_t offset, size_t size);
+	void DeleteUniformBuffer();
+
+	unsigned int GetUniformBuffer() const { return mUniformBuffer; }
+	size_t GetSize() const { return mSize; }
+
+private:
+	unsigned int mUniformBuffer;
+	size_t mSize;
+};
+
+// One large UBO split into a segment per frame in flight. Blocks are suballocated on the CPU
+// at GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, uploaded with a single call per frame by Flush, and
+// each draw then only binds its range.
+class UniformRingBuffer
+{
+public:
+	UniformRingBuffer(size_t bytesPerFrame, unsigned int framesInFlight = 3);
+
+	// moves on to the next segment, the GPU may still read the ones before it
+	void BeginFrame();
+	// returns the offset to bind, or -1 when the segment is full
+	long long Allocate(const void* data, size_t size);
+	void Flush();
+	void Bind(unsigned int binding, long long offset, size_t size);
+
+	unsigned int GetUploadCount() const { return mUploadCount; }
+
+private:
+	UniformBuffer mBuffer;
+	std::vector<unsigned char> mStaging;
+	size_t mBytesPerFrame;
+	unsigned int mFramesInFlight;
+	unsigned int mFrame = 0;
+	size_t mAlignment = 256;
+	size_t mUsed = 0;
+	size_t mFlushed = 0;
+	unsigned int mUploadCount = 0;
+};
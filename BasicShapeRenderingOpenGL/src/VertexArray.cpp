@@ -1,9 +1,10 @@
 #include "VertexArray.h"
+#include "RenderDevice.h"
 #include <glad/glad.h>
 
 VertexArray::VertexArray()
 {
-	glGenVertexArrays(1, &mVertexArray);
+	mVertexArray = GetRenderDevice().GenVertexArray();
 }
 
 VertexArray::~VertexArray()
@@ -13,15 +14,15 @@ VertexArray::~VertexArray()
 
 void VertexArray::Bind()
 {
-	glBindVertexArray(mVertexArray);
+	GetRenderDevice().BindVertexArray(mVertexArray);
 }
 
 void VertexArray::Unbind()
 {
-	glBindVertexArray(0);
+	GetRenderDevice().BindVertexArray(0);
 }
 
 void VertexArray::DeleteVertexArray()
 {
-	glDeleteVertexArrays(1, &mVertexArray);
+	GetRenderDevice().DeleteVertexArray(mVertexArray);
 }
@@ -5,6 +5,8 @@ class VertexArray
 public:
 	VertexArray();
 	~VertexArray();
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
 	void Bind();
 	void Unbind();
 	void DeleteVertexArray();
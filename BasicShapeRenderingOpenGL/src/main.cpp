@@ -2,6 +2,31 @@
 #include "VertexArray.h"
 #include "Buffer.h"
 #include "Texture.h"
+#include "TextureArray.h"
+#include "GLExtensions.h"
+#include "TextureCompression.h"
+#include "AssetCache.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderVariants.h"
+#include "UniformBuffer.h"
+#include "FileWatcher.h"
+#include "FramePipeline.h"
+#include "FrameClock.h"
+#include "InputQueue.h"
+#include "SoftwareRasterizer.h"
+#include "RenderDevice.h"
+#include "FrameCapture.h"
+#include "RenderTarget.h"
+#include "ShapeRenderer.h"
+#include "PolylineRenderer.h"
+#include "ParticleSystem.h"
+#include "FontAtlas.h"
+#include "TextRenderer.h"
+#include "Picking.h"
+#include "Occlusion.h"
+#include "HiZ.h"
+#include "TextureManager.h"
 
 #include <glad/glad.h>
 #include "Camera.h"
@@ -12,11 +37,30 @@
 
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
+FrameInput processInput(GLFWwindow* window, FrameClock& frameClock);
+TextureLayer addTexture(TextureLibrary& textures, AssetCache& assetCache, const std::string& texturePath);
+void buildFrame(const FrameInput& input, InputState& inputState, const glm::vec2& layers, FramePacket& packet);
+bool applyShaderChanges(std::vector<FileChange>& changes, const char* vertexPath, const char* fragmentPath, std::string& vertexSource, std::string& fragmentSource);
+void setVertexAttributes(VertexBuffer& vertexBuffer, VertexBuffer& instanceBuffer);
+void submitFrame(const FramePacket& frame, Shader& shader, VertexArray& vertexArray, UniformBuffer& frameUniformBuffer, UniformRingBuffer& drawUniformBuffer,
+    OcclusionCuller& occlusionCuller, Shader& occlusionShader, ShapeRenderer& shapeRenderer, Shader& shapeShader, HiZCuller& hiZCuller, RenderTarget& sceneTarget);
+OcclusionBounds quadBounds(const glm::mat4& model);
+int runSoftwareRenderer(int argc, char** argv);
+int runSoftwareBenchmark();
+int runShaderBenchmark();
+int runNullDeviceBenchmark(int argc, char** argv);
 
 void checkOpenGLError(const char* stmt, const char* fname, int line) {
     GLenum err = glGetError();
@@ -48,57 +92,110 @@ const unsigned int SCR_HEIGHT = 600;
 
 Camera camera = Camera((float)SCR_WIDTH, (float)SCR_HEIGHT);
 
-// timing
-float deltaTime = 0.0f;	// time between current frame and last frame
-float lastFrame = 0.0f;
+// timing: the simulation runs at a fixed rate and rendering interpolates between its steps
+const double simulationStep = 1.0 / 120.0;
+// caps the frame rate with the frame clock's limiter, 0 leaves pacing to vsync
+const double frameLimit = 0.0;
 
-const char* vertexShaderSource = R"(
-    #version 330 core
-    layout (location = 0) in vec3 aPos;
-    layout (location = 1) in vec2 aTexCoord;
+// frame pipeline: update runs on a worker one frame ahead of submission, set false to compare against the serial loop
+const bool pipelineFrames = true;
+// disables vsync so the frame pipeline report shows throughput instead of the refresh rate
+const bool benchmarkFrames = false;
 
-    out vec4 vertexColor;
-    out vec2 TexCoord;
+// scene: a textured quad, drawn by the GL path and by the software rasterizer
+const std::vector<float> vertices = {
+    // Positions            // Texture Coords
+     0.5f,  0.5f, 0.0f,     1.0f, 1.0f,     // top right
+     0.5f, -0.5f, 0.0f,     1.0f, 0.0f,     // bottom right
+    -0.5f, -0.5f, 0.0f,     0.0f, 0.0f,     // bottom left
+    -0.5f,  0.5f, 0.0f,     0.0f, 1.0f      // top left 
+};
 
-    uniform mat4 model;
-    uniform mat4 view;
-    uniform mat4 projection;
+const std::vector<unsigned int> indices = {  // note that we start from 0!
+0, 1, 3,   // first triangle
+1, 2, 3    // second triangle
+};
 
-    void main()
-    {
-        gl_Position = projection * view * model * vec4(aPos, 1.0);
-        TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-    }
-)";
-
-const char* fragmentShaderSource = R"(
-    #version 330 core
+// reversed-Z infinite projection for depth precision, where glClipControl is available
+const bool reversedZ = true;
+// the scene renders offscreen with this many samples and is resolved and blitted to the window
+const int msaaSamples = 4;
 
-    out vec4 color;
+// kept up to date by framebuffer_size_callback, the scene target follows it at the start of the next frame
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
 
-    in vec2 TexCoord;
+// input events arrive on the GL thread during glfwPollEvents, they're handed to the camera with the next frame's input
+InputQueue inputQueue;
 
-    uniform vec4 ourColor;
+// capture: F12 saves a screenshot, F11 toggles writing every frame
+const char* captureDirectory = "Captures";
+const CaptureFormat captureFormat = CaptureFormatPNG;
+bool screenshotRequested = false;
+bool continuousCapture = false;
 
-    // texture samplers
-    uniform sampler2D texture1;
-    uniform sampler2D texture2;
+// shader templates, ShaderVariants adds the feature #defines (TEXTURED, INSTANCED, ...) after #version
+const char* vertexShaderPath = "Shaders/Basic.vert";
+const char* fragmentShaderPath = "Shaders/Basic.frag";
+// analytic SDF shapes, one instanced quad each
+const char* shapeVertexShaderPath = "Shaders/Shape.vert";
+const char* shapeFragmentShaderPath = "Shaders/Shape.frag";
+// antialiased polylines extruded in screen space from one instance per segment
+const char* polylineVertexShaderPath = "Shaders/Polyline.vert";
+const char* polylineFragmentShaderPath = "Shaders/Polyline.frag";
+// particles: simulated by transform feedback in ParticleUpdate.vert and drawn as instanced sprites
+const char* particleUpdateShaderPath = "Shaders/ParticleUpdate.vert";
+const char* particleVertexShaderPath = "Shaders/Particle.vert";
+const char* particleFragmentShaderPath = "Shaders/Particle.frag";
+// text: glyph quads from the signed distance field font atlas
+const char* textVertexShaderPath = "Shaders/Text.vert";
+const char* textFragmentShaderPath = "Shaders/Text.frag";
+// occlusion queries: bounding boxes drawn against the depth of the quads
+const char* occlusionVertexShaderPath = "Shaders/OcclusionBox.vert";
+const char* occlusionFragmentShaderPath = "Shaders/OcclusionBox.frag";
+// hierarchical Z: the depth pyramid's reduction, and the shape culling pass captured by transform feedback
+const char* hiZReduceVertexShaderPath = "Shaders/HiZReduce.vert";
+const char* hiZReduceFragmentShaderPath = "Shaders/HiZReduce.frag";
+const char* hiZCullVertexShaderPath = "Shaders/HiZCull.vert";
+const char* hiZCullGeometryShaderPath = "Shaders/HiZCull.geom";
 
+// polylines: a spiral uploaded once and a trail that grows by a point every frame, restarted once it has this many
+const size_t spiralPointCount = 100000;
+const size_t maxTrailPoints = 1 << 20;
+// particles of the fountain, simulated on the GPU unless this is set
+const size_t particleCount = 100000;
+const ParticleSimulation particleSimulation = ParticleSimulationGPU;
+// hidden quads are skipped on query results read back a frame or more later, or by the GPU with conditional rendering
+const OcclusionMode occlusionMode = OcclusionModeReadback;
 
-    void main()
-    {
-       color = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
-    }
-)";
+// picking: the shape under the crosshair (the window's center, the mouse is captured by the camera)
+const char* shapeTypeNames[ShapeTypeCount] = { "circle", "ellipse", "rounded rect", "line", "ring" };
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, GLFW_TRUE);
+	if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+		screenshotRequested = true;
+	if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+		continuousCapture = !continuousCapture;
+	inputQueue.PushKey(key, action);
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// headless: the same scene on the CPU rasterizer, no window or GPU needed
+	if (argc > 1 && strcmp(argv[1], "--software") == 0)
+		return runSoftwareRenderer(argc, argv);
+	if (argc > 1 && strcmp(argv[1], "--software-benchmark") == 0)
+		return runSoftwareBenchmark();
+	// startup cost of many programs, built one after the other and through the compile scheduler
+	if (argc > 1 && strcmp(argv[1], "--shader-benchmark") == 0)
+		return runShaderBenchmark();
+	// submission overhead on the recording device, no window or GPU needed either
+	if (argc > 1 && strcmp(argv[1], "--null-device") == 0)
+		return runNullDeviceBenchmark(argc, argv);
+
 	if (!glfwInit())
 	{
 		std::cout << "Failed to initialize glfw" << std::endl;
@@ -106,6 +203,7 @@ int main()
 
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
 	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Basic Shape OpenGL", NULL, NULL);
 	if (!window)
 	{
@@ -114,10 +212,19 @@ int main()
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	// adaptive vsync (late frames tear instead of waiting a whole refresh) where the driver has it,
+	// otherwise the frame clock switches vsync off while frames miss the refresh deadline
+	bool adaptiveVsync = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+	int swapInterval = benchmarkFrames ? 0 : (adaptiveVsync ? -1 : 1);
+	glfwSwapInterval(swapInterval);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetKeyCallback(window, key_callback);
 
-    // tell GLFW to capture our mouse
+    // tell GLFW to capture our mouse, unaccelerated when the platform can
+    if (glfwRawMouseMotionSupported())
+        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// glad: load all OpenGL function pointers
@@ -127,35 +234,91 @@ int main()
 		std::cout << "Failed to initialize GLAD" << std::endl;
 		return -1;
 	}
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
 
     // configure global opengl state
     // -----------------------------
-    //glEnable(GL_DEPTH_TEST);
+    // the depth test is switched on around the opaque quads and the shapes in submitFrame, the blended passes after them draw in order
+    if (reversedZ && glExtensions.ARB_clip_control)
+    {
+        // depth runs from 1 at the near plane to 0 at infinity, so the test and the clear value flip
+        glExtensions.ClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glClearDepth(0.0);
+        glDepthFunc(GL_GREATER);
+        camera.SetReversedZ(true);
+    }
+    // the framebuffer can be larger than the window on high dpi displays
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    camera.SetViewportSize((float)framebufferWidth, (float)framebufferHeight);
+    // textures are sampled as sRGB, so shading happens in linear space and is encoded on write
+    glEnable(GL_FRAMEBUFFER_SRGB);
 
-    // build and compile our shader program
-    // ------------------------------------
-    // vertex shader
-    Shader shader = Shader(vertexShaderSource, fragmentShaderSource);
+    // offscreen scene target: multisampled sRGB color and depth, resolved into a texture every frame
+    RenderTargetDesc sceneTargetDesc;
+    sceneTargetDesc.width = framebufferWidth;
+    sceneTargetDesc.height = framebufferHeight;
+    sceneTargetDesc.colorFormat = GL_SRGB8_ALPHA8;
+    sceneTargetDesc.depthFormat = GL_DEPTH_COMPONENT32F;
+    sceneTargetDesc.samples = msaaSamples;
+    RenderTarget sceneTarget = RenderTarget(sceneTargetDesc);
 
-    shader.Compile();
-    // link shaders
-    shader.Link();
+    AssetCache assetCache = AssetCache("AssetCache");
+    ProgramBinaryCache programCache = ProgramBinaryCache(assetCache);
+    ShaderCompiler shaderCompiler = ShaderCompiler();
 
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    std::vector<float> vertices = {
-        // Positions            // Texture Coords
-         0.5f,  0.5f, 0.0f,     1.0f, 1.0f,     // top right
-         0.5f, -0.5f, 0.0f,     1.0f, 0.0f,     // bottom right
-        -0.5f, -0.5f, 0.0f,     0.0f, 0.0f,     // bottom left
-        -0.5f,  0.5f, 0.0f,     0.0f, 1.0f      // top left 
-    };
+    // build and compile our shader program (or load the linked binary from the cache)
+    // -------------------------------------------------------------------------------
+    std::string vertexShaderSource, fragmentShaderSource, shapeVertexShaderSource, shapeFragmentShaderSource, polylineVertexShaderSource, polylineFragmentShaderSource;
+    std::string particleUpdateShaderSource, particleVertexShaderSource, particleFragmentShaderSource, textVertexShaderSource, textFragmentShaderSource;
+    std::string occlusionVertexShaderSource, occlusionFragmentShaderSource, hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource;
+    std::string hiZCullVertexShaderSource, hiZCullGeometryShaderSource;
+    if (!ReadTextFile(vertexShaderPath, vertexShaderSource) || !ReadTextFile(fragmentShaderPath, fragmentShaderSource)
+        || !ReadTextFile(shapeVertexShaderPath, shapeVertexShaderSource) || !ReadTextFile(shapeFragmentShaderPath, shapeFragmentShaderSource)
+        || !ReadTextFile(polylineVertexShaderPath, polylineVertexShaderSource) || !ReadTextFile(polylineFragmentShaderPath, polylineFragmentShaderSource)
+        || !ReadTextFile(particleUpdateShaderPath, particleUpdateShaderSource)
+        || !ReadTextFile(particleVertexShaderPath, particleVertexShaderSource) || !ReadTextFile(particleFragmentShaderPath, particleFragmentShaderSource)
+        || !ReadTextFile(textVertexShaderPath, textVertexShaderSource) || !ReadTextFile(textFragmentShaderPath, textFragmentShaderSource)
+        || !ReadTextFile(occlusionVertexShaderPath, occlusionVertexShaderSource) || !ReadTextFile(occlusionFragmentShaderPath, occlusionFragmentShaderSource)
+        || !ReadTextFile(hiZReduceVertexShaderPath, hiZReduceVertexShaderSource) || !ReadTextFile(hiZReduceFragmentShaderPath, hiZReduceFragmentShaderSource)
+        || !ReadTextFile(hiZCullVertexShaderPath, hiZCullVertexShaderSource) || !ReadTextFile(hiZCullGeometryShaderPath, hiZCullGeometryShaderSource))
+    {
+        std::cout << "Failed to read shader sources" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    ShaderVariants shaderVariants = ShaderVariants(vertexShaderSource, fragmentShaderSource, &programCache, &shaderCompiler);
+    ShaderVariants shapeShaderVariants = ShaderVariants(shapeVertexShaderSource, shapeFragmentShaderSource, &programCache, &shaderCompiler);
+    ShaderVariants polylineShaderVariants = ShaderVariants(polylineVertexShaderSource, polylineFragmentShaderSource, &programCache, &shaderCompiler);
+    ShaderVariants particleShaderVariants = ShaderVariants(particleVertexShaderSource, particleFragmentShaderSource, &programCache, &shaderCompiler);
+    ShaderVariants textShaderVariants = ShaderVariants(textVertexShaderSource, textFragmentShaderSource, &programCache, &shaderCompiler);
+    ShaderVariants occlusionShaderVariants = ShaderVariants(occlusionVertexShaderSource, occlusionFragmentShaderSource, &programCache, &shaderCompiler);
+    // edits to the shader files are rebuilt in the background and swapped in once they link
+    FileWatcher shaderWatcher = FileWatcher({ vertexShaderPath, fragmentShaderPath, shapeVertexShaderPath, shapeFragmentShaderPath,
+        polylineVertexShaderPath, polylineFragmentShaderPath, particleUpdateShaderPath, particleVertexShaderPath, particleFragmentShaderPath,
+        textVertexShaderPath, textFragmentShaderPath, occlusionVertexShaderPath, occlusionFragmentShaderPath,
+        hiZReduceVertexShaderPath, hiZReduceFragmentShaderPath, hiZCullVertexShaderPath, hiZCullGeometryShaderPath });
 
-    std::vector<unsigned int> indices = {  // note that we start from 0!
-    0, 1, 3,   // first triangle
-    1, 2, 3    // second triangle
-    };
+    // compile and link in the background, the textures below load while the driver works
+    Shader& shader = shaderVariants.Get(ShaderFeatureTextured | ShaderFeatureInstanced);
+    Shader& shapeShader = shapeShaderVariants.Get(0);
+    Shader& pickingShader = shapeShaderVariants.Get(ShaderFeaturePicking);
+    Shader& polylineShader = polylineShaderVariants.Get(0);
+    Shader& particleShader = particleShaderVariants.Get(0);
+    Shader& textShader = textShaderVariants.Get(0);
+    Shader& occlusionShader = occlusionShaderVariants.Get(0);
+
+    // load textures into size/format grouped texture arrays, cooked results come from the asset cache
+    // -----------------------------------------------------------------------------------------------
+    // Basic.frag samples a single sampler2DArray, so every texture has to share array 0
+    TextureLibrary textures = TextureLibrary(true, 1);
+    TextureLayer woodTiles = addTexture(textures, assetCache, "Assets/Wood_Tiles.jpg");
+    TextureLayer metalGrill = addTexture(textures, assetCache, "Assets/Metal_Grill.jpg");
+    textures.Build();
+    assetCache.SaveIndex();
+    std::cout << "Asset cache: " << assetCache.GetStats().hits << " hits, " << assetCache.GetStats().misses << " misses" << std::endl;
 
+    // set up vertex buffer(s) and configure vertex attributes
+    // -------------------------------------------------------
     VertexArray vertexArray = VertexArray();
     // bind the Vertex Array Object first, then bind and set vertex buffer(s), and then configure vertex attributes(s).
     vertexArray.Bind();
@@ -164,12 +327,10 @@ int main()
 
     IndexBuffer indexBuffer = IndexBuffer(indices);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    // per instance texture layers, both images are 1024x1024 sRGB (or BC1) so they share array 0; the library rejects any that don't
+    std::vector<float> instanceLayers = { (float)woodTiles.layer, (float)metalGrill.layer };
+    VertexBuffer instanceBuffer = VertexBuffer(instanceLayers);
+    setVertexAttributes(vertexBuffer, instanceBuffer);
 
     vertexBuffer.Unbind();
 
@@ -177,84 +338,277 @@ int main()
     // VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
     vertexArray.Unbind();
 
-    // load and create a textures
-    std::string texturePath = "Assets/Wood_Tiles.jpg";
-    Texture texture1 = Texture(texturePath);
-    std::string texture2Path = "Assets/Metal_Grill.jpg";
-    Texture texture2 = Texture(texture2Path);
+    // boxes of the quads, queried against the depth every frame
+    OcclusionCuller occlusionCuller = OcclusionCuller(occlusionMode);
+
+    // instance buffer of the SDF shapes, refilled every frame
+    ShapeRenderer shapeRenderer = ShapeRenderer();
+    // shapes behind the quads are culled against a depth pyramid, the GPU writes the visible count into the draw where it can
+    HiZDrawMode hiZDrawMode = glExtensions.ARB_draw_indirect && glExtensions.ARB_query_buffer_object ? HiZDrawIndirect : HiZDrawReadback;
+    HiZCuller hiZCuller = HiZCuller(hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource, hiZCullVertexShaderSource, hiZCullGeometryShaderSource,
+        hiZDrawMode, camera.IsReversedZ());
+
+    // polylines, the spiral's width and color change along it
+    std::vector<PolylinePoint> spiralPoints(spiralPointCount);
+    for (size_t i = 0; i < spiralPointCount; i++)
+    {
+        float t = (float)i / (spiralPointCount - 1);
+        float angle = t * 40.0f * 6.2831853f;
+        glm::vec3 position = glm::vec3(cos(angle), sin(angle), 0.0f) * (0.1f + 1.1f * t) + glm::vec3(0.0f, 0.0f, -1.5f);
+        spiralPoints[i] = PolylinePoint(position, 0.5f + 3.5f * t, glm::vec4(t, 0.3f, 1.0f - t, 1.0f));
+    }
+    Polyline spiral = Polyline(spiralPointCount + 2);
+    spiral.SetPoints(spiralPoints);
+    Polyline trail = Polyline();
+    PolylineRenderer polylineRenderer = PolylineRenderer();
+
+    // a fountain of particles, they never leave the GPU
+    ParticleEmitter emitter;
+    emitter.position = glm::vec3(0.0f, -0.8f, -1.2f);
+    emitter.spread = 0.25f;
+    emitter.minSpeed = 1.5f;
+    emitter.maxSpeed = 2.5f;
+    emitter.minLifetime = 1.0f;
+    emitter.maxLifetime = 2.5f;
+    emitter.gravity = glm::vec3(0.0f, -2.5f, 0.0f);
+    emitter.drag = 0.3f;
+    emitter.spriteSize = 4.0f;
+    ParticleSystem particles = ParticleSystem(particleCount, emitter, particleUpdateShaderSource, particleSimulation);
 
-    // tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
-    // -------------------------------------------------------------------------------------------
+    // text: the font atlas is rasterized on the first run and mapped from the asset cache after that
+    FontAtlas font = FontAtlas(&assetCache);
+    assetCache.SaveIndex();
+    TextBatch text = TextBatch(font);
+    TextRenderer textRenderer = TextRenderer();
+
+    // picking: ids read back from the GPU a frame later, and a ray cast against a BVH of the shapes for comparison
+    GpuPicker gpuPicker = GpuPicker();
+    ShapeBvh shapeBvh = ShapeBvh();
+
+    // tell opengl where the texture array lives (only has to be done once)
+    // ---------------------------------------------------------------------
+    shapeShader.UseProgram();
+    pickingShader.UseProgram();
+    polylineShader.UseProgram();
+    particleShader.UseProgram();
+    textShader.UseProgram();
+    occlusionShader.UseProgram();
     shader.UseProgram(); // don't forget to activate/use the shader before setting uniforms!
-    // either set it manually like so:
-    glUniform1i(glGetUniformLocation(shader.GetShaderProgram(), "texture1"), 0);
-    // or set it via the texture class
-    shader.SetUniformInt("texture2", 1);
+    // the first use finishes the link, so nothing is pending anymore past this point
+    shaderCompiler.Poll();
+    shaderCompiler.Report();
+    programCache.Report();
+    shaderVariants.Report();
+    shapeShaderVariants.Report();
+    polylineShaderVariants.Report();
+    particleShaderVariants.Report();
+    textShaderVariants.Report();
+    occlusionShaderVariants.Report();
+    // with bindless textures the handle is stored in the sampler and nothing needs binding per frame
+    bool bindlessTextures = glExtensions.ARB_bindless_texture && textures.GetArrayCount() > 0;
+    if (bindlessTextures)
+        shader.SetUniformHandle("textures", textures.GetArray(0).MakeResident());
+    else
+        shader.SetUniformInt("textures", 0);
 
+    // uniform buffers: per frame data bound once for every program, per draw data suballocated from a ring
+    // ----------------------------------------------------------------------------------------------------
+    UniformBuffer frameUniformBuffer = UniformBuffer(sizeof(FrameUniforms));
+    frameUniformBuffer.BindBase(UniformBindingFrame);
+    UniformRingBuffer drawUniformBuffer = UniformRingBuffer(64 * 1024);
+
+    // frame update: camera and per draw data, built on the pipeline worker without any GL calls
+    // -----------------------------------------------------------------------------------------
+    InputState inputState = InputState();
+    FramePipeline framePipeline = FramePipeline([&](const FrameInput& input, FramePacket& packet)
+    {
+        buildFrame(input, inputState, glm::vec2((float)woodTiles.layer, (float)metalGrill.layer), packet);
+    }, pipelineFrames);
 
     // uncomment this call to draw in wireframe polygons.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    // frame pacing
+    // ------------
+    FrameClock frameClock = FrameClock(simulationStep);
+    frameClock.SetAdaptiveVsyncSupported(adaptiveVsync);
+    frameClock.SetFrameLimit(frameLimit);
+    const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (frameLimit == 0.0 && videoMode && videoMode->refreshRate > 0)
+        frameClock.SetFrameDeadline(1.0 / videoMode->refreshRate);
+    InputLatency inputLatency = InputLatency();
+    FrameCapture frameCapture = FrameCapture(captureDirectory, captureFormat);
+
+    // the first frame is built before the loop, from then on the next one builds while the current one submits
+    framePipeline.BeginFrame(processInput(window, frameClock));
+
 	while (!glfwWindowShouldClose(window))
 	{
-        // per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-        // input
-        // -----
-        processInput(window);
+        FramePacket& frame = framePipeline.AcquireFrame();
+
+        // input: poll IO events (keys pressed/released, mouse moved etc.) and start building the next frame
+        // -------------------------------------------------------------------------------------------------
+        glfwPollEvents();
+        framePipeline.BeginFrame(processInput(window, frameClock));
+
+        // shader hot reload
+        // -----------------
+        std::vector<FileChange> shaderChanges = shaderWatcher.PollChanges();
+        if (applyShaderChanges(shaderChanges, vertexShaderPath, fragmentShaderPath, vertexShaderSource, fragmentShaderSource))
+            shaderVariants.Reload(vertexShaderSource, fragmentShaderSource);
+        if (applyShaderChanges(shaderChanges, shapeVertexShaderPath, shapeFragmentShaderPath, shapeVertexShaderSource, shapeFragmentShaderSource))
+            shapeShaderVariants.Reload(shapeVertexShaderSource, shapeFragmentShaderSource);
+        if (applyShaderChanges(shaderChanges, polylineVertexShaderPath, polylineFragmentShaderPath, polylineVertexShaderSource, polylineFragmentShaderSource))
+            polylineShaderVariants.Reload(polylineVertexShaderSource, polylineFragmentShaderSource);
+        if (applyShaderChanges(shaderChanges, particleVertexShaderPath, particleFragmentShaderPath, particleVertexShaderSource, particleFragmentShaderSource))
+            particleShaderVariants.Reload(particleVertexShaderSource, particleFragmentShaderSource);
+        if (applyShaderChanges(shaderChanges, textVertexShaderPath, textFragmentShaderPath, textVertexShaderSource, textFragmentShaderSource))
+            textShaderVariants.Reload(textVertexShaderSource, textFragmentShaderSource);
+        if (applyShaderChanges(shaderChanges, occlusionVertexShaderPath, occlusionFragmentShaderPath, occlusionVertexShaderSource, occlusionFragmentShaderSource))
+            occlusionShaderVariants.Reload(occlusionVertexShaderSource, occlusionFragmentShaderSource);
+        // the particle update is a lone vertex shader, the particle system rebuilds it with its varyings
+        for (FileChange& change : shaderChanges)
+        {
+            if (change.path != particleUpdateShaderPath)
+                continue;
+            particleUpdateShaderSource = change.contents;
+            particles.Reload(particleUpdateShaderSource);
+        }
+        // the Hi-Z culler owns its programs, both are rebuilt when any of their four files changed
+        bool hiZReduceChanged = applyShaderChanges(shaderChanges, hiZReduceVertexShaderPath, hiZReduceFragmentShaderPath, hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource);
+        bool hiZCullChanged = applyShaderChanges(shaderChanges, hiZCullVertexShaderPath, hiZCullGeometryShaderPath, hiZCullVertexShaderSource, hiZCullGeometryShaderSource);
+        if (hiZReduceChanged || hiZCullChanged)
+            hiZCuller.Reload(hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource, hiZCullVertexShaderSource, hiZCullGeometryShaderSource);
+        shaderVariants.Update();
+        shapeShaderVariants.Update();
+        polylineShaderVariants.Update();
+        particleShaderVariants.Update();
+        textShaderVariants.Update();
+        occlusionShaderVariants.Update();
+        hiZCuller.Update();
 
         // render
         // ------
-        glClearColor(0.2f, 0.1f, 0.8f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // bind textures on corresponding texture units
-        /*texture.Bind(0);
-        texture2.Bind(1);*/
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture1.GetTextureID());
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, texture2.GetTextureID());
-
-        // Activate Progarm
-        shader.UseProgram();
+        sceneTarget.Resize(framebufferWidth, framebufferHeight);
+        sceneTarget.Bind();
+
+        // bind the texture arrays, every instance picks its layers so draws aren't split by texture
+        if (!bindlessTextures)
+            textures.Bind(0);
+
+        submitFrame(frame, shader, vertexArray, frameUniformBuffer, drawUniformBuffer, occlusionCuller, occlusionShader, shapeRenderer, shapeShader, hiZCuller, sceneTarget);
+
+        // the trail only uploads the point it gained, the spiral nothing after the first frame
+        if (trail.GetPointCount() >= maxTrailPoints)
+            trail.Clear();
+        float trailTime = (float)frame.input.time;
+        glm::vec3 trailPosition = glm::vec3(0.9f * sin(1.3f * trailTime), 0.6f * sin(1.7f * trailTime), -0.9f);
+        trail.Append(PolylinePoint(trailPosition, 3.0f, glm::vec4(1.0f, 0.8f, 0.1f, 1.0f)));
+        polylineRenderer.Draw({ &spiral, &trail }, polylineShader);
+
+        // the particles advance by the fixed steps of this frame, drawn from the buffer the update just wrote
+        particles.Update((float)(frame.input.steps * frame.input.stepSeconds));
+        particles.Draw(particleShader);
 
-        // pass projection matrix to shader (note that in this case it could change every frame)
-        shader.SetUniformMat4("projection", camera.GetCameraProjection());
+        // the GPU's pick from an earlier frame, and the BVH's for this one
+        int pickX = sceneTarget.GetWidth() / 2;
+        int pickY = sceneTarget.GetHeight() / 2;
+        gpuPicker.Poll();
+        shapeBvh.Build(frame.shapes.GetShapes());
+        PickRay pickRay = MakePickRay(frame.frameUniforms.viewProjection, pickX, pickY, glm::vec2((float)sceneTarget.GetWidth(), (float)sceneTarget.GetHeight()));
+        // the quads are all the depth there is, the nearest one they hit hides the shapes behind it like the depth test does
+        float occluderDistance = INFINITY;
+        for (const DrawUniforms& draw : frame.draws)
+            occluderDistance = std::min(occluderDistance, IntersectMesh(pickRay, vertices, 5, indices, draw.model));
+        int bvhPick = shapeBvh.Pick(pickRay, occluderDistance);
+        int gpuPick = gpuPicker.GetPickedShape();
+        const std::vector<ShapeInstance>& shapes = frame.shapes.GetShapes();
+        const char* gpuPickName = gpuPick >= 0 && gpuPick < (int)shapes.size() ? shapeTypeNames[shapes[gpuPick].type] : "nothing";
+        const char* bvhPickName = bvhPick >= 0 ? shapeTypeNames[shapes[bvhPick].type] : "nothing";
 
-        // camera/view transformation
-        shader.SetUniformMat4("view", camera.GetCameraView());
+        // labels on the shapes and the stats in the corner, one draw each
+        text.Clear();
+        text.AddText("circle", TextSpaceWorld, glm::vec3(-0.8f, 0.35f, -1.0f), 16.0f, glm::vec4(1.0f), TextAlignCenter);
+        text.AddText("ellipse", TextSpaceWorld, glm::vec3(0.8f, 0.4f, -1.0f), 16.0f, glm::vec4(1.0f), TextAlignCenter);
+        text.AddText("rounded rect", TextSpaceWorld, glm::vec3(-0.8f, -0.72f, -1.0f), 16.0f, glm::vec4(1.0f), TextAlignCenter);
+        text.AddText("line", TextSpaceWorld, glm::vec3(0.8f, -0.72f, -1.0f), 16.0f, glm::vec4(1.0f), TextAlignCenter);
+        char stats[512];
+        snprintf(stats, sizeof(stats), "%.2f ms\n%u steps\n%zu of %zu quads occluded\n%zu shapes, %zu of %zu culled by Hi-Z\n%zu polyline points\n%zu particles\nGPU pick: %s (%llu frames old)\nBVH pick: %s",
+            frameClock.GetFrameSeconds() * 1000.0, frame.input.steps, occlusionCuller.GetCulledCount(), frame.draws.size(), frame.shapes.GetShapeCount(),
+            hiZCuller.GetCulledCount(), hiZCuller.GetShapeCount(),
+            spiral.GetPointCount() + trail.GetPointCount(), particles.GetCount(), gpuPickName, gpuPicker.GetLatency(), bvhPickName);
+        text.AddText(stats, TextSpaceScreen, glm::vec3(8.0f, 8.0f, 0.0f), 18.0f, glm::vec4(1.0f, 1.0f, 0.6f, 1.0f));
+        textRenderer.Draw(text, font, textShader);
+        sceneTarget.Resolve();
 
-        // update the uniform color
-        float timeValue = glfwGetTime();
-        float greenValue = sin(timeValue) / 2.0f + 0.5f;
-        shader.SetUniformFloat4("ourColor", { 0.0f, greenValue, 0.0f, 1.0f });
+        // the shape ids under the crosshair into the picker's own target, depth tested against the scene's, read back without waiting
+        gpuPicker.Pick(shapeRenderer, pickingShader, sceneTarget, pickX, pickY);
 
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f));
-        model = glm::rotate(model, glm::radians(0.0f), glm::vec3(1.0f, 0.3f, 0.5f));
-        shader.SetUniformMat4("model", model);
+        // capture: queue the read of the finished frame, it's mapped and written out a few frames later
+        // ---------------------------------------------------------------------------------------------
+        if (screenshotRequested)
+            frameCapture.RequestScreenshot();
+        screenshotRequested = false;
+        frameCapture.SetContinuous(continuousCapture);
+        sceneTarget.BindRead();
+        frameCapture.Capture(sceneTarget.GetWidth(), sceneTarget.GetHeight());
 
-        // Render Triangle
-        vertexArray.Bind(); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        // glBindVertexArray(0); // no need to unbind it every time 
+        sceneTarget.BlitToDefault(framebufferWidth, framebufferHeight);
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
+        // glfw: fence the frame and swap buffers
+        // --------------------------------------
+        framePipeline.EndFrame();
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        inputLatency.EndFrame(frame.inputTimestamp);
+        inputLatency.Poll();
+        frameCapture.Poll();
+
+        frameClock.WaitForNextFrame();
+        int nextSwapInterval = frameClock.UpdateSwapInterval();
+        if (!benchmarkFrames && nextSwapInterval != swapInterval)
+            glfwSwapInterval(swapInterval = nextSwapInterval);
 	}
 
+    framePipeline.Stop();
+    inputLatency.DeleteFences();
+    frameCapture.Stop();
+    gpuPicker.DeleteGpuPicker();
+    framePipeline.Report();
+    frameClock.Report();
+    inputLatency.Report();
+    frameCapture.Report();
+    shapeRenderer.Report();
+    polylineRenderer.Report();
+    particles.Report();
+    textRenderer.Report();
+    occlusionCuller.Report();
+    hiZCuller.Report();
+    gpuPicker.Report();
+    shapeBvh.Report();
+    std::cout << "Camera: matrices rebuilt " << camera.GetMatrixRebuildCount() << " times" << std::endl;
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     vertexArray.DeleteVertexArray();
     vertexBuffer.DeleteVertexBuffer();
+    instanceBuffer.DeleteVertexBuffer();
     indexBuffer.DeleteIndexBuffer();
     shader.DeleteProgram();
+    shapeRenderer.DeleteShapeRenderer();
+    hiZCuller.DeleteHiZCuller();
+    shapeShader.DeleteProgram();
+    pickingShader.DeleteProgram();
+    spiral.DeletePolyline();
+    trail.DeletePolyline();
+    polylineShader.DeleteProgram();
+    particles.DeleteParticleSystem();
+    particleShader.DeleteProgram();
+    textRenderer.DeleteTextRenderer();
+    font.DeleteFontAtlas();
+    textShader.DeleteProgram();
+    occlusionCuller.DeleteOcclusionCuller();
+    occlusionShader.DeleteProgram();
+    sceneTarget.DeleteRenderTarget();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -263,32 +617,858 @@ int main()
 	return 0;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
-// ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+// process all input: hand the events the callbacks queued since the last frame to the frame update
+// ------------------------------------------------------------------------------------------------
+FrameInput processInput(GLFWwindow* window, FrameClock& frameClock)
+{
+    // per-frame time logic
+    // --------------------
+    FrameInput input;
+    input.steps = frameClock.Tick();
+    input.time = frameClock.GetTime();
+    input.stepSeconds = frameClock.GetStepSeconds();
+    input.alpha = frameClock.GetAlpha();
+    input.events = inputQueue.Drain();
+    return input;
+}
+
+// frame update: apply the input to the camera and fill in the uniforms for every draw
+// -----------------------------------------------------------------------------------
+void buildFrame(const FrameInput& input, InputState& inputState, const glm::vec2& layers, FramePacket& packet)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
+    // events only mark the camera dirty, the view is rebuilt once below
+    for (const InputEvent& event : input.events)
+    {
+        inputState.Apply(event);
+        if (event.type == InputEventCursor)
+            camera.MouseCallback(event.x, event.y);
+        else if (event.type == InputEventScroll)
+            camera.ScrollCallback(event.x, event.y);
+        else if (event.type == InputEventResize)
+            camera.SetViewportSize((float)event.x, (float)event.y);
+    }
+    for (unsigned int step = 0; step < input.steps; step++)
+    {
+        camera.ProcessMovement(inputState.IsKeyDown(GLFW_KEY_W), inputState.IsKeyDown(GLFW_KEY_S),
+            inputState.IsKeyDown(GLFW_KEY_A), inputState.IsKeyDown(GLFW_KEY_D), (float)input.stepSeconds);
+    }
+
+    // camera projection/view transformation (note that in this case it could change every frame)
+    packet.input = input;
+    packet.inputTimestamp = input.events.empty() ? 0 : input.events.front().timestamp;
+    packet.frameUniforms = {};
+    packet.frameUniforms.viewProjection = camera.GetInterpolatedViewProjection(input.alpha);
+    // wrapped so the float keeps millisecond precision however long the program runs
+    packet.frameUniforms.time = (float)fmod(input.time, 3600.0);
+    packet.frameUniforms.viewportSize = camera.GetViewportSize();
 
-    double xpos, ypos;
-    glfwGetCursorPos(window, &xpos, &ypos);
-    camera.MouseCallback(xpos, ypos);
+    // per draw data: model matrix, color and texture layers
+    float greenValue = (float)(sin(input.time) / 2.0 + 0.5);
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f));
+    model = glm::rotate(model, glm::radians(0.0f), glm::vec3(1.0f, 0.3f, 0.5f));
 
-    camera.processInput(window, deltaTime);
+    DrawUniforms drawUniforms = {};
+    drawUniforms.color = { 0.0f, greenValue, 0.0f, 1.0f };
+    drawUniforms.layers = layers;
+    drawUniforms.alphaCutoff = 0.5f;
+
+    // a grid of small quads behind the first one, hidden until the camera moves, so the occlusion culler has
+    // something to skip
+    packet.draws.clear();
+    packet.drawBounds.clear();
+    for (int row = -1; row <= 1; row++)
+    {
+        for (int column = -1; column <= 1; column++)
+        {
+            drawUniforms.model = glm::translate(glm::mat4(1.0f), glm::vec3(column * 0.2f, row * 0.2f, -2.0f));
+            drawUniforms.model = glm::scale(drawUniforms.model, glm::vec3(0.15f));
+            packet.draws.push_back(drawUniforms);
+            packet.drawBounds.push_back(quadBounds(drawUniforms.model));
+        }
+    }
+    drawUniforms.model = model;
+    packet.draws.push_back(drawUniforms);
+    packet.drawBounds.push_back(quadBounds(model));
+
+    // SDF shapes around the quad, one of each kind
+    float angle = (float)fmod(input.time, 6.283185307179586);
+    ShapeStyle outlined;
+    outlined.fill = { 0.8f, 0.3f, 0.02f, 1.0f };
+    outlined.stroke = { 1.0f, 1.0f, 1.0f, 1.0f };
+    outlined.strokeWidth = 0.02f;
+    ShapeStyle strokeOnly;
+    strokeOnly.fill = glm::vec4(0.0f);
+    strokeOnly.stroke = { 0.9f, 0.9f, 0.2f, 1.0f };
+    strokeOnly.strokeWidth = 0.015f;
+    ShapeStyle translucent;
+    translucent.fill = { 0.1f, greenValue, 0.6f, 0.6f };
+
+    // a field of dots behind the quads, first so the shapes in front stay on top; the Hi-Z culler skips them until
+    // the camera moves, and the depth test keeps both pickers from picking them while they're hidden
+    packet.shapes.Clear();
+    ShapeStyle dot;
+    dot.fill = { 0.9f, 0.2f, 0.5f, 1.0f };
+    for (int row = 0; row < 16; row++)
+    {
+        for (int column = 0; column < 16; column++)
+            packet.shapes.AddCircle(glm::vec3((column - 7.5f) * 0.08f, (row - 7.5f) * 0.08f, -3.0f), 0.025f, dot);
+    }
+    packet.shapes.AddCircle(glm::vec3(-0.8f, 0.55f, -1.0f), 0.15f, outlined);
+    packet.shapes.AddEllipse(glm::vec3(0.8f, 0.55f, -1.0f), glm::vec2(0.22f, 0.1f), angle, translucent);
+    packet.shapes.AddRoundedRect(glm::vec3(-0.8f, -0.55f, -1.0f), glm::vec2(0.2f, 0.12f), 0.05f, 0.0f, strokeOnly);
+    packet.shapes.AddLine(glm::vec3(0.6f, -0.7f, -1.0f), glm::vec3(1.0f, -0.4f, -1.0f), 0.03f, outlined);
+    packet.shapes.AddRing(glm::vec3(0.0f, 0.0f, -1.0f), 0.75f, 0.02f, translucent);
+}
+
+// world space bounds of the quad's vertices under model
+// ----------------------------------------------------
+OcclusionBounds quadBounds(const glm::mat4& model)
+{
+    OcclusionBounds bounds = { glm::vec3(INFINITY), glm::vec3(-INFINITY) };
+    for (size_t i = 0; i < vertices.size(); i += 5)
+    {
+        glm::vec3 position = glm::vec3(model * glm::vec4(vertices[i], vertices[i + 1], vertices[i + 2], 1.0f));
+        bounds.boundsMin = glm::min(bounds.boundsMin, position);
+        bounds.boundsMax = glm::max(bounds.boundsMax, position);
+    }
+    return bounds;
+}
+
+// shader hot reload: takes the contents of the changed template files of one program, true when there were any
+// -----------------------------------------------------------------------------------------------------------
+bool applyShaderChanges(std::vector<FileChange>& changes, const char* vertexPath, const char* fragmentPath, std::string& vertexSource, std::string& fragmentSource)
+{
+    bool changed = false;
+    for (FileChange& change : changes)
+    {
+        if (change.path == vertexPath)
+            vertexSource = change.contents;
+        else if (change.path == fragmentPath)
+            fragmentSource = change.contents;
+        else
+            continue;
+        changed = true;
+    }
+    return changed;
+}
+
+// vertex attributes of the quad: position and texture coordinates per vertex, texture layers per instance
+// -----------------------------------------------------------------------------------------------------
+void setVertexAttributes(VertexBuffer& vertexBuffer, VertexBuffer& instanceBuffer)
+{
+    RenderDevice& device = GetRenderDevice();
+    vertexBuffer.Bind();
+    device.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 0);
+    device.EnableVertexAttribArray(0);
+
+    // texture coord attribute
+    device.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), 3 * sizeof(float));
+    device.EnableVertexAttribArray(1);
+
+    instanceBuffer.Bind();
+    device.VertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+    device.EnableVertexAttribArray(2);
+    device.VertexAttribDivisor(2, 1);
+}
+
+// render a built frame: uniforms into the buffers, then a depth tested draw per quad the occlusion culler
+// doesn't skip, their boxes queried for the next frames, and the shapes the Hi-Z culler doesn't skip over them
+// ----------------------------------------------------------------------------------------------------------
+void submitFrame(const FramePacket& frame, Shader& shader, VertexArray& vertexArray, UniformBuffer& frameUniformBuffer, UniformRingBuffer& drawUniformBuffer,
+    OcclusionCuller& occlusionCuller, Shader& occlusionShader, ShapeRenderer& shapeRenderer, Shader& shapeShader, HiZCuller& hiZCuller, RenderTarget& sceneTarget)
+{
+    RenderDevice& device = GetRenderDevice();
+    device.ClearColor(0.033f, 0.01f, 0.604f, 1.0f); // linear equivalent of (0.2, 0.1, 0.8)
+    device.Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Activate Progarm
+    shader.UseProgram();
+
+    frameUniformBuffer.Update(&frame.frameUniforms, sizeof(frame.frameUniforms));
+
+    // the ring has a segment more than the pipeline lets the GPU fall behind, so a segment is never overwritten while in use
+    drawUniformBuffer.BeginFrame();
+    std::vector<long long> drawOffsets;
+    for (const DrawUniforms& draw : frame.draws)
+        drawOffsets.push_back(drawUniformBuffer.Allocate(&draw, sizeof(draw)));
+    drawUniformBuffer.Flush();
+
+    // Render Triangle
+    device.Enable(GL_DEPTH_TEST);
+    occlusionCuller.BeginFrame(frame.draws.size());
+    vertexArray.Bind(); // seeing as we only have a single VAO there's no need to bind it every time, but we'll do so to keep things a bit more organized
+    for (size_t i = 0; i < drawOffsets.size(); i++)
+    {
+        if (drawOffsets[i] < 0 || !occlusionCuller.IsVisible(i))
+            continue;
+        drawUniformBuffer.Bind(UniformBindingDraw, drawOffsets[i], sizeof(DrawUniforms));
+        occlusionCuller.BeginDraw(i);
+        device.DrawElementsInstanced(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0, 1);
+        occlusionCuller.EndDraw(i);
+    }
+    // glBindVertexArray(0); // no need to unbind it every time 
+    occlusionCuller.Query(frame.drawBounds, frame.frameUniforms.viewProjection, occlusionShader);
+    device.Disable(GL_DEPTH_TEST);
+
+    // the quads are all the depth there is, so the pyramid comes from this frame's and needs no reprojection;
+    // the shapes are depth tested against it without writing it, so dropping the hidden ones changes nothing on screen
+    hiZCuller.Build(sceneTarget);
+    device.Enable(GL_DEPTH_TEST);
+    device.DepthMask(GL_FALSE);
+    shapeRenderer.Draw(frame.shapes, shapeShader, hiZCuller);
+    device.DepthMask(GL_TRUE);
+    device.Disable(GL_DEPTH_TEST);
+}
+
+// block compress the texture through the asset cache when the driver supports it, else upload it as is
+// ----------------------------------------------------------------------------------------------------
+TextureLayer addTexture(TextureLibrary& textures, AssetCache& assetCache, const std::string& texturePath)
+{
+    CompressedImage compressed;
+    if (glExtensions.EXT_texture_compression_s3tc && CookTexture(texturePath, assetCache, compressed))
+        return textures.Add(texturePath, std::move(compressed));
+    return textures.Add(texturePath);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    // make sure the viewport matches the new window dimensions; note that width and 
+    // the scene target is resized to match and sets the viewport; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    // the camera picks up the new aspect ratio with the next frame's input
+    inputQueue.PushResize(width, height);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ScrollCallback(xoffset, yoffset);
-}
\ No newline at end of file
+    // the camera belongs to the frame pipeline worker, so only queue the event here
+    inputQueue.PushScroll(xoffset, yoffset);
+}
+
+// glfw: whenever the mouse moves, this callback is called
+// -------------------------------------------------------
+void mouse_callback(GLFWwindow* window, double xpos, double ypos)
+{
+    inputQueue.PushCursor(xpos, ypos);
+}
+
+// software renderer: --software [frames] [reference] renders the scene headlessly to software.ppm and compares
+// it against the reference image (References/Software.png unless given, "none" skips it), the exit code reports
+// a mismatch. After an intended change to the scene the reference is replaced with the new software.ppm, as a
+// PPM or converted to any PNG
+// -------------------------------------------------------------------------------------------------------------
+int runSoftwareRenderer(int argc, char** argv)
+{
+    int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 1;
+    std::string referencePath = argc > 3 ? argv[3] : "References/Software.png";
+
+    // layers in the order the texture library assigns them
+    std::vector<SoftwareTexture> layers(2);
+    if (!layers[0].Load("Assets/Wood_Tiles.jpg") || !layers[1].Load("Assets/Metal_Grill.jpg"))
+        return -1;
+
+    SoftwareRasterizer rasterizer = SoftwareRasterizer(SCR_WIDTH, SCR_HEIGHT);
+    rasterizer.BindVertexData(&vertices);
+    rasterizer.BindIndexData(&indices);
+    rasterizer.BindTextureLayers(&layers);
+
+    // time stays at 0 so every run produces the same image
+    InputState inputState = InputState();
+    FramePacket packet;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        buildFrame(FrameInput(), inputState, glm::vec2(0.0f, 1.0f), packet);
+        rasterizer.Clear(glm::vec4(0.033f, 0.01f, 0.604f, 1.0f));
+        rasterizer.SetFrameUniforms(packet.frameUniforms);
+        for (const DrawUniforms& draw : packet.draws)
+        {
+            rasterizer.SetDrawUniforms(draw);
+            rasterizer.DrawElements((unsigned int)indices.size());
+        }
+        rasterizer.DrawShapes(packet.shapes.GetShapes());
+        rasterizer.Finish();
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Software renderer: " << frames << " frames at " << SCR_WIDTH << "x" << SCR_HEIGHT << " on " << rasterizer.GetThreadCount()
+        << " threads, " << milliseconds / frames << " ms/frame" << std::endl;
+
+    SoftwareImage image = rasterizer.GetColorBuffer();
+    if (!image.WritePPM("software.ppm"))
+        std::cout << "Failed to write software.ppm" << std::endl;
+    if (referencePath == "none")
+        return 0;
+
+    // PNGs go through stb_image, which flips them to the bottom to top rows ReadPPM produces
+    SoftwareImage reference;
+    bool isPPM = referencePath.size() > 4 && referencePath.compare(referencePath.size() - 4, 4, ".ppm") == 0;
+    if (!(isPPM ? reference.ReadPPM(referencePath) : reference.Load(referencePath)))
+    {
+        std::cout << "Failed to read reference image " << referencePath << std::endl;
+        return -1;
+    }
+    ImageDifference difference = CompareImages(image, reference, 2);
+    if (difference.sizeMismatch)
+    {
+        std::cout << "Reference image " << referencePath << " has a different size" << std::endl;
+        return 1;
+    }
+    std::cout << "Reference " << referencePath << ": " << difference.differentPixels << " pixels differ, max error " << difference.maxChannelError
+        << ", mean error " << difference.meanChannelError << std::endl;
+    return difference.differentPixels == 0 ? 0 : 1;
+}
+
+// software rasterizer throughput: many small quads spread over the screen, on one thread and on all of them
+// --------------------------------------------------------------------------------------------------------
+int runSoftwareBenchmark()
+{
+    std::vector<SoftwareTexture> layers(2);
+    if (!layers[0].Load("Assets/Wood_Tiles.jpg") || !layers[1].Load("Assets/Metal_Grill.jpg"))
+        return -1;
+
+    const int quadCount = 50000;
+    const int frames = 10;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::vector<DrawUniforms> draws(quadCount);
+    for (DrawUniforms& draw : draws)
+    {
+        draw.model = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random) * 0.75f, -6.0f + position(random) * 0.5f));
+        draw.model = glm::rotate(draw.model, angle(random), glm::vec3(0.3f, 0.5f, 1.0f));
+        draw.model = glm::scale(draw.model, glm::vec3(0.05f));
+        draw.layers = { 0.0f, 1.0f };
+    }
+
+    Camera benchmarkCamera = Camera((float)SCR_WIDTH, (float)SCR_HEIGHT);
+    FrameUniforms frameUniforms = {};
+    frameUniforms.viewProjection = benchmarkCamera.GetViewProjection();
+
+    unsigned int threadCounts[2] = { 1, 0 };
+    for (unsigned int threads : threadCounts)
+    {
+        SoftwareRasterizer rasterizer = SoftwareRasterizer(1280, 720, threads);
+        rasterizer.BindVertexData(&vertices);
+        rasterizer.BindIndexData(&indices);
+        rasterizer.BindTextureLayers(&layers);
+        rasterizer.SetFrameUniforms(frameUniforms);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            rasterizer.Clear(glm::vec4(0.033f, 0.01f, 0.604f, 1.0f));
+            for (const DrawUniforms& draw : draws)
+            {
+                rasterizer.SetDrawUniforms(draw);
+                rasterizer.DrawElements((unsigned int)indices.size());
+            }
+            rasterizer.Finish();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const SoftwareRasterizerStats& stats = rasterizer.GetStats();
+        std::cout << "Software rasterizer, " << rasterizer.GetThreadCount() << " threads: " << stats.triangles / seconds / 1e6 << " M triangles/s, "
+            << stats.pixels / seconds / 1e6 << " M pixels/s (setup " << stats.setupMilliseconds / frames << " ms, raster "
+            << stats.rasterMilliseconds / frames << " ms per frame of " << quadCount * 2 << " triangles)" << std::endl;
+    }
+    return 0;
+}
+
+// shader startup: every feature combination of Basic.vert/.frag (64 programs) built the old way, checking
+// each status right after its compile and link, then all of them again through the ShaderCompiler while a
+// hidden window keeps presenting frames like a loading screen would. Every pass gets its own sources so
+// the driver's shader cache can't serve it from the pass before (a cache from an earlier run still can)
+// ------------------------------------------------------------------------------------------------------
+int runShaderBenchmark()
+{
+    if (!glfwInit())
+    {
+        std::cout << "Failed to initialize glfw" << std::endl;
+        return -1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Shader benchmark", NULL, NULL);
+    if (!window)
+    {
+        std::cout << "Failed create window contex" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    LoadGLExtensions((GLADloadproc)glfwGetProcAddress);
+
+    std::string vertexTemplate, fragmentTemplate;
+    if (!ReadTextFile(vertexShaderPath, vertexTemplate) || !ReadTextFile(fragmentShaderPath, fragmentTemplate))
+    {
+        std::cout << "Failed to read shader sources" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+
+    const unsigned int programCount = 1u << ShaderFeatureCount;
+    unsigned long long runTag = (unsigned long long)std::chrono::steady_clock::now().time_since_epoch().count();
+    auto buildSource = [&](const std::string& source, unsigned int features, int pass)
+    {
+        std::string built = ShaderVariants::BuildSource(source, features);
+        size_t lineEnd = built.find('\n');
+        return built.substr(0, lineEnd + 1) + "// benchmark " + std::to_string(runTag) + "." + std::to_string(pass) + "\n" + built.substr(lineEnd + 1);
+    };
+
+    {
+        // serial: compile status straight after the compile, link status straight after the link
+        std::vector<std::unique_ptr<Shader>> programs;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned int features = 0; features < programCount; features++)
+        {
+            std::string vertexSource = buildSource(vertexTemplate, features, 0);
+            std::string fragmentSource = buildSource(fragmentTemplate, features, 0);
+            programs.push_back(std::make_unique<Shader>(vertexSource.c_str(), fragmentSource.c_str()));
+            programs.back()->Compile();
+            programs.back()->Link();
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Shader benchmark, serial: " << programCount << " programs in " << milliseconds << " ms, the thread blocked the whole time" << std::endl;
+    }
+
+    {
+        // scheduled: everything submitted up front, then one Poll per presented frame
+        ShaderCompiler compiler = ShaderCompiler();
+        std::vector<std::unique_ptr<Shader>> programs;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned int features = 0; features < programCount; features++)
+        {
+            std::string vertexSource = buildSource(vertexTemplate, features, 1);
+            std::string fragmentSource = buildSource(fragmentTemplate, features, 1);
+            programs.push_back(std::make_unique<Shader>(vertexSource.c_str(), fragmentSource.c_str()));
+            compiler.Submit(*programs.back());
+        }
+
+        int frames = 0;
+        double longestFrame = 0.0;
+        while (true)
+        {
+            std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+            unsigned int pending = compiler.Poll();
+            glClearColor(0.033f, 0.01f, 0.604f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            glfwSwapBuffers(window);
+            frames++;
+            longestFrame = std::max(longestFrame, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            if (pending == 0)
+                break;
+        }
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        unsigned int linked = 0;
+        for (const std::unique_ptr<Shader>& program : programs)
+            linked += program->IsLinked() ? 1 : 0;
+        std::cout << "Shader benchmark, scheduled: " << linked << " of " << programCount << " programs linked in " << milliseconds
+            << " ms over " << frames << " frames, the longest frame took " << longestFrame << " ms" << std::endl;
+        compiler.Report();
+    }
+
+    glfwTerminate();
+    return 0;
+}
+
+// null device: --null-device [frames] [commands.txt] submits frames of many quads to the recording device
+// and reports the calls, uploads and state changes per frame, optionally writing the command stream
+// -------------------------------------------------------------------------------------------------------
+int runNullDeviceBenchmark(int argc, char** argv)
+{
+    int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 1000;
+    const char* commandsPath = argc > 3 ? argv[3] : nullptr;
+    const int quadCount = 1000;
+
+    NullDevice device = NullDevice();
+    std::ofstream commands;
+    if (commandsPath)
+    {
+        commands.open(commandsPath);
+        if (!commands)
+        {
+            std::cout << "Failed to open " << commandsPath << std::endl;
+            return -1;
+        }
+        device.SetCommandStream(&commands);
+    }
+
+    std::string vertexShaderSource, fragmentShaderSource, shapeVertexShaderSource, shapeFragmentShaderSource, polylineVertexShaderSource, polylineFragmentShaderSource;
+    std::string particleUpdateShaderSource, particleVertexShaderSource, particleFragmentShaderSource, textVertexShaderSource, textFragmentShaderSource;
+    std::string occlusionVertexShaderSource, occlusionFragmentShaderSource, hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource;
+    std::string hiZCullVertexShaderSource, hiZCullGeometryShaderSource;
+    if (!ReadTextFile(vertexShaderPath, vertexShaderSource) || !ReadTextFile(fragmentShaderPath, fragmentShaderSource)
+        || !ReadTextFile(shapeVertexShaderPath, shapeVertexShaderSource) || !ReadTextFile(shapeFragmentShaderPath, shapeFragmentShaderSource)
+        || !ReadTextFile(polylineVertexShaderPath, polylineVertexShaderSource) || !ReadTextFile(polylineFragmentShaderPath, polylineFragmentShaderSource)
+        || !ReadTextFile(particleUpdateShaderPath, particleUpdateShaderSource)
+        || !ReadTextFile(particleVertexShaderPath, particleVertexShaderSource) || !ReadTextFile(particleFragmentShaderPath, particleFragmentShaderSource)
+        || !ReadTextFile(textVertexShaderPath, textVertexShaderSource) || !ReadTextFile(textFragmentShaderPath, textFragmentShaderSource)
+        || !ReadTextFile(occlusionVertexShaderPath, occlusionVertexShaderSource) || !ReadTextFile(occlusionFragmentShaderPath, occlusionFragmentShaderSource)
+        || !ReadTextFile(hiZReduceVertexShaderPath, hiZReduceVertexShaderSource) || !ReadTextFile(hiZReduceFragmentShaderPath, hiZReduceFragmentShaderSource)
+        || !ReadTextFile(hiZCullVertexShaderPath, hiZCullVertexShaderSource) || !ReadTextFile(hiZCullGeometryShaderPath, hiZCullGeometryShaderSource))
+    {
+        std::cout << "Failed to read shader sources" << std::endl;
+        return -1;
+    }
+    // everything made on the device is destroyed before the GL device is back
+    SetRenderDevice(&device);
+    {
+        unsigned int features = ShaderFeatureTextured | ShaderFeatureInstanced;
+        std::string vertexSource = ShaderVariants::BuildSource(vertexShaderSource, features);
+        std::string fragmentSource = ShaderVariants::BuildSource(fragmentShaderSource, features);
+        Shader shader = Shader(vertexSource.c_str(), fragmentSource.c_str());
+        shader.Link();
+        shader.UseProgram();
+        shader.SetUniformInt("textures", 0);
+        Shader shapeShader = Shader(shapeVertexShaderSource.c_str(), shapeFragmentShaderSource.c_str());
+        shapeShader.Link();
+        Shader occlusionShader = Shader(occlusionVertexShaderSource.c_str(), occlusionFragmentShaderSource.c_str());
+        occlusionShader.Link();
+
+        VertexArray vertexArray = VertexArray();
+        vertexArray.Bind();
+        VertexBuffer vertexBuffer = VertexBuffer(vertices);
+        IndexBuffer indexBuffer = IndexBuffer(indices);
+        std::vector<float> instanceLayers = { 0.0f, 1.0f };
+        VertexBuffer instanceBuffer = VertexBuffer(instanceLayers);
+        setVertexAttributes(vertexBuffer, instanceBuffer);
+        vertexBuffer.Unbind();
+        vertexArray.Unbind();
+        ShapeRenderer shapeRenderer = ShapeRenderer();
+        OcclusionCuller occlusionCuller = OcclusionCuller();
+        HiZCuller hiZCuller = HiZCuller(hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource, hiZCullVertexShaderSource, hiZCullGeometryShaderSource);
+        RenderTargetDesc sceneTargetDesc;
+        sceneTargetDesc.width = 1280;
+        sceneTargetDesc.height = 720;
+        sceneTargetDesc.colorFormat = GL_SRGB8_ALPHA8;
+        sceneTargetDesc.depthFormat = GL_DEPTH_COMPONENT32F;
+        sceneTargetDesc.samples = msaaSamples;
+        RenderTarget sceneTarget = RenderTarget(sceneTargetDesc);
+
+        UniformBuffer frameUniformBuffer = UniformBuffer(sizeof(FrameUniforms));
+        frameUniformBuffer.BindBase(UniformBindingFrame);
+        UniformRingBuffer drawUniformBuffer = UniformRingBuffer(quadCount * 256);
+
+        std::cout << "Null device setup: " << device.GetStats().totalCalls << " calls, " << device.GetStats().bytesUploaded << " bytes uploaded" << std::endl;
+        device.ResetStats();
+
+        // the frame update runs once, so only submission is timed
+        InputState inputState = InputState();
+        FramePacket packet;
+        buildFrame(FrameInput(), inputState, glm::vec2(0.0f, 1.0f), packet);
+        packet.draws.resize(quadCount, packet.draws.front());
+        packet.drawBounds.resize(quadCount, packet.drawBounds.front());
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            submitFrame(packet, shader, vertexArray, frameUniformBuffer, drawUniformBuffer, occlusionCuller, occlusionShader, shapeRenderer, shapeShader, hiZCuller, sceneTarget);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        const NullDeviceStats& stats = device.GetStats();
+        std::cout << "Null device: " << frames << " frames of " << quadCount << " draws, " << milliseconds / frames << " ms/frame, "
+            << (double)stats.totalCalls / frames << " calls, " << (double)stats.bytesUploaded / frames << " bytes uploaded, "
+            << (double)stats.stateChanges / frames << " state changes, " << (double)stats.redundantBinds / frames << " redundant binds per frame" << std::endl;
+        device.Report();
+        occlusionCuller.Report();
+        hiZCuller.Report();
+        shapeRenderer.Report();
+
+        // the frame pipeline against the serial loop, with the frame update and the submission each padded to a
+        // fixed amount of CPU work; the threaded loop can only approach the longer of the two with a core to spare
+        const int pipelineFrameCount = 200;
+        const double pipelineBuildMilliseconds = 4.0;
+        const double pipelineSubmitMilliseconds = 4.0;
+        auto spinUntil = [](std::chrono::steady_clock::time_point start, double milliseconds)
+        {
+            while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < milliseconds)
+            {
+            }
+        };
+        double pipelineFrameMilliseconds[2] = {};
+        for (bool threaded : { false, true })
+        {
+            InputState pipelineInputState = InputState();
+            FramePipeline pipeline = FramePipeline([&](const FrameInput& input, FramePacket& framePacket)
+            {
+                std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+                buildFrame(input, pipelineInputState, glm::vec2(0.0f, 1.0f), framePacket);
+                framePacket.draws.resize(quadCount, framePacket.draws.front());
+                framePacket.drawBounds.resize(quadCount, framePacket.drawBounds.front());
+                spinUntil(buildStart, pipelineBuildMilliseconds);
+            }, threaded);
+
+            FrameInput pipelineInput;
+            pipelineInput.steps = 1;
+            pipelineInput.stepSeconds = simulationStep;
+            pipeline.BeginFrame(pipelineInput);
+            std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < pipelineFrameCount; frame++)
+            {
+                FramePacket& framePacket = pipeline.AcquireFrame();
+                pipelineInput.time += simulationStep;
+                pipeline.BeginFrame(pipelineInput);
+                std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+                submitFrame(framePacket, shader, vertexArray, frameUniformBuffer, drawUniformBuffer, occlusionCuller, occlusionShader, shapeRenderer, shapeShader, hiZCuller, sceneTarget);
+                spinUntil(submitStart, pipelineSubmitMilliseconds);
+                pipeline.EndFrame();
+            }
+            pipelineFrameMilliseconds[threaded] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count() / pipelineFrameCount;
+            // the last BeginFrame's build is left to finish so the worker isn't stopped in the middle of it
+            pipeline.AcquireFrame();
+            pipeline.Stop();
+            std::cout << "Frame pipeline benchmark, " << pipelineBuildMilliseconds << " ms build and " << pipelineSubmitMilliseconds << " ms submit padding on "
+                << std::thread::hardware_concurrency() << " hardware threads:" << std::endl;
+            pipeline.Report();
+        }
+        // both loops measured, nothing estimated: on a single hardware thread the worker shares the core and there's no gain
+        std::cout << "Frame pipeline: serial " << pipelineFrameMilliseconds[0] << " ms/frame, threaded " << pipelineFrameMilliseconds[1]
+            << " ms/frame, " << pipelineFrameMilliseconds[0] / pipelineFrameMilliseconds[1] << "x measured throughput" << std::endl;
+
+        // what the queries cost in either mode, with every quad visible as the null device has no depth to
+        // test against: per quad a box draw in its query, and a result read or a conditional draw
+        for (OcclusionMode mode : { OcclusionModeReadback, OcclusionModeConditionalRender })
+        {
+            OcclusionCuller modeCuller = OcclusionCuller(mode);
+            device.ResetStats();
+            start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+                submitFrame(packet, shader, vertexArray, frameUniformBuffer, drawUniformBuffer, modeCuller, occlusionShader, shapeRenderer, shapeShader, hiZCuller, sceneTarget);
+            milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Occlusion culling, " << (mode == OcclusionModeReadback ? "readback" : "conditional render") << ": " << milliseconds / frames
+                << " ms/frame, " << (double)device.GetStats().totalCalls / frames << " calls per frame" << std::endl;
+            modeCuller.Report();
+        }
+
+        // a million point polyline streamed like a live plot: a point appended and a window of points edited every frame
+        const size_t polylinePointCount = 1000000;
+        const size_t polylineEditCount = 1000;
+        Shader polylineShader = Shader(polylineVertexShaderSource.c_str(), polylineFragmentShaderSource.c_str());
+        polylineShader.Link();
+        std::vector<PolylinePoint> points(polylinePointCount);
+        for (size_t i = 0; i < polylinePointCount; i++)
+            points[i] = PolylinePoint(glm::vec3(i * 1e-4f, sin(i * 1e-3f), -2.0f), 1.5f, glm::vec4(1.0f));
+        Polyline polyline = Polyline();
+        polyline.SetPoints(points);
+        PolylineRenderer polylineRenderer = PolylineRenderer();
+        polylineRenderer.Draw({ &polyline }, polylineShader);
+        device.ResetStats();
+
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            size_t first = ((size_t)frame * polylineEditCount) % (polylinePointCount - polylineEditCount);
+            for (size_t i = first; i < first + polylineEditCount; i++)
+                polyline.SetPoint(i, PolylinePoint(glm::vec3(i * 1e-4f, cos(i * 1e-3f), -2.0f), 1.5f, glm::vec4(1.0f)));
+            polyline.Append(PolylinePoint(glm::vec3(polyline.GetPointCount() * 1e-4f, 0.0f, -2.0f), 1.5f, glm::vec4(1.0f)));
+            polylineRenderer.Draw({ &polyline }, polylineShader);
+        }
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Polyline of " << polyline.GetPointCount() << " points, " << polylineEditCount << " edited and 1 appended per frame: "
+            << milliseconds / frames << " ms/frame, " << (double)device.GetStats().bytesUploaded / frames << " bytes uploaded per frame of "
+            << polyline.GetPointCount() * sizeof(PolylinePoint) << ", " << (double)device.GetStats().draws / frames << " draws" << std::endl;
+
+        // a million particles: the GPU path only submits, the CPU path simulates with SSE2 and uploads the lot
+        const size_t benchmarkParticleCount = 1000000;
+        const float particleStep = 1.0f / 60.0f;
+        Shader particleShader = Shader(particleVertexShaderSource.c_str(), particleFragmentShaderSource.c_str());
+        particleShader.Link();
+        for (ParticleSimulation simulation : { ParticleSimulationGPU, ParticleSimulationCPU })
+        {
+            ParticleSystem particleSystem = ParticleSystem(benchmarkParticleCount, ParticleEmitter(), particleUpdateShaderSource, simulation);
+            device.ResetStats();
+            start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                particleSystem.Update(particleStep);
+                particleSystem.Draw(particleShader);
+            }
+            milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            const NullDeviceStats& particleStats = device.GetStats();
+            std::cout << "Particles on the " << (simulation == ParticleSimulationGPU ? "GPU" : "CPU") << ": " << benchmarkParticleCount << " particles, "
+                << milliseconds / frames << " ms/frame of CPU time, " << (double)particleStats.totalCalls / frames << " calls, " << (double)particleStats.bytesUploaded / frames << " bytes uploaded, "
+                << (double)particleStats.draws / frames << " draws per frame" << std::endl;
+            if (simulation == ParticleSimulationCPU)
+                std::cout << "Particles on the CPU: " << benchmarkParticleCount * frames / (milliseconds * 1e-3) << " particles/s" << std::endl;
+        }
+
+        // thousands of labels whose text changes every frame, laid out and drawn with a stats block
+        const int labelCount = 2000;
+        Shader textShader = Shader(textVertexShaderSource.c_str(), textFragmentShaderSource.c_str());
+        textShader.Link();
+        FontAtlas font = FontAtlas();
+        TextBatch text = TextBatch(font);
+        TextRenderer textRenderer = TextRenderer();
+        device.ResetStats();
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            text.Clear();
+            char label[64];
+            for (int i = 0; i < labelCount; i++)
+            {
+                snprintf(label, sizeof(label), "label %d: %.1f \xC2\xB5s", i, (frame * labelCount + i) * 0.1);
+                text.AddText(label, TextSpaceWorld, glm::vec3((i % 50) * 0.1f - 2.5f, (i / 50) * 0.1f - 2.0f, -3.0f), 12.0f, glm::vec4(1.0f), TextAlignCenter);
+            }
+            snprintf(label, sizeof(label), "frame %d\n%d labels", frame, labelCount);
+            text.AddText(label, TextSpaceScreen, glm::vec3(8.0f, 8.0f, 0.0f), 18.0f, glm::vec4(1.0f));
+            textRenderer.Draw(text, font, textShader);
+        }
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Text: " << labelCount << " labels of " << (double)text.GetGlyphCount() << " glyphs laid out and drawn per frame, "
+            << milliseconds / frames << " ms/frame, " << (double)device.GetStats().bytesUploaded / frames << " bytes uploaded, "
+            << (double)device.GetStats().draws / frames << " draws per frame" << std::endl;
+        textRenderer.Report();
+
+        // the two scene textures through the TextureManager with a budget that only fits the larger one:
+        // used on alternate frames each one evicts the other, used every frame their top mips are dropped,
+        // and once the budget fits both again the mips come back one texture per frame
+        TextureManager textureManager = TextureManager(~size_t(0));
+        TextureHandle managedTextures[2] = { textureManager.Acquire("Assets/Wood_Tiles.jpg"), textureManager.Acquire("Assets/Metal_Grill.jpg") };
+        size_t managedBytes[2] = { textureManager.Get(managedTextures[0])->GetMemorySize(), textureManager.Get(managedTextures[1])->GetMemorySize() };
+        textureManager.BeginFrame();
+        textureManager.SetBudget(std::max(managedBytes[0], managedBytes[1]) * 5 / 4);
+        auto reportTextureManager = [&](const char* phase)
+        {
+            const TextureManagerStats& stats = textureManager.GetStats();
+            std::cout << "Texture manager, " << phase << ": " << stats.hits << " hits, " << stats.misses << " misses, " << stats.evictions << " evictions, "
+                << stats.mipDrops << " mip drops, " << stats.mipRestores << " mip restores, " << textureManager.GetResidentBytes() << " of "
+                << textureManager.GetBudget() << " bytes resident" << std::endl;
+            textureManager.ResetStats();
+        };
+        reportTextureManager("budget lowered");
+        const int textureFrames = 8;
+        for (int frame = 0; frame < textureFrames; frame++)
+        {
+            textureManager.Bind(managedTextures[frame % 2], 0);
+            textureManager.BeginFrame();
+        }
+        reportTextureManager("alternate frames");
+        for (int frame = 0; frame < textureFrames; frame++)
+        {
+            textureManager.Bind(managedTextures[0], 0);
+            textureManager.Bind(managedTextures[1], 1);
+            textureManager.BeginFrame();
+        }
+        reportTextureManager("both every frame");
+        textureManager.SetBudget((managedBytes[0] + managedBytes[1]) * 5 / 4);
+        for (int frame = 0; frame < textureFrames; frame++)
+        {
+            textureManager.Bind(managedTextures[0], 0);
+            textureManager.Bind(managedTextures[1], 1);
+            textureManager.BeginFrame();
+        }
+        reportTextureManager("budget raised");
+        textureManager.Release(managedTextures[0]);
+        textureManager.Release(managedTextures[1]);
+
+        // picking among a hundred thousand shapes. This is not a GPU against BVH comparison: the null device
+        // draws nothing and maps zeros, so the GPU side only times the CPU submission of the pass and its
+        // readback, and its ids are never checked. The BVH is checked against its own linear scan, which shares
+        // the hit test; the two pickers only meet on a real context, in the app's stats overlay
+        const size_t pickShapeCount = 100000;
+        const int pickCount = 10000;
+        const int pickWidth = sceneTarget.GetWidth(), pickHeight = sceneTarget.GetHeight();
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        ShapeBatch pickShapes;
+        for (size_t i = 0; i < pickShapeCount; i++)
+        {
+            glm::vec3 center = glm::vec3(unit(random) * 8.0f - 4.0f, unit(random) * 6.0f - 3.0f, -2.0f - unit(random) * 4.0f);
+            glm::vec2 size = glm::vec2(0.02f + unit(random) * 0.08f, 0.02f + unit(random) * 0.08f);
+            float angle = unit(random) * 6.2831853f;
+            ShapeStyle style;
+            style.fill = unit(random) < 0.25f ? glm::vec4(0.0f) : glm::vec4(unit(random), unit(random), unit(random), 1.0f);
+            style.stroke = glm::vec4(1.0f);
+            style.strokeWidth = 0.01f;
+            switch (i % ShapeTypeCount)
+            {
+            case ShapeCircle: pickShapes.AddCircle(center, size.x, style); break;
+            case ShapeEllipse: pickShapes.AddEllipse(center, size, angle, style); break;
+            case ShapeRoundedRect: pickShapes.AddRoundedRect(center, size, 0.01f, angle, style); break;
+            case ShapeLine: pickShapes.AddLine(center, center + glm::vec3(size, 0.0f), 0.01f, style); break;
+            default: pickShapes.AddRing(center, size.x, 0.01f, style); break;
+            }
+        }
+        std::string pickingVertexSource = ShaderVariants::BuildSource(shapeVertexShaderSource, ShaderFeaturePicking);
+        std::string pickingFragmentSource = ShaderVariants::BuildSource(shapeFragmentShaderSource, ShaderFeaturePicking);
+        Shader pickingShader = Shader(pickingVertexSource.c_str(), pickingFragmentSource.c_str());
+        pickingShader.Link();
+        shapeRenderer.Draw(pickShapes, shapeShader);
+        GpuPicker gpuPicker = GpuPicker();
+        device.ResetStats();
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+        {
+            gpuPicker.Poll();
+            gpuPicker.Pick(shapeRenderer, pickingShader, sceneTarget, (frame * 7) % pickWidth, (frame * 13) % pickHeight);
+        }
+        milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        const NullDeviceStats& pickStats = device.GetStats();
+        std::cout << "GPU picking among " << pickShapeCount << " shapes: " << milliseconds / frames << " ms/frame of CPU submission, " << (double)pickStats.totalCalls / frames
+            << " calls, " << (double)pickStats.bytesRead / frames << " bytes read back per frame, resolved " << gpuPicker.GetLatency()
+            << " frame later (no GPU work or ids on the null device)" << std::endl;
+        gpuPicker.Report();
+
+        Camera pickCamera = Camera((float)pickWidth, (float)pickHeight);
+        glm::mat4 pickViewProjection = pickCamera.GetViewProjection();
+        ShapeBvh shapeBvh = ShapeBvh();
+        shapeBvh.Build(pickShapes.GetShapes());
+        std::vector<PickRay> rays(pickCount);
+        for (PickRay& ray : rays)
+            ray = MakePickRay(pickViewProjection, (int)(unit(random) * pickWidth), (int)(unit(random) * pickHeight), glm::vec2((float)pickWidth, (float)pickHeight));
+        std::vector<int> bvhPicks(pickCount);
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < pickCount; i++)
+            bvhPicks[i] = shapeBvh.Pick(rays[i]);
+        double bvhMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        int hits = 0, mismatches = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < pickCount; i++)
+        {
+            int linearPick = shapeBvh.PickLinear(rays[i]);
+            hits += linearPick >= 0;
+            mismatches += linearPick != bvhPicks[i];
+        }
+        double linearMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "BVH picking among " << pickShapeCount << " shapes: " << bvhMilliseconds * 1000.0 / pickCount << " us per pick against "
+            << linearMilliseconds * 1000.0 / pickCount << " us for a linear scan, " << hits << " of " << pickCount << " picks hit a shape, "
+            << mismatches << " differ from the linear scan" << std::endl;
+        shapeBvh.Report();
+
+        // Hi-Z culling of the same hundred thousand shapes: the pyramid of a 1280x720 depth buffer, a culling point
+        // per shape and the draw, with the count kept on the GPU or read back; every query answers 1 here, so only
+        // the submission cost means anything
+        for (HiZDrawMode mode : { HiZDrawIndirect, HiZDrawReadback })
+        {
+            HiZCuller modeCuller = HiZCuller(hiZReduceVertexShaderSource, hiZReduceFragmentShaderSource, hiZCullVertexShaderSource, hiZCullGeometryShaderSource, mode);
+            device.ResetStats();
+            start = std::chrono::steady_clock::now();
+            for (int frame = 0; frame < frames; frame++)
+            {
+                modeCuller.Build(sceneTarget);
+                shapeRenderer.Draw(pickShapes, shapeShader, modeCuller);
+            }
+            milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Hi-Z culling of " << pickShapeCount << " shapes, " << (mode == HiZDrawIndirect ? "indirect" : "readback") << ": " << milliseconds / frames
+                << " ms/frame of CPU time, " << (double)device.GetStats().totalCalls / frames << " calls, " << (double)device.GetStats().bytesUploaded / frames
+                << " bytes uploaded, " << (double)device.GetStats().draws / frames << " draws per frame" << std::endl;
+            modeCuller.Report();
+        }
+    }
+    SetRenderDevice(nullptr);
+    return 0;
+}